@@ -133,9 +133,9 @@ std::tuple<LinearDynamics, Matrix3D> linearize(const Matrix3D& xt,
     std::tuple<MatrixXd, MatrixXd, VectorXd, VectorXd> resi;
 
     for (int i=0; i<_nt; i++){
-        zki = _ei.decomp3d(xt, _nx, 1, i);
-        Aki = _ei.decomp3d(Akt, _nx, _nx, i);
-        Sigki = _ei.decomp3d(Sigkt, _nx, _nx, i);
+        zki = xt.slice(i, _nx, 1);
+        Aki = Akt.slice(i, _nx, _nx);
+        Sigki = Sigkt.slice(i, _nx, _nx);
         // get the linearization results
         // resi = linearize_at(zki, sig, Aki, Sigki);
         resi = linearize_at(zki, Aki, Sigki);
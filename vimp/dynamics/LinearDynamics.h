@@ -35,37 +35,59 @@ public:
                    const Matrix3D Bt, 
                    const Matrix3D at): Dynamics(nx, nu, nt), _At(At), _Bt(Bt), _at(at){}             
 
-    inline Matrix3D At(){return _At;}
-    inline Matrix3D Bt(){return _Bt;}
-    inline Matrix3D at(){return _at;}
+    virtual ~LinearDynamics(){}
+
+    virtual Matrix3D At(){return _At;}
+    virtual Matrix3D Bt(){return _Bt;}
+    virtual Matrix3D at(){return _at;}
+
+    /**
+     * @brief get the matrices at specific time point i.
+     */
+    virtual Eigen::Map<const MatrixXd> At_i(int i) const { return _At.slice(i, _nx, _nx); }
+    virtual Eigen::Map<const MatrixXd> Bt_i(int i) const { return _Bt.slice(i, _nx, _nu); }
+    virtual Eigen::Map<const MatrixXd> at_i(int i) const { return _at.slice(i, _nx, 1); }
+
+    /**
+     * @brief Whether (A, B, a) are the same at all time points.
+     */
+    virtual bool time_invariant() const { return false; }
 
 protected:
     Matrix3D _At, _Bt, _at;
 };
 
 
+/**
+ * @brief Linear time invariant dynamics. Only (A, B, a) are stored, the time-varying matrices
+ * are replicated when they are requested.
+ */
 class LTI: public LinearDynamics{
 public:
     LTI(){}
-    LTI(int nx, int nu, int nt):LinearDynamics(nx, nu, nt), _A(nx,nx), _B(nx,nu), _a(nx,1){}
+    LTI(int nx, int nu, int nt):LinearDynamics(nx, nu, nt, Matrix3D(), Matrix3D(), Matrix3D()), _A(nx,nx), _B(nx,nu), _a(nx,1){}
 
     LTI(int nx, int nu, int nt, 
         const MatrixXd& A, 
         const MatrixXd& B, 
-        const MatrixXd& a):LinearDynamics(nx, nu, nt, 
-                                        _ei.replicate3d(A, nt), 
-                                        _ei.replicate3d(B, nt), 
-                                        _ei.replicate3d(a, nt)), _A(A), _B(B), _a(a){}
+        const MatrixXd& a):LinearDynamics(nx, nu, nt, Matrix3D(), Matrix3D(), Matrix3D()), _A(A), _B(B), _a(a){}
 
     void update_matrices(const MatrixXd& A, const MatrixXd& B, const VectorXd& a){
         _A = A;
         _B = B;
         _a = a;
-        _At = _ei.replicate3d(A, _nt); 
-        _Bt = _ei.replicate3d(B, _nt); 
-        _at = _ei.replicate3d(a, _nt);
     }
 
+    Matrix3D At() override { return _ei.replicate3d(_A, _nt); }
+    Matrix3D Bt() override { return _ei.replicate3d(_B, _nt); }
+    Matrix3D at() override { return _ei.replicate3d(_a, _nt); }
+
+    Eigen::Map<const MatrixXd> At_i(int /*i*/) const override { return Eigen::Map<const MatrixXd>(_A.data(), _nx, _nx); }
+    Eigen::Map<const MatrixXd> Bt_i(int /*i*/) const override { return Eigen::Map<const MatrixXd>(_B.data(), _nx, _nu); }
+    Eigen::Map<const MatrixXd> at_i(int /*i*/) const override { return Eigen::Map<const MatrixXd>(_a.data(), _nx, 1); }
+
+    bool time_invariant() const override { return true; }
+
     inline Matrix3D A0(){return _A;}
     inline Matrix3D B0(){return _B;}
     inline Matrix3D a0(){return _a;}
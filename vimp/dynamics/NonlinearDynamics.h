@@ -40,6 +40,14 @@ public:
                                                             const Matrix3D& Akt, 
                                                             const Matrix3D& Sigkt){}
 
+    /**
+     * @brief The threads linearizing the time points of a trajectory, the hardware concurrency if <= 0.
+     */
+    void set_n_threads(int n_threads){ _n_threads = n_threads; }
+
+protected:
+    int _n_threads = 1;
+
 };
 
 }// namespace vimp
\ No newline at end of file
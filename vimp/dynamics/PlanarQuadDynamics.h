@@ -10,6 +10,7 @@
  */
 
 #include "dynamics/NonlinearDynamics.h"
+#include "helpers/ParallelFor.h"
 #include "3rdparty/TinyAD/Scalar.hh"
 
 using namespace Eigen;
@@ -111,7 +112,7 @@ std::tuple<MatrixXd, MatrixXd, VectorXd, VectorXd> linearize_at(const VectorXd&
     auto res = temp4*temp2;
     auto nTr = res.trace().grad;
     
-    VectorXd VnTr(6,6);
+    VectorXd VnTr(6);
     VnTr << nTr(0), nTr(1), nTr(2), nTr(3), nTr(4), nTr(5);
 
     return std::make_tuple(hAk, B, hak, VnTr);
@@ -131,32 +132,20 @@ std::tuple<LinearDynamics, Matrix3D> linearize(const Matrix3D& xt,
     // The result collectors for all time points
     Matrix3D hAt(_nx, _nx, _nt), Bt(_nx, _nu, _nt), hat(_nx, 1, _nt), nTrt(_nx, 1, _nt);
 
-    // The i_th matrices
-    Eigen::VectorXd zki(_nx), hai(_nx), nTri(_nx);
-    Eigen::MatrixXd Aki(_nx, _nx), hAi(_nx, _nx), Bi(_nx, _nu);
-    Eigen::MatrixXd Sigki(_nx, _nx);
-    std::tuple<MatrixXd, MatrixXd, VectorXd, VectorXd> resi;
-
-    for (int i=0; i<_nt; i++){
-        // Get the nominals
-        zki = _ei.decomp3d(xt, _nx, 1, i);
-        Aki = _ei.decomp3d(Akt, _nx, _nx, i);
-        Sigki = _ei.decomp3d(Sigkt, _nx, _nx, i);
-
-        // Get the linearization results
-        resi = linearize_at(zki, Aki, Sigki);
-        hAi = std::get<0>(resi);
-        Bi = std::get<1>(resi);
-        hai = std::get<2>(resi);
-        nTri = std::get<3>(resi);
-
-        // Assamble into the 3d matrices
-        _ei.compress3d(hAi, hAt, i);
-        _ei.compress3d(Bi, Bt, i);
-        _ei.compress3d(hai, hat, i);
-        _ei.compress3d(nTri, nTrt, i);
-        
-    }
+    // The time points are independent: each chunk linearizes its own ones into their slices
+    parallel_for(_nt, _n_threads, [&](int begin, int end){
+        std::tuple<MatrixXd, MatrixXd, VectorXd, VectorXd> resi;
+        for (int i=begin; i<end; i++){
+            // Get the linearization results at the nominals
+            resi = linearize_at(xt.slice(i, _nx, 1), Akt.slice(i, _nx, _nx), Sigkt.slice(i, _nx, _nx));
+
+            // Assamble into the 3d matrices
+            hAt.slice(i, _nx, _nx) = std::get<0>(resi);
+            Bt.slice(i, _nx, _nu) = std::get<1>(resi);
+            hat.slice(i, _nx, 1) = std::get<2>(resi);
+            nTrt.slice(i, _nx, 1) = std::get<3>(resi);
+        }
+    });
     return std::make_tuple(LinearDynamics{_nx, _nu, _nt, hAt, Bt, hat}, nTrt);
 }
 
@@ -12,14 +12,58 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <memory>
 using namespace Eigen;
 
 namespace vimp{
+
+/**
+ * @brief The immutable terms of a linear Gaussian factor used in the closed-form expressions:
+ * cost = C*(||Lambda*mu - Psi*mu_t||_{Sigma_t^{-1}} + tr(Lambda^T*Sigma_t^{-1}*Lambda*Sigma)).
+ * Shared by reference among all the factors with the same definition.
+ */
+struct LinearGaussianTerms{
+    LinearGaussianTerms(const VectorXd& target_mean, 
+                        const MatrixXd& target_precision, 
+                        const MatrixXd& Lambda, 
+                        const MatrixXd& Psi, 
+                        double constant):
+        target_mean{target_mean},
+        target_precision{target_precision},
+        Lambda{Lambda},
+        Psi{Psi},
+        constant{constant}
+    {
+        AT_precision_A = Lambda.transpose() * target_precision * Lambda;
+        Psi_target_mean = Psi * target_mean;
+        AT_precision_Psi_mean = Lambda.transpose() * target_precision * Psi_target_mean;
+    }
+
+    VectorXd target_mean;
+    MatrixXd target_precision, Lambda, Psi;
+    double constant;
+
+    /// Lambda^T * Sigma_t^{-1} * Lambda
+    MatrixXd AT_precision_A;
+    /// Psi * mu_t
+    VectorXd Psi_target_mean;
+    /// Lambda^T * Sigma_t^{-1} * Psi * mu_t
+    VectorXd AT_precision_Psi_mean;
+};
+
 class LinearFactor{
 public:
     virtual ~LinearFactor(){} 
     LinearFactor(){}
 
+    /**
+     * @brief The closed-form terms of the factor. 
+     * Factors with a shared definition return the same shared object.
+     */
+    virtual std::shared_ptr<const LinearGaussianTerms> terms() const{
+        return std::make_shared<const LinearGaussianTerms>(get_mu(), get_precision(), get_Lambda(), get_Psi(), get_Constant());
+    }
+
     // virtual VectorXd get_mean() = 0;
     inline virtual VectorXd get_mu() const = 0;
     inline virtual MatrixXd get_covariance() const = 0;
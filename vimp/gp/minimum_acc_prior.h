@@ -20,27 +20,19 @@
 #include "linear_factor.h"
 #include "helpers/EigenWrapper.h"
 
+#include <memory>
+
 namespace vimp{
-    class MinimumAccGP : public LinearFactor{
-        public: 
-            MinimumAccGP(){};
-            /**
-             * @brief the state is [x; v] where the dimension of x is _dim. 
-             * The returned mean is the concatenation of the two consecutive [\mu_i, \mu_{i+1}].
-             * The constant velocity linear factor has closed-forms in transition matrix \Phi,
-             * the matrices in computing the quadratic costs, (\Lambda, \Psi).
-             * Qc is in shape (_dim, _dim); 
-             * _Phi and _Q are in shape(2*_dim, 2*_dim)
-             * @param Qc 
-             * @param delta_t 
-             */
-            MinimumAccGP(const MatrixXd& Qc, double start_index, const double& delta_t, const VectorXd& mu_0): 
-            LinearFactor(),
-            _dim{Qc.cols()},
+    /**
+     * @brief The immutable definition of the minimum acceleration gp prior between 2 consecutive support states.
+     * With a constant delta_t and Qc it is identical for all the prior factors along a trajectory, 
+     * so it is computed once and shared by reference.
+     */
+    class MinimumAccGPModel{
+        public:
+            MinimumAccGPModel(const MatrixXd& Qc, double delta_t):
+            _dim{static_cast<int>(Qc.cols())},
             _dim_state{2*_dim},
-            _start_index{start_index},
-            _m0{mu_0},
-            _target_mu{VectorXd::Zero(2*_dim_state)},
             _delta_t{delta_t}, 
             _Qc{Qc}, 
             _invQc{Qc.inverse()}, 
@@ -49,18 +41,6 @@ namespace vimp{
                 _Phi.setZero();
                 _Phi << MatrixXd::Identity(_dim, _dim), delta_t*MatrixXd::Identity(_dim, _dim), 
                            MatrixXd::Zero(_dim, _dim), MatrixXd::Identity(_dim, _dim);
-
-                // compute the concatenation [\mu_i, \mu_{i+1}]
-                MatrixXd Phi_i(_dim_state, _dim_state);
-                Phi_i.setZero();
-                Phi_i << MatrixXd::Identity(_dim, _dim), _start_index*delta_t*MatrixXd::Identity(_dim, _dim), 
-                         MatrixXd::Zero(_dim, _dim), MatrixXd::Identity(_dim, _dim);
-
-                VectorXd mi = Phi_i * _m0;
-                VectorXd mi_next = _Phi * mi;
-
-                // _target_mu.segment(0, _dim_state) = mi;
-                // _target_mu.segment(_dim_state, _dim_state) = mi_next;
                 
                 _Q = MatrixXd::Zero(_dim_state, _dim_state);
                 _Q << _Qc*pow(_delta_t, 3)/3, _Qc*pow(_delta_t, 2)/2, _Qc*pow(_delta_t, 2)/2, Qc*_delta_t;
@@ -75,23 +55,87 @@ namespace vimp{
                 _Psi = MatrixXd::Zero(_dim_state, 2*_dim_state);
                 // _Psi.block(0, 0, _dim_state, _dim_state) = _Phi;
                 // _Psi.block(0, _dim_state, _dim_state, _dim_state) = -MatrixXd::Identity(_dim_state, _dim_state);
+
+                _target_mu = VectorXd::Zero(2*_dim_state);
+
+                _terms = std::make_shared<const LinearGaussianTerms>(_target_mu, _invQ, _Lambda, _Psi, 0.5);
             }
 
+            inline int dim() const { return _dim; }
+
+            inline double delta_t() const { return _delta_t; }
+
+            inline const MatrixXd& Qc() const { return _Qc; }
+
+            inline const MatrixXd& Q() const { return _Q; }
+
+            inline const MatrixXd& invQ() const { return _invQ; }
+
+            inline const MatrixXd& Phi() const { return _Phi; }
+
+            inline const MatrixXd& Lambda() const { return _Lambda; }
+
+            inline const MatrixXd& Psi() const { return _Psi; }
+
+            inline const VectorXd& target_mu() const { return _target_mu; }
+
+            inline const std::shared_ptr<const LinearGaussianTerms>& terms() const { return _terms; }
+
         private:
-            int _dim, _start_index;
-            int _dim_state;
+            int _dim, _dim_state;
             double _delta_t;
             MatrixXd _Qc, _invQc, _Q, _invQ;
             MatrixXd _Phi, _Lambda, _Psi;
-            VectorXd _m0, _target_mu;
-            EigenWrapper _ei;
+            VectorXd _target_mu;
+            std::shared_ptr<const LinearGaussianTerms> _terms;
+
+            inline void compute_invQ() {
+                _invQ = MatrixXd::Zero(2*_dim, 2*_dim);
+                _invQ.block(0, 0, _dim, _dim) = 12 * _invQc / pow(_delta_t, 3);
+                _invQ.block(0, _dim, _dim, _dim) = -6 * _invQc / pow(_delta_t, 2);
+                _invQ.block(_dim, 0, _dim, _dim) = -6 * _invQc / pow(_delta_t, 2);
+                _invQ.block(_dim, _dim, _dim, _dim) = 4 * _invQc / _delta_t;
+            }
+    };
+
+    class MinimumAccGP : public LinearFactor{
+        public: 
+            MinimumAccGP(){};
+            /**
+             * @brief the state is [x; v] where the dimension of x is _dim. 
+             * The returned mean is the concatenation of the two consecutive [\mu_i, \mu_{i+1}].
+             * The constant velocity linear factor has closed-forms in transition matrix \Phi,
+             * the matrices in computing the quadratic costs, (\Lambda, \Psi).
+             * Qc is in shape (_dim, _dim); 
+             * _Phi and _Q are in shape(2*_dim, 2*_dim)
+             * @param Qc 
+             * @param delta_t 
+             */
+            MinimumAccGP(const MatrixXd& Qc, double start_index, const double& delta_t, const VectorXd& mu_0): 
+            MinimumAccGP(std::make_shared<const MinimumAccGPModel>(Qc, delta_t), start_index, mu_0){}
+
+            /**
+             * @brief Construct from a prior definition shared among all the prior factors.
+             */
+            MinimumAccGP(std::shared_ptr<const MinimumAccGPModel> model, double start_index, const VectorXd& mu_0): 
+            LinearFactor(),
+            _model{std::move(model)},
+            _start_index{static_cast<int>(start_index)},
+            _m0{mu_0}{}
+
+        private:
+            std::shared_ptr<const MinimumAccGPModel> _model;
+            int _start_index;
+            VectorXd _m0;
             
         public:
-            inline MatrixXd Q() const { return _Q; }
+            inline MatrixXd Q() const { return _model->Q(); }
+
+            inline MatrixXd Qc() const { return _model->Qc(); }
 
-            inline MatrixXd Qc() const { return _Qc; }
+            inline MatrixXd Phi() const { return _model->Phi(); }
 
-            inline MatrixXd Phi() const { return _Phi; }
+            inline const std::shared_ptr<const MinimumAccGPModel>& model() const { return _model; }
 
             /**
              * @brief the cost function
@@ -99,31 +143,26 @@ namespace vimp{
              * @param theta2 [x2; v2]
              */
             inline double cost(const VectorXd& theta1, const VectorXd& theta2) const{
-                double cost = (_Phi*theta1-theta2).transpose()* _invQ * (_Phi*theta1-theta2);
+                VectorXd r = _model->Phi()*theta1-theta2;
+                double cost = r.transpose()* _model->invQ() * r;
                 return cost / 2;
             }
 
-            inline int dim_posvel() const { return 2*_dim; }
+            inline int dim_posvel() const { return 2*_model->dim(); }
 
-            inline void compute_invQ() {
-                _invQ = MatrixXd::Zero(2*_dim, 2*_dim);
-                _invQ.block(0, 0, _dim, _dim) = 12 * _invQc / pow(_delta_t, 3);
-                _invQ.block(0, _dim, _dim, _dim) = -6 * _invQc / pow(_delta_t, 2);
-                _invQ.block(_dim, 0, _dim, _dim) = -6 * _invQc / pow(_delta_t, 2);
-                _invQ.block(_dim, _dim, _dim, _dim) = 4 * _invQc / _delta_t;
-            }
+            inline VectorXd get_mu() const { return _model->target_mu(); }
 
-            inline VectorXd get_mu() const { return _target_mu; }
+            inline MatrixXd get_precision() const{ return _model->invQ(); }
 
-            inline MatrixXd get_precision() const{ return _invQ; }
+            inline MatrixXd get_covariance() const{ return _model->invQ().inverse(); }
 
-            inline MatrixXd get_covariance() const{ return _invQ.inverse(); }
+            inline MatrixXd get_Lambda() const{ return _model->Lambda(); }
 
-            inline MatrixXd get_Lambda() const{ return _Lambda; }
-
-            inline MatrixXd get_Psi() const{ return _Psi; }
+            inline MatrixXd get_Psi() const{ return _model->Psi(); }
 
             inline double get_Constant() const { return 0.5; }
+
+            std::shared_ptr<const LinearGaussianTerms> terms() const override{ return _model->terms(); }
             
     };
 
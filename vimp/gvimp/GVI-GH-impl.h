@@ -14,22 +14,41 @@ namespace vimp
     template <typename Factor>
     std::tuple<VectorXd, SpMat> GVIGH<Factor>::compute_gradients(){
         _Vdmu.setZero();
-        _Vddmu.setZero();
+        _ei.sp_values(_Vddmu).setZero();
 
         for (auto &opt_k : _vec_factors)
         {
             opt_k->calculate_partial_V();
-            _Vdmu = _Vdmu + opt_k->joint_Vdmu_sp();
-            _Vddmu = _Vddmu + opt_k->joint_Vddmu_sp();
+
+            // accumulate the marginal gradients into the joint ones in place, read from the factor without copies
+            const TrajectoryBlock& block = opt_k->block();
+            const VectorXd& Vdmu_k = opt_k->Vdmu();
+            const MatrixXd& Vddmu_k = opt_k->Vddmu();
+            if (block.is_contiguous()){
+                int start = block.start_element();
+                _Vdmu.segment(start, Vdmu_k.size()) += Vdmu_k;
+                _ei.sp_add_block(_Vddmu, start, start, Vddmu_k);
+            }else{
+                int row = 0;
+                for (const auto & seg_r : block.segments()){
+                    _Vdmu.segment(seg_r.first, seg_r.second) += Vdmu_k.segment(row, seg_r.second);
+                    int col = 0;
+                    for (const auto & seg_c : block.segments()){
+                        _ei.sp_add_block(_Vddmu, seg_r.first, seg_c.first, Vddmu_k.block(row, col, seg_r.second, seg_c.second));
+                        col += seg_c.second;
+                    }
+                    row += seg_r.second;
+                }
+            }
         }
 
-        SpMat dprecision = _Vddmu - _precision;
+        _ei.sp_axpby(1.0, _Vddmu, -1.0, _precision, _dprecision);
         VectorXd dmu = _ei.solve_cgd_sp(_Vddmu, -_Vdmu);
 
         // MatrixXd Vddmu_full{_Vddmu};
         // VectorXd dmu = Vddmu_full.colPivHouseholderQr().solve(-_Vdmu);
 
-        return std::make_tuple(dmu, dprecision);
+        return std::make_tuple(dmu, _dprecision);
     }
 
     template <typename Factor>
@@ -77,28 +96,26 @@ namespace vimp
             int B = 1;
             double step_size = 0.0;
 
-            SpMat new_precision; 
-            VectorXd new_mu; 
+            VectorXd new_mu(_dim); 
 
             // backtracking 
             while (true)
             {
-                new_mu.setZero(); new_precision.setZero();
                 // new step size
                 step_size = pow(_step_size_base, B);
 
-                // update mu and precision matrix
+                // update mu and precision matrix, the precision stays in the fixed pattern
                 new_mu = _mu + step_size * dmu;
-                new_precision = _precision + step_size * dprecision;
+                _ei.sp_axpby(1.0, _precision, step_size, dprecision, _new_precision);
 
                 // new cost
-                double new_cost = cost_value(new_mu, new_precision);
+                double new_cost = cost_value(new_mu, _new_precision);
 
                 // accept new cost and update mu and precision matrix
                 if (new_cost < cost_iter){
                     /// update mean and covariance
                     set_mu(new_mu);
-                    set_precision(new_precision);
+                    set_precision(_new_precision);
                     break;
                 }else{ 
                     // shrinking the step size
@@ -112,7 +129,7 @@ namespace vimp
                         cout << "Too many iterations in the backtracking ... Dead" << endl;
                     }
                     set_mu(new_mu);
-                    set_precision(new_precision);
+                    set_precision(_new_precision);
                         break;
                 }                
             }
@@ -126,7 +143,7 @@ namespace vimp
     template <typename Factor>
     inline void GVIGH<Factor>::set_precision(const SpMat &new_precision)
     {
-        _precision = new_precision;
+        _ei.sp_project(new_precision, _precision);
         // sparse inverse
         inverse_inplace();
 
@@ -170,22 +187,16 @@ namespace vimp
     double GVIGH<Factor>::cost_value(const VectorXd &mean, SpMat &Precision)
     {
 
-        SpMat Cov = inverse(Precision);
+        inverse(Precision, _cov_eval);
 
         double value = 0.0;
         for (auto &opt_k : _vec_factors)
         {
-            value += opt_k->fact_cost_value(mean, Cov); // / _temperature;
+            value += opt_k->fact_cost_value(mean, _cov_eval); // / _temperature;
         }
 
-        SparseLDLT ldlt(Precision);
-        VectorXd vec_D = ldlt.vectorD();
-
-        // MatrixXd precision_full{Precision};
-        double logdet = 0;
-        for (int i_diag=0; i_diag<vec_D.size(); i_diag++){
-            logdet += log(vec_D(i_diag));
-        }
+        // the log determinant comes from the same factorization as the inverse
+        double logdet = _logdet_eval;
 
         // cout << "logdet " << endl << logdet << endl;
         
@@ -11,8 +11,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <utility>
 #include <memory>
+#include <functional>
 
 #include "helpers/DataRecorder.h"
 #include "helpers/EigenWrapper.h"
@@ -59,13 +61,32 @@ public:
             _Vdmu{VectorXd::Zero(_dim)},
             _Vddmu{SpMat(_dim, _dim)},
             _precision{SpMat(_dim, _dim)},
-            _ldlt{_precision},
             _covariance{SpMat(_dim, _dim)},
             _res_recorder{niterations, dim_state, num_states, _nfactors}
     {
                 construct_sparse_precision();
                 _Vdmu.setZero();
-                _Vddmu.setZero();
+    }
+
+    /**
+     * @brief After a local change of the costs, e.g., an sdf region update (RobotSDFBase::update_sdf_region), 
+     * drop the kept moments of the factors whose quadrature ball the test finds affected, so that the next 
+     * optimization re-integrates only those and reuses the kept moments of the others while their marginals are unchanged.
+     * The factors with a cost version (set_cost_version) drop their moments on a version change without this call, 
+     * e.g., those of the other optimizers on the same robot.
+     * @return the states of the affected factors
+     */
+    std::vector<int> invalidate_factors(const typename FactorizedOptimizer::RegionTest& affected){
+        std::vector<int> states;
+        for (auto& factor : _vec_factors){
+            if (factor->invalidate_moments(affected)){
+                std::vector<int> factor_states = factor->block().states();
+                states.insert(states.end(), factor_states.begin(), factor_states.end());
+            }
+        }
+        std::sort(states.begin(), states.end());
+        states.erase(std::unique(states.begin(), states.end()), states.end());
+        return states;
     }
 
 protected:
@@ -89,12 +110,25 @@ protected:
     MatrixIO _matrix_io;
 
     // sparse matrices
+    // All the joint sparse matrices share one fixed sparsity pattern _sp_pattern, 
+    // and their arithmetic operates directly on the value arrays.
+    SpMat _sp_pattern;
     SpMat _precision, _covariance;
+    SpMat _dprecision, _new_precision, _cov_eval;
     EigenWrapper _ei;
-    VectorXi _Rows, _Cols; VectorXd _Vals;
+    VectorXi _Rows, _Cols; VectorXd _Vals, _Vals_eval;
     int _nnz = 0;
-    SparseLDLT _ldlt;
+    SparseLDLT _ldlt, _ldlt_eval;
     SpMat _L; VectorXd _D, _Dinv; // for computing the determinant
+    double _logdet_eval = 0.0;
+
+    // Fill-reducing ordering, chosen once by the symbolic analysis of the fixed pattern.
+    // The factorizations work on the permuted matrices P*A*P^T, whose values are moved 
+    // in and out of the fixed pattern through the precomputed slot maps.
+    bool _use_amd = false;
+    PermutationMatrix<Dynamic, Dynamic, int> _perm;
+    SpMat _prec_perm, _cov_perm, _cov_perm_eval;
+    VectorXi _perm_slots, _cov_slots;
 
     // timer helper
     Timer _timer = Timer();
@@ -107,29 +141,108 @@ protected:
     std::string _file_perturbed_cost;
 
     void ldlt_decompose(){
-        _ldlt.compute(_precision);
+        _ei.sp_scatter(_precision, _perm_slots, _prec_perm);
+        _ldlt.factorize(_prec_perm);
         _L = _ldlt.matrixL();
         _Dinv = _ldlt.vectorD().real().cwiseInverse();
         _ei.find_nnz_known_ij(_L, _Rows, _Cols, _Vals);
         // _D = ldlt.vectorD().real();
     }
 
+    /**
+     * @brief The sparsity pattern of the joint precision is the union of the diagonal blocks 
+     * and the scopes of all the factors, so factors coupling non-adjacent states are supported.
+     */
     void construct_sparse_precision(){
-        _precision.setZero();
-        // fill in the precision matrix to the known sparsity pattern
-        if (_num_states == 1){
-            Eigen::MatrixXd block = MatrixXd::Ones(_dim_state, _dim_state);
-            _ei.block_insert_sparse(_precision, 0, 0, _dim_state, _dim_state, block);
-        }else{
-            Eigen::MatrixXd block = MatrixXd::Ones(2*_dim_state, 2*_dim_state);
-            for (int i=0; i<_num_states-1; i++){
-                _ei.block_insert_sparse(_precision, i*_dim_state, i*_dim_state, 2*_dim_state, 2*_dim_state, block);
+        std::vector<Trip> triplets;
+        auto insert_block = [&](int start_row, int start_col, int nrows, int ncols){
+            for (int j=0; j<ncols; j++){
+                for (int i=0; i<nrows; i++){
+                    triplets.emplace_back(start_row+i, start_col+j, 1.0);
+                }
             }
+        };
 
+        for (int i=0; i<_num_states; i++){
+            insert_block(i*_dim_state, i*_dim_state, _dim_state, _dim_state);
         }
-        
-        SpMat lower = _precision.triangularView<Eigen::Lower>();
-        _nnz = _ei.find_nnz(lower, _Rows, _Cols, _Vals); // the Rows and Cols table are fixed since the initialization.
+        for (auto & opt_k : _vec_factors){
+            for (const auto & seg_r : opt_k->block().segments()){
+                for (const auto & seg_c : opt_k->block().segments()){
+                    insert_block(seg_r.first, seg_c.first, seg_r.second, seg_c.second);
+                }
+            }
+        }
+
+        // the fixed pattern shared by all the joint sparse matrices
+        _sp_pattern.resize(_dim, _dim);
+        _sp_pattern.setFromTriplets(triplets.begin(), triplets.end());
+        _sp_pattern.makeCompressed();
+        _ei.sp_shape_as(_sp_pattern, _precision);
+        _ei.sp_shape_as(_sp_pattern, _covariance);
+        _ei.sp_shape_as(_sp_pattern, _Vddmu);
+        _ei.sp_shape_as(_sp_pattern, _dprecision);
+        _ei.sp_shape_as(_sp_pattern, _new_precision);
+        _ei.sp_shape_as(_sp_pattern, _cov_eval);
+
+        analyze_sparsity();
+    }
+
+    /**
+     * @brief Number of nonzeros in the factor L of the pattern under a symmetric permutation.
+     */
+    int symbolic_fill(const PermutationMatrix<Dynamic, Dynamic, int>& P, SpMat& L){
+        // a diagonally dominant matrix in the pattern, so that no entry of L vanishes by pivoting
+        SpMat test = _sp_pattern;
+        _ei.sp_values(test).setConstant(1.0);
+        for (int i=0; i<_dim; i++){
+            test.coeffRef(i, i) = _dim + 1.0;
+        }
+        SpMat test_perm;
+        test_perm = test.twistedBy(P);
+        SparseLDLT ldlt(test_perm);
+        L = ldlt.matrixL();
+        return L.nonZeros();
+    }
+
+    /**
+     * @brief Symbolic analysis done once: choose between the natural and the AMD ordering 
+     * by the fill-in of the factor, then fix the patterns of L and of the permuted matrices.
+     */
+    void analyze_sparsity(){
+        PermutationMatrix<Dynamic, Dynamic, int> P_natural(_dim);
+        P_natural.setIdentity();
+
+        // AMD returns the inverse permutation, same as in Eigen's SimplicialCholeskyBase::ordering
+        PermutationMatrix<Dynamic, Dynamic, int> P_amd_inv;
+        AMDOrdering<int> amd;
+        amd(_sp_pattern, P_amd_inv);
+        PermutationMatrix<Dynamic, Dynamic, int> P_amd = P_amd_inv.inverse();
+
+        SpMat L_natural, L_amd;
+        int fill_natural = symbolic_fill(P_natural, L_natural);
+        int fill_amd = symbolic_fill(P_amd, L_amd);
+
+        // ties keep the natural ordering, which has no fill for chain structures
+        _use_amd = fill_amd < fill_natural;
+        _perm = _use_amd ? P_amd : P_natural;
+        SpMat L = _use_amd ? L_amd : L_natural;
+
+        // the Rows and Cols table of L are fixed since the initialization.
+        SpMat L_sym = L + SpMat(L.transpose());
+        SpMat lower = L_sym.triangularView<Eigen::Lower>();
+        _nnz = _ei.find_nnz(lower, _Rows, _Cols, _Vals);
+
+        _prec_perm = _sp_pattern.twistedBy(_perm);
+        _ei.sp_shape_as(_prec_perm, _prec_perm);
+        _ei.sp_shape_as(L_sym, _cov_perm);
+        _ei.sp_shape_as(L_sym, _cov_perm_eval);
+
+        _perm_slots = _ei.sp_slot_map(_prec_perm, _sp_pattern, _perm.indices());
+        _cov_slots = _ei.sp_slot_map(_cov_perm, _sp_pattern, _perm.indices());
+
+        _ldlt.analyzePattern(_prec_perm);
+        _ldlt_eval.analyzePattern(_prec_perm);
     }
 
 public:
@@ -195,15 +308,43 @@ public:
     inline void inverse_inplace(){
         ldlt_decompose();
 
-        _ei.inv_sparse(_precision, _covariance, _Rows, _Cols, _Vals, _Dinv);
+        _ei.inv_sparse_fixed_pattern(_cov_perm, _Rows, _Cols, _Vals, _Dinv);
+        _ei.sp_gather(_cov_perm, _cov_slots, _covariance);
     }
 
     inline SpMat inverse(const SpMat & mat){
-        SpMat res(_dim, _dim);
-        _ei.inv_sparse(mat, res, _Rows, _Cols, _nnz);
+        SpMat res;
+        _ei.sp_shape_as(_sp_pattern, res);
+        inverse(mat, res);
         return res;
     }
 
+    /**
+     * @brief Sparse inverse of a matrix in the fixed pattern, written into res which is shaped by the same pattern.
+     * The log determinant of mat is kept in _logdet_eval from the same factorization.
+     */
+    inline void inverse(const SpMat & mat, SpMat & res){
+        if (_ei.sp_same_pattern(mat, _sp_pattern)){
+            _ei.sp_scatter(mat, _perm_slots, _prec_perm);
+        }else{
+            SpMat mat_pattern;
+            _ei.sp_shape_as(_sp_pattern, mat_pattern);
+            _ei.sp_project(mat, mat_pattern);
+            _ei.sp_scatter(mat_pattern, _perm_slots, _prec_perm);
+        }
+        _ldlt_eval.factorize(_prec_perm);
+        SpMat L = _ldlt_eval.matrixL();
+        _ei.find_nnz_known_ij(L, _Rows, _Cols, _Vals_eval);
+        _logdet_eval = _ldlt_eval.vectorD().real().array().log().sum();
+        _ei.inv_sparse_fixed_pattern(_cov_perm_eval, _Rows, _Cols, _Vals_eval, _ldlt_eval.vectorD().real().cwiseInverse());
+        _ei.sp_gather(_cov_perm_eval, _cov_slots, res);
+    }
+
+    /**
+     * @brief Whether the symbolic analysis chose the AMD ordering over the natural one.
+     */
+    inline bool use_amd_ordering() const { return _use_amd; }
+
     /**
      * @brief Purturb the mean by a random vector.
      */
@@ -400,6 +541,44 @@ public:
         _res_recorder.print_data(i_iter);}
 
 
+    /**
+     * @brief Memory held by all the factors, in bytes. Cost objects shared among factors are not counted.
+     */
+    inline size_t factors_memory_bytes() const{
+        size_t bytes = 0;
+        for (const auto & p_factor : _vec_factors){
+            bytes += p_factor->memory_bytes();
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief Memory held by the joint sparse matrices in the fixed pattern, in bytes.
+     */
+    inline size_t joint_memory_bytes() const{
+        auto sp_bytes = [](const SpMat & m){
+            return m.nonZeros() * (sizeof(double) + sizeof(int)) + (m.outerSize() + 1) * sizeof(int);
+        };
+        size_t bytes = sp_bytes(_sp_pattern) + sp_bytes(_precision) + sp_bytes(_covariance) + sp_bytes(_Vddmu) 
+                     + sp_bytes(_dprecision) + sp_bytes(_new_precision) + sp_bytes(_cov_eval) 
+                     + sp_bytes(_prec_perm) + sp_bytes(_cov_perm) + sp_bytes(_cov_perm_eval) + sp_bytes(_L);
+        bytes += (_mu.size() + _Vdmu.size() + _Vals.size() + _Vals_eval.size() + _Dinv.size()) * sizeof(double);
+        bytes += (_Rows.size() + _Cols.size() + _perm_slots.size() + _cov_slots.size()) * sizeof(int);
+        return bytes;
+    }
+
+    /**
+     * @brief Print the memory footprint of the factors and of the joint matrices.
+     */
+    inline void memory_report(std::ostream& os = std::cout) const{
+        size_t factor_bytes = factors_memory_bytes();
+        os << "=========== memory report ===========" << endl;
+        os << "number of factors: " << _nfactors << ", states: " << _num_states << endl;
+        os << "factors total (KB): " << factor_bytes / 1024.0 << endl;
+        os << "per factor (bytes): " << (_nfactors > 0 ? factor_bytes / _nfactors : 0) << endl;
+        os << "joint sparse matrices (KB): " << joint_memory_bytes() / 1024.0 << endl;
+    }
+
     inline int dim() const{ return _dim; }   
 
     inline int n_sub_factors() const{ return _nfactors; }
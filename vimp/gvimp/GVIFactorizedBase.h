@@ -53,17 +53,36 @@ namespace vimp{
                 _high_temperature{high_temperature},
                 _mu(_dim),
                 _covariance{MatrixXd::Identity(_dim, _dim)},
-                _precision{MatrixXd::Identity(_dim, _dim)},
-                _dprecision(_dim, _dim),
+                _cov_llt{_covariance},
                 _Vdmu(_dim),
                 _Vddmu(_dim, _dim),
-                _block{state_dim, num_states, start_index, dimension},
-                _Pk(dimension, state_dim*num_states)
+                _block{state_dim, num_states, start_index, dimension}
                 {   
                     _joint_size = state_dim * num_states;
-                    _Pk.setZero();
-                    _Pk.block(0, start_index*state_dim, dimension, dimension) = Eigen::MatrixXd::Identity(dimension, dimension);
                 }        
+
+        /**
+         * @brief Construct a factor whose scope is a general set of (possibly non-adjacent) states.
+         * 
+         * @param states sorted indexes of the states coupled by the factor
+         */
+        GVIFactorizedBase(const std::vector<int>& states, int state_dim, int num_states, 
+                          double temperature=10.0, double high_temperature=100.0, bool is_linear=false):
+                _is_linear{is_linear},
+                _dim{static_cast<int>(states.size())*state_dim},
+                _state_dim{state_dim},
+                _num_states{num_states},
+                _temperature{temperature},
+                _high_temperature{high_temperature},
+                _mu(_dim),
+                _covariance{MatrixXd::Identity(_dim, _dim)},
+                _cov_llt{_covariance},
+                _Vdmu(_dim),
+                _Vddmu(_dim, _dim),
+                _block{state_dim, num_states, states}
+                {   
+                    _joint_size = state_dim * num_states;
+                }
         
     /// public functions
     public:
@@ -74,6 +93,12 @@ namespace vimp{
             _gh->update_P(P); 
         }
 
+        /// update the GH approximator with the current marginal covariance and its Cholesky factor
+        void updateGH(const VectorXd& x){
+            _gh->update_mean(x);
+            _gh->update_P(_covariance, _cov_llt.matrixL()); 
+        }
+
         /**
          * @brief Update the step size
          */
@@ -94,11 +119,33 @@ namespace vimp{
          */
         inline void update_covariance(const MatrixXd& new_cov){ 
             _covariance = new_cov; 
-            _precision = _covariance.inverse();
+            _cov_llt.compute(_covariance);
         }
 
-        inline MatrixXd Pk(){
-            return _Pk;
+        /**
+         * @brief The mapping matrix from the joint to the marginal variables, built on demand from the block offsets.
+         */
+        inline MatrixXd Pk() const{
+            MatrixXd Pk{MatrixXd::Zero(_dim, _joint_size)};
+            int row = 0;
+            for (const auto & seg : _block.segments()){
+                Pk.block(row, seg.first, seg.second, seg.second) = MatrixXd::Identity(seg.second, seg.second);
+                row += seg.second;
+            }
+            return Pk;
+        }
+
+        /**
+         * @brief Approximated heap and object memory owned by the factor, in bytes. 
+         * Cost and robot objects shared among factors are not counted.
+         */
+        virtual size_t memory_bytes() const{
+            size_t n_doubles = _mu.size() + _covariance.size() + _cov_llt.matrixLLT().size() + _Vdmu.size() + _Vddmu.size();
+            size_t bytes = sizeof(*this) + n_doubles * sizeof(double);
+            if (_gh){
+                bytes += _gh->memory_bytes();
+            }
+            return bytes;
         }
 
         /**
@@ -112,8 +159,7 @@ namespace vimp{
          * @brief Update the marginal precision matrix.
          */
         inline void update_precision_from_joint(const SpMat& joint_covariance) {
-            _covariance = extract_cov_from_joint(joint_covariance);
-            _precision = _covariance.inverse();
+            update_covariance(extract_cov_from_joint(joint_covariance));
         }
 
         inline VectorXd extract_mu_from_joint(const VectorXd & joint_mean) {
@@ -131,14 +177,14 @@ namespace vimp{
          */
         virtual void calculate_partial_V(){
             // update the mu and sigma inside the gauss-hermite integrator
-            updateGH(_mu, _covariance);
+            updateGH(_mu);
 
             _Vdmu.setZero();
             _Vddmu.setZero();
 
             /// Integrate for E_q{_Vdmu} 
             _Vdmu = _gh->Integrate(_func_Vmu);
-            _Vdmu = _precision * _Vdmu;
+            _Vdmu = _cov_llt.solve(_Vdmu);
 
             /// Integrate for E_q{phi(x)}
             double E_phi = _gh->Integrate(_func_phi)(0, 0);
@@ -147,11 +193,21 @@ namespace vimp{
             MatrixXd E_xxphi{_gh->Integrate(_func_Vmumu)};
 
             // MatrixXd Vddmu{MatrixXd::Zero(_dim, _dim)};
-            _Vddmu.triangularView<Upper>() = (_precision * E_xxphi * _precision - _precision * E_phi).triangularView<Upper>();
+            _Vddmu.triangularView<Upper>() = precision_sandwich(E_xxphi, E_phi).triangularView<Upper>();
             _Vddmu.triangularView<StrictlyLower>() = _Vddmu.triangularView<StrictlyUpper>().transpose();
 
         }
 
+        /**
+         * @brief Sigma^{-1} * M * Sigma^{-1} - c * Sigma^{-1} for a symmetric M, 
+         * computed as Sigma^{-1} * (M * Sigma^{-1} - c*I) by triangular solves with the Cholesky factor of Sigma.
+         */
+        inline MatrixXd precision_sandwich(const MatrixXd& M, double c) const{
+            MatrixXd M_prec = _cov_llt.solve(M).transpose();
+            M_prec.diagonal().array() -= c;
+            return _cov_llt.solve(M_prec);
+        }
+
         void test_integration(){
             std::cout << "=========== test_integration ===========" << std::endl;
             updateGH(_mu, _covariance);
@@ -167,14 +223,14 @@ namespace vimp{
 
         void calculate_partial_V_GH(){
             // update the mu and sigma inside the gauss-hermite integrator
-            updateGH(_mu, _covariance);
+            updateGH(_mu);
 
             _Vdmu.setZero();
             _Vddmu.setZero();
 
             /// Integrate for E_q{_Vdmu} 
             _Vdmu = _gh->Integrate(_func_Vmu);
-            _Vdmu = _precision * _Vdmu;
+            _Vdmu = _cov_llt.solve(_Vdmu);
 
             /// Integrate for E_q{phi(x)}
             double E_phi = _gh->Integrate(_func_phi)(0, 0);
@@ -182,7 +238,7 @@ namespace vimp{
             /// Integrate for partial V^2 / ddmu_ 
             MatrixXd E_xxphi{_gh->Integrate(_func_Vmumu)};
 
-            _Vddmu.triangularView<Upper>() = (_precision * E_xxphi * _precision - _precision * E_phi).triangularView<Upper>();
+            _Vddmu.triangularView<Upper>() = precision_sandwich(E_xxphi, E_phi).triangularView<Upper>();
             _Vddmu.triangularView<StrictlyLower>() = _Vddmu.triangularView<StrictlyUpper>().transpose();
 
         }
@@ -207,12 +263,12 @@ namespace vimp{
         /**
          * @brief Get the marginal intermediate variable (partial V^2 / par mu / par mu)
          */
-        inline MatrixXd Vddmu() const { return _Vddmu; }
+        inline const MatrixXd& Vddmu() const { return _Vddmu; }
 
         /**
          * @brief Get the marginal intermediate variable partial V / dmu
          */
-        inline VectorXd Vdmu() const { return _Vdmu; }
+        inline const VectorXd& Vdmu() const { return _Vdmu; }
 
         /**
          * @brief Get the joint intermediate variable (partial V / partial mu).
@@ -251,7 +307,17 @@ namespace vimp{
         /**
          * @brief Get the mapping matrix Pk
          */
-        inline TrajectoryBlock block() const {return _block;}
+        inline const TrajectoryBlock& block() const {return _block;}
+
+        /// a test (mean, radius) -> bool on the ball of the quadrature points of a factor
+        using RegionTest = std::function<bool(const VectorXd&, double)>;
+
+        /**
+         * @brief Drop the moments kept from the last integration if the test finds the quadrature ball affected 
+         * by a change of the cost, e.g., a local sdf update. Returns whether they were dropped; 
+         * the factors without kept moments have nothing to drop.
+         */
+        virtual bool invalidate_moments(const RegionTest& affected){ return false; }
 
         /**
          * @brief Get the mean 
@@ -263,8 +329,7 @@ namespace vimp{
          * @brief Get the precision matrix
          */
         inline MatrixXd precision() const{ 
-            assert((_precision - _covariance.inverse()).norm()==0); 
-            return _precision; }
+            return _cov_llt.solve(MatrixXd::Identity(_dim, _dim)); }
 
 
         /**
@@ -350,8 +415,9 @@ namespace vimp{
         MatrixXd _Vddmu;
 
         /// optimization variables
-        MatrixXd _precision, _dprecision;
         MatrixXd _covariance;
+        /// Cholesky factor of the marginal covariance, computed once per covariance update
+        LLT<MatrixXd> _cov_llt;
 
         // Sparse inverser and matrix helpers
         EigenWrapper _ei;
@@ -363,10 +429,8 @@ namespace vimp{
 
         double _temperature, _high_temperature;
         
-        // sparse mapping to sub variables
+        // sparse mapping to sub variables, only the block offsets are stored
         TrajectoryBlock _block;
-
-        MatrixXd _Pk;
         
     };
 
@@ -31,71 +31,62 @@ namespace vimp{
                             double temperature,
                             double high_temperature):
             Base(dimension, dim_state, num_states, start_indx, temperature, high_temperature, true),
-            _linear_factor{linear_factor}
+            _linear_factor{linear_factor},
+            _function{function},
+            _terms{linear_factor.terms()}
             {
-                Base::_func_phi = [this, function, linear_factor](const VectorXd& x){return MatrixXd::Constant(1, 1, function(x, linear_factor) / this->temperature() );};
-                Base::_func_Vmu = [this, function, linear_factor](const VectorXd& x){return (x-Base::_mu) * function(x, linear_factor) / this->temperature();};
-                Base::_func_Vmumu = [this, function, linear_factor](const VectorXd& x){return MatrixXd{(x-Base::_mu) * (x-Base::_mu).transpose() * function(x, linear_factor) / this->temperature() };};
+                bind_integrands();
 
                 using GH = GaussHermite<GHFunction>;
                 Base::_gh = std::make_shared<GH>(GH{6, dimension, Base::_mu, Base::_covariance, Base::_func_phi});
-
-                _target_mean = linear_factor.get_mu();
-                _target_precision = linear_factor.get_precision();
-                _Lambda = linear_factor.get_Lambda();
-                _Psi = linear_factor.get_Psi();
-                _constant = linear_factor.get_Constant();
             }
 
     protected:
         LinearFactor _linear_factor;
+        CostFunction _function;
 
-        MatrixXd _target_mean, _target_precision, _Lambda, _Psi;
+        void bind_integrands(){
+            Base::_func_phi = [this](const VectorXd& x){return MatrixXd::Constant(1, 1, _function(x, _linear_factor) / this->temperature() );};
+            Base::_func_Vmu = [this](const VectorXd& x){return (x-Base::_mu) * _function(x, _linear_factor) / this->temperature();};
+            Base::_func_Vmumu = [this](const VectorXd& x){return MatrixXd{(x-Base::_mu) * (x-Base::_mu).transpose() * _function(x, _linear_factor) / this->temperature() };};
+        }
 
-        double _constant;
+        /// the closed-form terms (target mean and precision, Lambda, Psi), shared among factors with one definition
+        std::shared_ptr<const LinearGaussianTerms> _terms;
 
     public:
-        double constant() const { return _constant; }
+        double constant() const { return _terms->constant; }
+
+        inline const std::shared_ptr<const LinearGaussianTerms>& terms() const { return _terms; }
+
+        size_t memory_bytes() const override{
+            return Base::memory_bytes() + sizeof(LinearFactor);
+        }
 
         /*Calculating phi * (partial V) / (partial mu), and 
          * phi * (partial V^2) / (partial mu * partial mu^T) for Gaussian posterior: closed-form expression:
-         * (partial V) / (partial mu) = Sigma_t{-1} * (mu_k - mu_t)
-         * (partial V^2) / (partial mu)(partial mu^T): higher order moments of a Gaussian.
+         * (partial V) / (partial mu) = 2 * C * Lambda^T * Sigma_t{-1} * (Lambda*mu_k - Psi*mu_t)
+         * (partial V^2) / (partial mu)(partial mu^T) = 2 * C * Lambda^T * Sigma_t{-1} * Lambda, 
+         * where the 4th order moments of the Gaussian cancel with the precision terms.
         */
 
         void calculate_partial_V() override{
-            _Vdmu.setZero();
-            _Vddmu.setZero();
-
-            // helper vectors
-            MatrixXd tmp{MatrixXd::Zero(_dim, _dim)};
+            double scale = 2 * constant() / this->temperature();
 
             // partial V / partial mu           
-            _Vdmu = (2 * _Lambda.transpose() * _target_precision * (_Lambda*_mu - _Psi*_target_mean)) * constant() / this->temperature();
-            
-            MatrixXd AT_precision_A = _Lambda.transpose() * _target_precision * _Lambda;
+            _Vdmu = (_terms->AT_precision_A * _mu - _terms->AT_precision_Psi_mean) * scale;
 
             // partial V^2 / partial mu*mu^T
-            // update tmp matrix
-            for (int i=0; i<(_dim); i++){
-                for (int j=0; j<(_dim); j++) {
-                    for (int k=0; k<(_dim); k++){
-                        for (int l=0; l<(_dim); l++){
-                            tmp(i, j) += (_covariance(i, j) * (_covariance(k, l)) + _covariance(i,k) * (_covariance(j,l)) + _covariance(i,l)*_covariance(j,k))*AT_precision_A(k,l);
-                        }
-                    }
-                }
-            }
-
-            _Vddmu = (_precision * tmp * _precision - _precision * (AT_precision_A*_covariance).trace()) * constant() / this->temperature();
+            _Vddmu = _terms->AT_precision_A * scale;
         }
 
         double fact_cost_value(const VectorXd& joint_mean, const SpMat& joint_cov) override {
             VectorXd mean_k = Base::extract_mu_from_joint(joint_mean);
             MatrixXd Cov_k = Base::extract_cov_from_joint(joint_cov);
 
-            return ((_Lambda.transpose()*_target_precision*_Lambda * Cov_k).trace() + 
-                    (_Lambda*mean_k-_Psi*_target_mean).transpose() * _target_precision * (_Lambda*mean_k-_Psi*_target_mean)) * constant() / this->temperature();
+            VectorXd residual = _terms->Lambda*mean_k - _terms->Psi_target_mean;
+            return (_terms->AT_precision_A.cwiseProduct(Cov_k).sum() + 
+                    residual.dot(_terms->target_precision * residual)) * constant() / this->temperature();
         }
 
     };
@@ -8,6 +8,9 @@
  * @copyright Copyright (c) 2022
  * 
  */
+
+#pragma once
+
 #include "gvimp/GVIFactorizedBase.h"
 
 namespace vimp{
@@ -16,6 +19,9 @@ namespace vimp{
         using Base = GVIFactorizedBase;
         using GHFunction = std::function<MatrixXd(const VectorXd&)>;
         using CostFunction = std::function<double(const VectorXd&, const CostClass&)>;
+        using FreeSpaceTest = std::function<bool(const VectorXd&, double)>;
+        using BatchCostFunction = std::function<void(const MatrixXd&, VectorXd&)>;
+        using CostVersion = std::function<size_t()>;
         public:
             GVIFactorizedNonlinerGH(int dimension,
                                     int dim_state,
@@ -25,16 +31,232 @@ namespace vimp{
                                     int start_indx,
                                     double temperature, 
                                     double high_temperature):
-                Base(dimension, dim_state, num_states, start_indx, temperature, high_temperature){
+                GVIFactorizedNonlinerGH(dimension, dim_state, function, std::make_shared<const CostClass>(cost_class), 
+                                        num_states, start_indx, temperature, high_temperature){}
 
-                Base::_func_phi = [this, function, cost_class, temperature](const VectorXd& x){return MatrixXd{MatrixXd::Constant(1, 1, function(x, cost_class) / this->temperature())};};
-                Base::_func_Vmu = [this, function, cost_class, temperature](const VectorXd& x){return (x-Base::_mu) * function(x, cost_class) / this->temperature() ;};
-                Base::_func_Vmumu = [this, function, cost_class, temperature](const VectorXd& x){return MatrixXd{(x-Base::_mu) * (x-Base::_mu).transpose().eval() * function(x, cost_class) / this->temperature()};};
+            /**
+             * @brief Construct with a cost object shared by reference, e.g., one robot and sdf model for all the collision factors.
+             */
+            GVIFactorizedNonlinerGH(int dimension,
+                                    int dim_state,
+                                    const CostFunction& function, 
+                                    std::shared_ptr<const CostClass> cost_class,
+                                    int num_states,
+                                    int start_indx,
+                                    double temperature, 
+                                    double high_temperature):
+                Base(dimension, dim_state, num_states, start_indx, temperature, high_temperature),
+                _function{function},
+                _cost_class{std::move(cost_class)}{
+
+                bind_integrands();
                 
                 using GH = GaussHermite<GHFunction>;
                 Base::_gh = std::make_shared<GH>(GH{6, dimension, Base::_mu, Base::_covariance, Base::_func_phi});
                 
             }
 
+            /**
+             * @brief Construct a factor whose scope is a general set of (possibly non-adjacent) states, 
+             * e.g., a periodic constraint coupling the first and the last states.
+             */
+            GVIFactorizedNonlinerGH(const std::vector<int>& states,
+                                    int dim_state,
+                                    const CostFunction& function, 
+                                    std::shared_ptr<const CostClass> cost_class,
+                                    int num_states,
+                                    double temperature, 
+                                    double high_temperature):
+                Base(states, dim_state, num_states, temperature, high_temperature),
+                _function{function},
+                _cost_class{std::move(cost_class)}{
+
+                bind_integrands();
+                
+                using GH = GaussHermite<GHFunction>;
+                Base::_gh = std::make_shared<GH>(GH{6, Base::_dim, Base::_mu, Base::_covariance, Base::_func_phi});
+                
+            }
+
+            inline double cost(const VectorXd& x) const { return _function(x, *_cost_class); }
+
+            inline const std::shared_ptr<const CostClass>& cost_class() const { return _cost_class; }
+
+            /**
+             * @brief A conservative test (mean, radius) -> bool which proves that the cost is zero 
+             * in the ball of the radius around the mean, e.g., the collision costs far from the obstacles.
+             */
+            inline void set_free_space_test(const FreeSpaceTest& free_space_test){ _free_space_test = free_space_test; }
+
+            /**
+             * @brief The same cost evaluated for all the quadrature points (dim, n) at once, e.g., 
+             * with one sdf query for the collision spheres of all the points. Replaces the point-wise cost in the integrations.
+             */
+            inline void set_batch_cost(const BatchCostFunction& batch_cost){ _batch_cost = batch_cost; }
+
+            /**
+             * @brief The version of the cost, e.g., RobotSDFBase::sdf_version of the robot of a collision cost. 
+             * The kept moments are dropped when it changes, unless invalidate_moments finds them unaffected by the change.
+             */
+            inline void set_cost_version(const CostVersion& cost_version){ _cost_version = cost_version; }
+
+            /**
+             * @brief The moments are kept while the marginal, the temperature, the quadrature degree and the cost version 
+             * stay the same, e.g., for a replan from the last solution, until invalidate_moments drops them.
+             */
+            void calculate_partial_V() override{
+                if (moments_kept()){
+                    return;
+                }
+                integrate_partial_V();
+                keep_moments();
+            }
+
+            /**
+             * @brief The test must cover all the changes of the cost since the moments were kept: 
+             * the moments it finds unaffected are kept for the current cost version.
+             */
+            bool invalidate_moments(const typename Base::RegionTest& affected) override{
+                if (!_moments_kept){
+                    return false;
+                }
+                if (!affected(Base::_mu, moments_radius())){
+                    _kept_version = cost_version();
+                    return false;
+                }
+                _moments_kept = false;
+                return true;
+            }
+
+            inline void invalidate_moments(){ _moments_kept = false; }
+
+            double fact_cost_value(const VectorXd& joint_mean, const SpMat& joint_cov) override {
+                if (!_free_space_test && !_batch_cost){
+                    return Base::fact_cost_value(joint_mean, joint_cov);
+                }
+
+                VectorXd mean_k = Base::extract_mu_from_joint(joint_mean);
+                MatrixXd Cov_k = Base::extract_cov_from_joint(joint_cov);
+                MatrixXd sqrtP = LLT<MatrixXd>(Cov_k).matrixL();
+                if (quadrature_in_free_space(mean_k, sqrtP)){
+                    return 0.0;
+                }
+
+                Base::_gh->update_mean(mean_k);
+                Base::_gh->update_P(Cov_k, sqrtP);
+                if (_batch_cost){
+                    return integrate_batch_cost(false);
+                }
+                return Base::_gh->Integrate(Base::_func_phi)(0, 0);
+            }
+
+        protected:
+            CostFunction _function;
+            std::shared_ptr<const CostClass> _cost_class;
+            FreeSpaceTest _free_space_test;
+            BatchCostFunction _batch_cost;
+
+            CostVersion _cost_version;
+
+            /// the kept moments and the marginal, temperature, quadrature degree and cost version they were integrated with
+            bool _moments_kept = false;
+            VectorXd _kept_mu;
+            MatrixXd _kept_covariance;
+            double _kept_temperature = 0.0;
+            int _kept_deg = 0;
+            size_t _kept_version = 0;
+
+            /// workspace of the batched integrations
+            MatrixXd _quad_points;
+            VectorXd _quad_weights, _quad_costs;
+            VectorXd _E_xphi;
+            MatrixXd _E_xxphi;
+
+            /**
+             * @brief E[phi], and E[(x-mu) phi], E[(x-mu)(x-mu)^T phi] if moments, 
+             * from one batch evaluation of the cost on the quadrature points of the integrator.
+             */
+            double integrate_batch_cost(bool moments=true){
+                Base::_gh->quadrature(_quad_points, _quad_weights);
+                _batch_cost(_quad_points, _quad_costs);
+                _quad_costs = _quad_costs.cwiseProduct(_quad_weights) / this->temperature();
+                if (moments){
+                    _quad_points.colwise() -= Base::_mu;
+                    _E_xphi.noalias() = _quad_points * _quad_costs;
+                    _E_xxphi.noalias() = _quad_points * _quad_costs.asDiagonal() * _quad_points.transpose();
+                }
+                return _quad_costs.sum();
+            }
+
+            /**
+             * @brief The integration of the moments, skipped in free space.
+             */
+            virtual void integrate_partial_V(){
+                if (quadrature_in_free_space(Base::_mu, Base::_cov_llt.matrixL())){
+                    Base::_Vdmu.setZero();
+                    Base::_Vddmu.setZero();
+                    return;
+                }
+                if (!_batch_cost){
+                    Base::calculate_partial_V();
+                    return;
+                }
+
+                Base::updateGH(Base::_mu);
+                double E_phi = integrate_batch_cost();
+
+                Base::_Vdmu = Base::_cov_llt.solve(_E_xphi);
+                Base::_Vddmu.template triangularView<Upper>() = Base::precision_sandwich(_E_xxphi, E_phi).template triangularView<Upper>();
+                Base::_Vddmu.template triangularView<StrictlyLower>() = Base::_Vddmu.template triangularView<StrictlyUpper>().transpose();
+            }
+
+            inline size_t cost_version() const{
+                return _cost_version ? _cost_version() : 0;
+            }
+
+            inline bool moments_kept() const{
+                return _moments_kept && _kept_temperature == this->temperature() && _kept_deg == Base::_gh->polynomial_deg() &&
+                       _kept_version == cost_version() && _kept_mu == Base::_mu && _kept_covariance == Base::_covariance;
+            }
+
+            inline void keep_moments(){
+                _moments_kept = true;
+                _kept_mu = Base::_mu;
+                _kept_covariance = Base::_covariance;
+                _kept_temperature = this->temperature();
+                _kept_deg = Base::_gh->polynomial_deg();
+                _kept_version = cost_version();
+            }
+
+            /**
+             * @brief The quadrature points mean + sqrtP * xi lie within max|xi| * sum_i |sqrtP.col(i)| of the mean.
+             */
+            inline double quadrature_radius(const MatrixXd& sqrtP) const{
+                return Base::_gh->sigmapts().cwiseAbs().maxCoeff() * sqrtP.colwise().norm().sum();
+            }
+
+            /**
+             * @brief The radius of the quadrature points of the moment integrations around the mean.
+             */
+            virtual double moments_radius(){
+                return quadrature_radius(Base::_cov_llt.matrixL());
+            }
+
+            /**
+             * @brief Whether all the quadrature points are proven to be in the zero-cost region.
+             */
+            bool quadrature_in_free_space(const VectorXd& mean, const MatrixXd& sqrtP){
+                if (!_free_space_test){
+                    return false;
+                }
+                return _free_space_test(mean, quadrature_radius(sqrtP));
+            }
+
+            void bind_integrands(){
+                Base::_func_phi = [this](const VectorXd& x){return MatrixXd{MatrixXd::Constant(1, 1, cost(x) / this->temperature())};};
+                Base::_func_Vmu = [this](const VectorXd& x){return (x-Base::_mu) * cost(x) / this->temperature() ;};
+                Base::_func_Vmumu = [this](const VectorXd& x){return MatrixXd{(x-Base::_mu) * (x-Base::_mu).transpose().eval() * cost(x) / this->temperature()};};
+            }
+
     };
 }
\ No newline at end of file
@@ -0,0 +1,115 @@
+/**
+ * @file GVIFactorizedNonlinerGradGH.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Factorized optimizer for one nonlinear cost class whose gradient and Gauss-Newton Hessian are available, 
+ * e.g., the sdf collision factors. The marginal updates use the first order (Bonnet-Price) identities
+ * E[partial V / partial mu] = E[grad phi], E[partial^2 V / partial mu^2] = E[Hess phi] ~ E[2 J^T J / sigma],
+ * which are accurate with much fewer quadrature points than the zeroth order estimators.
+ * @version 0.1
+ * @date 2023-09-04
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+#pragma once
+
+#include "gvimp/GVIFactorizedNonlinerGH.h"
+
+namespace vimp{
+    template <typename CostClass>
+    class GVIFactorizedNonlinerGradGH : public GVIFactorizedNonlinerGH<CostClass>{
+        using Base = GVIFactorizedNonlinerGH<CostClass>;
+        using GHFunction = std::function<MatrixXd(const VectorXd&)>;
+        using CostFunction = std::function<double(const VectorXd&, const CostClass&)>;
+        /// returns the cost, and fills its gradient and Gauss-Newton Hessian
+        using GradientFunction = std::function<double(const VectorXd&, const CostClass&, VectorXd&, MatrixXd&)>;
+        public:
+            GVIFactorizedNonlinerGradGH(int dimension,
+                                        int dim_state,
+                                        const CostFunction& function, 
+                                        const GradientFunction& gradient_function, 
+                                        std::shared_ptr<const CostClass> cost_class,
+                                        int num_states,
+                                        int start_indx,
+                                        double temperature, 
+                                        double high_temperature,
+                                        int gradient_GH_degree = 2):
+                Base(dimension, dim_state, function, std::move(cost_class), num_states, start_indx, temperature, high_temperature),
+                _gradient_function{gradient_function},
+                _gradient_GH_degree{gradient_GH_degree}{
+                bind_gradient_integrand();
+            }
+
+            /**
+             * @brief The quadrature degree for the gradient integrals. 
+             * A non-positive value uses the same degree as the cost integrals.
+             */
+            inline void set_gradient_GH_degree(int deg){ _gradient_GH_degree = deg; }
+
+            inline int gradient_GH_degree() const { return _gradient_GH_degree; }
+
+        protected:
+            GradientFunction _gradient_function;
+            int _gradient_GH_degree;
+
+            /**
+             * @brief Calculating (partial V) / (partial mu) = E_q[grad phi], and 
+             * (partial V^2) / (partial mu * partial mu^T) = E_q[Hess phi] with the Gauss-Newton Hessian, 
+             * integrated in one pass over the quadrature points.
+             */
+            void integrate_partial_V() override{
+                Base::updateGH(Base::_mu);
+
+                int deg_cost = Base::_gh->polynomial_deg();
+                if (_gradient_GH_degree > 0){
+                    Base::_gh->set_polynomial_deg(_gradient_GH_degree);
+                }
+
+                if (Base::quadrature_in_free_space(Base::_mu, Base::_cov_llt.matrixL())){
+                    Base::_gh->set_polynomial_deg(deg_cost);
+                    Base::_Vdmu.setZero();
+                    Base::_Vddmu.setZero();
+                    return;
+                }
+
+                MatrixXd E_grad_hess{Base::_gh->Integrate(_func_grad_hess)};
+                Base::_gh->set_polynomial_deg(deg_cost);
+
+                Base::_Vdmu = E_grad_hess.col(0);
+                Base::_Vddmu = E_grad_hess.rightCols(Base::_dim);
+                Base::_Vddmu = (Base::_Vddmu + Base::_Vddmu.transpose().eval()) / 2.0;
+            }
+
+            /**
+             * @brief The moments are integrated with the gradient quadrature degree.
+             */
+            double moments_radius() override{
+                if (_gradient_GH_degree <= 0){
+                    return Base::moments_radius();
+                }
+                int deg_cost = Base::_gh->polynomial_deg();
+                Base::_gh->set_polynomial_deg(_gradient_GH_degree);
+                double radius = Base::moments_radius();
+                Base::_gh->set_polynomial_deg(deg_cost);
+                return radius;
+            }
+
+            /// integrand [grad phi, Hess phi], in shape (dim, dim+1)
+            GHFunction _func_grad_hess;
+
+            void bind_gradient_integrand(){
+                _func_grad_hess = [this](const VectorXd& x){
+                    VectorXd grad(Base::_dim);
+                    MatrixXd hess(Base::_dim, Base::_dim);
+                    _gradient_function(x, *Base::_cost_class, grad, hess);
+
+                    MatrixXd grad_hess(Base::_dim, Base::_dim+1);
+                    grad_hess.col(0) = grad;
+                    grad_hess.rightCols(Base::_dim) = hess;
+                    return MatrixXd{grad_hess / this->temperature()};
+                };
+            }
+
+    };
+}
@@ -92,8 +92,7 @@ namespace vimp{
                 
         computeWeights();
 
-        LLT<MatrixXd> lltP(_P);
-        MatrixXd sig{lltP.matrixL()};
+        const MatrixXd& sig = _sqrtP;
 
         VectorXd pt_0(_dim);
         pt_0.setZero();
@@ -128,4 +127,29 @@ namespace vimp{
         return res;
     }
 
+    template <typename Function>
+    void GaussHermite<Function>::quadrature(MatrixXd& points, VectorXd& weights){
+        computeWeights();
+
+        std::vector<int> range_deg;
+        for (int i=0; i<_deg; i++){
+            range_deg.emplace_back(i);
+        }
+        std::vector<int> permutation(_dim);
+        std::vector<std::vector<int>> v_permutations;
+
+        permute_replacing(range_deg, _dim, permutation, 0, v_permutations);
+
+        points.resize(_dim, v_permutations.size());
+        weights.resize(v_permutations.size());
+        for (int k=0; k<static_cast<int>(v_permutations.size()); k++){
+            weights(k) = 1.0;
+            for (int j=0; j<_dim; j++){
+                points(j, k) = _sigmapts(v_permutations[k][j]);
+                weights(k) *= _W(v_permutations[k][j]);
+            }
+        }
+        points = (_sqrtP * points).colwise() + _mean;
+    }
+
 }
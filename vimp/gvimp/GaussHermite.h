@@ -48,6 +48,7 @@ public:
             _dim{dim},
             _mean{mean},
             _P{P},
+            _sqrtP{LLT<MatrixXd>(P).matrixL()},
             _f{func},
             _W{VectorXd::Zero(_deg)},
             _sigmapts{VectorXd::Zero(_deg)}{}
@@ -91,15 +92,37 @@ public:
 
     MatrixXd Integrate();
 
+    /**
+     * @brief All the quadrature points (dim, n_points) and their weights, in the order of Integrate.
+     * For the integrands evaluated in batch, e.g., one sdf query for all the points.
+     */
+    void quadrature(MatrixXd& points, VectorXd& weights);
+
     /**
      * Update member variables
      * */
     inline void update_mean(const VectorXd& mean){ _mean = mean; }
 
-    inline void update_P(const MatrixXd& P){ _P = P; }
+    /**
+     * @brief Update the covariance, the Cholesky factor used for the sigma points is computed once here.
+     */
+    inline void update_P(const MatrixXd& P){ 
+        _P = P; 
+        _sqrtP = LLT<MatrixXd>(_P).matrixL();
+    }
+
+    /**
+     * @brief Update the covariance with its lower Cholesky factor already computed by the caller.
+     */
+    inline void update_P(const MatrixXd& P, const MatrixXd& sqrtP){ 
+        _P = P; 
+        _sqrtP = sqrtP;
+    }
 
     inline void set_polynomial_deg(const int& deg){ _deg = deg; }
 
+    inline int polynomial_deg() const{ return _deg; }
+
     inline void update_dimension(const int& dim){ _dim = dim; }
 
     inline VectorXd mean() const{ return _mean; }
@@ -110,11 +133,19 @@ public:
 
     inline VectorXd sigmapts() { computeSigmaPts(); return _sigmapts;}
 
+    /**
+     * @brief Memory owned by the integrator, in bytes.
+     */
+    inline size_t memory_bytes() const{
+        return sizeof(*this) + (_mean.size() + _P.size() + _sqrtP.size() + _W.size() + _sigmapts.size()) * sizeof(double);
+    }
+
 protected:
     int _deg;
     int _dim;
     VectorXd _mean;
     MatrixXd _P;
+    MatrixXd _sqrtP;
     VectorXd _W;
     VectorXd _sigmapts;
     EigenWrapper _ei;
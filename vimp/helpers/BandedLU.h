@@ -0,0 +1,140 @@
+/**
+ * @file BandedLU.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief LU factorization with partial pivoting of banded matrices, in the band storage of LAPACK's dgbtrf.
+ * The factorization of an n x n matrix with kl sub-diagonals and ku super-diagonals costs O(n*kl*(kl+ku)).
+ * @version 0.1
+ * @date 2023-09-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace vimp{
+
+class BandedLU{
+
+public:
+    BandedLU(){}
+
+    /**
+     * @param n the dimension of the matrix
+     * @param kl the number of sub-diagonals
+     * @param ku the number of super-diagonals
+     */
+    BandedLU(int n, int kl, int ku):
+    _n(n), _kl(kl), _ku(ku), _ab(Eigen::MatrixXd::Zero(2*kl + ku + 1, n)), _ipiv(n, 0){}
+
+    inline int rows() const { return _n; }
+
+    inline int sub_diagonals() const { return _kl; }
+
+    inline int super_diagonals() const { return _ku; }
+
+    /**
+     * @brief Clear the matrix to fill in new coefficients, keeping the storage.
+     */
+    void setZero(){
+        _ab.setZero();
+        _factorized = false;
+    }
+
+    /**
+     * @brief The coefficient (i, j) of the matrix, which has to be in the band |i - j| within (kl, ku).
+     */
+    double& coeffRef(int i, int j){
+        if (i - j > _kl || j - i > _ku || i < 0 || j < 0 || i >= _n || j >= _n){
+            throw std::out_of_range("BandedLU: coefficient out of the band.");
+        }
+        return _ab(_kl + _ku + i - j, j);
+    }
+
+    /**
+     * @brief In-place LU factorization with partial pivoting (dgbtf2). The fill-in of the row swaps
+     * grows U to kl + ku super-diagonals, stored in the first kl rows of the band storage.
+     * @return false if the matrix is singular
+     */
+    bool factorize(){
+        const int kv = _kl + _ku;
+        int ju = 0; // the last column touched by the row swaps so far
+        for (int j=0; j<_n; j++){
+            const int km = std::min(_kl, _n - 1 - j);
+
+            // pivot among the rows j, ..., j+km of column j
+            int jp = 0;
+            _ab.col(j).segment(kv, km + 1).cwiseAbs().maxCoeff(&jp);
+            _ipiv[j] = j + jp;
+            if (_ab(kv + jp, j) == 0.0){
+                _factorized = false;
+                return false;
+            }
+
+            ju = std::max(ju, std::min(j + _ku + jp, _n - 1));
+            if (jp != 0){
+                for (int c=j; c<=ju; c++){
+                    std::swap(_ab(kv + j - c, c), _ab(kv + j + jp - c, c));
+                }
+            }
+
+            // multipliers and the rank one update of the trailing band
+            if (km > 0){
+                _ab.col(j).segment(kv + 1, km) /= _ab(kv, j);
+                for (int c=j+1; c<=ju; c++){
+                    const double u_jc = _ab(kv + j - c, c);
+                    if (u_jc != 0.0){
+                        _ab.col(c).segment(kv + j + 1 - c, km) -= u_jc * _ab.col(j).segment(kv + 1, km);
+                    }
+                }
+            }
+        }
+        _factorized = true;
+        return true;
+    }
+
+    /**
+     * @brief Solve A*x = b with the factorization.
+     */
+    Eigen::VectorXd solve(const Eigen::VectorXd& b) const{
+        if (!_factorized){
+            throw std::runtime_error("BandedLU: solve before a successful factorization.");
+        }
+        const int kv = _kl + _ku;
+        Eigen::VectorXd x{b};
+
+        // L with the row swaps
+        for (int j=0; j<_n; j++){
+            const int km = std::min(_kl, _n - 1 - j);
+            if (_ipiv[j] != j){
+                std::swap(x(j), x(_ipiv[j]));
+            }
+            if (km > 0){
+                x.segment(j + 1, km) -= x(j) * _ab.col(j).segment(kv + 1, km);
+            }
+        }
+
+        // U with kl + ku super-diagonals
+        for (int j=_n-1; j>=0; j--){
+            x(j) /= _ab(kv, j);
+            const int i0 = std::max(0, j - kv);
+            if (j > i0){
+                x.segment(i0, j - i0) -= x(j) * _ab.col(j).segment(kv + i0 - j, j - i0);
+            }
+        }
+        return x;
+    }
+
+private:
+    int _n = 0, _kl = 0, _ku = 0;
+    Eigen::MatrixXd _ab;
+    std::vector<int> _ipiv;
+    bool _factorized = false;
+};
+
+} // namespace vimp
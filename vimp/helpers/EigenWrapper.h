@@ -17,6 +17,9 @@
 #include "helpers/MatrixIO.h"
 #include "helpers/Matrix.h"
 #include <random>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
 
 class Random{
 
@@ -408,6 +411,153 @@ public:
         return mat.block(start_row, start_col, nrows, ncols);
     }
 
+    // ================= Fixed sparsity pattern operations =================
+    /**
+     * @brief Shape X into the sparsity pattern of `pattern` with all values set to zero.
+     * All the matrices shaped by the same pattern share one layout of (outerIndex, innerIndex),
+     * so that their arithmetic reduces to operations on the value arrays.
+     */
+    void sp_shape_as(const SpMat & pattern, SpMat & X){
+        X = pattern;
+        X.makeCompressed();
+        sp_values(X).setZero();
+    }
+
+    /**
+     * @brief A writable view of the value array of a compressed sparse matrix.
+     */
+    inline Eigen::Map<Eigen::VectorXd> sp_values(SpMat & X){
+        return Eigen::Map<Eigen::VectorXd>(X.valuePtr(), X.nonZeros());
+    }
+
+    inline Eigen::Map<const Eigen::VectorXd> sp_values(const SpMat & X){
+        return Eigen::Map<const Eigen::VectorXd>(X.valuePtr(), X.nonZeros());
+    }
+
+    /**
+     * @brief Check whether 2 compressed sparse matrices share the same sparsity pattern.
+     */
+    bool sp_same_pattern(const SpMat & X, const SpMat & Y){
+        if (X.rows()!=Y.rows() || X.cols()!=Y.cols() || X.nonZeros()!=Y.nonZeros()){
+            return false;
+        }
+        if (!X.isCompressed() || !Y.isCompressed()){
+            return false;
+        }
+        for (int k=0; k<=X.outerSize(); k++){
+            if (X.outerIndexPtr()[k] != Y.outerIndexPtr()[k]) return false;
+        }
+        for (int i=0; i<X.nonZeros(); i++){
+            if (X.innerIndexPtr()[i] != Y.innerIndexPtr()[i]) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief res = a*X + b*Y for matrices sharing one fixed pattern.
+     * res must already be shaped into the pattern; no allocation happens.
+     */
+    inline void sp_axpby(double a, const SpMat & X, double b, const SpMat & Y, SpMat & res){
+        assert(X.nonZeros()==Y.nonZeros() && X.nonZeros()==res.nonZeros());
+        sp_values(res) = a * sp_values(X) + b * sp_values(Y);
+    }
+
+    /**
+     * @brief Y = Y + a*X for matrices sharing one fixed pattern.
+     */
+    inline void sp_axpy(double a, const SpMat & X, SpMat & Y){
+        assert(X.nonZeros()==Y.nonZeros());
+        sp_values(Y) += a * sp_values(X);
+    }
+
+    /**
+     * @brief Copy the values of an arbitrary sparse matrix X into the matrix res shaped by a fixed pattern.
+     * Entries of X outside of the pattern are not allowed.
+     */
+    void sp_project(const SpMat & X, SpMat & res){
+        if (sp_same_pattern(X, res)){
+            sp_values(res) = sp_values(X);
+            return;
+        }
+        sp_values(res).setZero();
+        for (int k=0; k<X.outerSize(); k++){
+            int p = res.outerIndexPtr()[k];
+            int p_end = res.outerIndexPtr()[k+1];
+            for (SpMat::InnerIterator it(X, k); it; ++it){
+                while (p < p_end && res.innerIndexPtr()[p] < it.row()){
+                    p++;
+                }
+                if (p == p_end || res.innerIndexPtr()[p] != it.row()){
+                    if (it.value() == 0.0) continue;
+                    throw std::invalid_argument("sp_project: entry out of the fixed sparsity pattern!");
+                }
+                res.valuePtr()[p] = it.value();
+            }
+        }
+    }
+
+    /**
+     * @brief Accumulate a dense block into a matrix shaped by a fixed pattern, X(rows, cols) += block.
+     * The block must be covered by the pattern.
+     */
+    void sp_add_block(SpMat & X, int start_row, int start_col, const Eigen::MatrixXd & block){
+        int nrows = block.rows();
+        for (int j=0; j<block.cols(); j++){
+            int col = start_col + j;
+            const int* begin = X.innerIndexPtr() + X.outerIndexPtr()[col];
+            const int* end = X.innerIndexPtr() + X.outerIndexPtr()[col+1];
+            int p = std::lower_bound(begin, end, start_row) - X.innerIndexPtr();
+            for (int i=0; i<nrows; i++, p++){
+                assert(X.innerIndexPtr()[p] == start_row + i);
+                X.valuePtr()[p] += block(i, j);
+            }
+        }
+    }
+
+    /**
+     * @brief For every stored entry (i, j) of `to`, find the slot of entry (perm(i), perm(j)) in the value array of `from`.
+     * Used to move values between a fixed pattern and its symmetrically permuted counterpart without any search at run time.
+     */
+    Eigen::VectorXi sp_slot_map(const SpMat & from, const SpMat & to, const Eigen::VectorXi & perm){
+        Eigen::VectorXi slots(to.nonZeros());
+        for (int k=0; k<to.outerSize(); k++){
+            for (int p=to.outerIndexPtr()[k]; p<to.outerIndexPtr()[k+1]; p++){
+                int row = perm(to.innerIndexPtr()[p]);
+                int col = perm(k);
+                const int* begin = from.innerIndexPtr() + from.outerIndexPtr()[col];
+                const int* end = from.innerIndexPtr() + from.outerIndexPtr()[col+1];
+                const int* found = std::lower_bound(begin, end, row);
+                if (found == end || *found != row){
+                    throw std::invalid_argument("sp_slot_map: entry out of the sparsity pattern!");
+                }
+                slots(p) = found - from.innerIndexPtr();
+            }
+        }
+        return slots;
+    }
+
+    /**
+     * @brief to.values(slots(k)) = from.values(k), with slots given by sp_slot_map(to, from, perm).
+     */
+    inline void sp_scatter(const SpMat & from, const Eigen::VectorXi & slots, SpMat & to){
+        const double* from_vals = from.valuePtr();
+        double* to_vals = to.valuePtr();
+        for (int k=0; k<slots.size(); k++){
+            to_vals[slots(k)] = from_vals[k];
+        }
+    }
+
+    /**
+     * @brief to.values(k) = from.values(slots(k)), with slots given by sp_slot_map(from, to, perm).
+     */
+    inline void sp_gather(const SpMat & from, const Eigen::VectorXi & slots, SpMat & to){
+        const double* from_vals = from.valuePtr();
+        double* to_vals = to.valuePtr();
+        for (int k=0; k<slots.size(); k++){
+            to_vals[k] = from_vals[slots(k)];
+        }
+    }
+
     Eigen::MatrixXd psd_sqrtm(const Eigen::MatrixXd & m){
         Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> es(m);
         return es.operatorSqrt();
@@ -421,22 +571,20 @@ public:
     /**
      * @brief extract the i_th index from a 3d matrix in shape (rows*cols, nt):
      * return the matrix mat in shape (rows, cols) from the i_th column. 
+     * The copy of the slice only, see slice3d / Matrix3D::slice for the views without copies.
      */
-    void decomp3d(Matrix3D mat3d, Eigen::MatrixXd& mat, 
+    void decomp3d(const Eigen::MatrixXd& mat3d, Eigen::MatrixXd& mat, 
                       int rows, int cols, int i){
-        mat = mat3d.col(i).reshaped(rows, cols);
+        mat = slice3d(mat3d, rows, cols, i);
     }
 
-    Eigen::MatrixXd decomp3d(Matrix3D mat3d, int rows, int cols, int i){
-        Eigen::MatrixXd mat(rows, cols);
-        mat = mat3d.col(i).reshaped(rows, cols);
-        return mat;
+    Eigen::MatrixXd decomp3d(const Eigen::MatrixXd& mat3d, int rows, int cols, int i){
+        return slice3d(mat3d, rows, cols, i);
     }
 
-    void compress3d(Eigen::MatrixXd mat, Matrix3D& mat3d, int i){
-        Eigen::VectorXd column(mat.rows()*mat.cols());
-        column = mat.reshaped(mat.rows()*mat.cols(), 1);
-        mat3d.col(i) = column;
+    template <typename Derived>
+    void compress3d(const Eigen::MatrixBase<Derived>& mat, Eigen::MatrixXd& mat3d, int i){
+        mat3d.col(i) = mat.reshaped(mat.rows()*mat.cols(), 1);
     }
 
     // void compress3d(Matrix3D mat, Matrix3D& mat3d, int i){
@@ -445,23 +593,33 @@ public:
     //     mat3d.col(i) = column;
     // }
 
-    Matrix3D replicate3d(Eigen::MatrixXd mat, const int len){
+    Matrix3D replicate3d(const Eigen::MatrixXd& mat, const int len){
         int rows = mat.rows(), cols = mat.cols();
-        Eigen::MatrixXd mat3 = Eigen::MatrixXd::Zero(rows*cols, len);
-        mat3 = mat.reshaped(rows*cols, 1).replicate(1, len);
+        Matrix3D mat3(rows, cols, len);
+        mat3.colwise() = mat.reshaped();
         return mat3;
     }
 
-    Matrix3D transpose3d(Matrix3D mat3, int rows, int cols){
+    /**
+     * @brief whether all the time slices of a 3d matrix in shape (rows*cols, nt) are exactly equal.
+     */
+    bool is_time_invariant(const Eigen::MatrixXd& mat3d){
+        for (int i=1; i<mat3d.cols(); i++){
+            if (mat3d.col(i) != mat3d.col(0)){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Matrix3D transpose3d(const Matrix3D& mat3, int rows, int cols){
         int len = mat3.cols();
-        MatrixXd mi(rows, cols), miT(cols, rows);
+        Matrix3D mat3T(cols, rows, len);
         
         for (int i=0; i<len; i++){
-            mi = decomp3d(mat3, rows, cols, i);
-            miT = mi.transpose();
-            compress3d(miT, mat3, i);
+            mat3T.slice(i) = mat3.slice(i, rows, cols).transpose();
         }
-        return mat3;
+        return mat3T;
     }
 
     Matrix3D vec2mat3d(const std::vector<Matrix3D>& vec){
@@ -693,7 +851,64 @@ public:
     }
 
 
-    void inv_sparse_1(const SpMat & X, 
+    /**
+     * @brief inverse with known ldlt, writing into X_inv which is already shaped by the
+     * full symmetric sparsity pattern of X. Only existing entries are written, so the storage is reused.
+     */
+    void inv_sparse_fixed_pattern(SpMat & X_inv,
+    const Eigen::VectorXi& Rows,
+    const Eigen::VectorXi& Cols,
+    const Eigen::VectorXd& Vals,
+    const Eigen::VectorXd& Dinv)
+    {
+        int nnz = Rows.rows();
+        sp_values(X_inv).setZero();
+        for (int index=nnz-1; index>=0; index--){ // iterator j, only for nnz in L
+            int j = Rows(index);
+            int k = Cols(index);
+            double cur_val = 0.0;
+
+            if (j==k){ // diagonal
+                cur_val = Dinv(j);
+            }
+            // find upward the starting point for l = k+1
+            int s_indx = index;
+            while(true){
+                if(Cols(s_indx)<k || s_indx==0){
+                    s_indx = s_indx+1;
+                    break;
+                }
+                s_indx -= 1;
+            }
+
+            // iterate downward in L(l\in(k+1,K), k)
+            for (int l_indx=s_indx; l_indx < nnz; l_indx++){
+                if (Cols.coeff(l_indx) > k){
+                    break;
+                }
+
+                int l = Rows(l_indx);
+                if (l > j){
+                    cur_val = cur_val - X_inv.coeff(l, j) * Vals(l_indx);
+                }else{
+                    cur_val = cur_val - X_inv.coeff(j, l) * Vals(l_indx);
+                }
+            }
+            X_inv.coeffRef(j, k) = cur_val;
+        }
+
+        // mirror the strictly lower part into the upper part of the pattern
+        for (int index=0; index<nnz; index++){
+            int j = Rows(index);
+            int k = Cols(index);
+            if (j != k){
+                X_inv.coeffRef(k, j) = X_inv.coeff(j, k);
+            }
+        }
+    }
+
+
+    void inv_sparse_1(const SpMat & X,
     SpMat & X_inv, 
     const Eigen::VectorXi& Rows, 
     const Eigen::VectorXi& Cols, 
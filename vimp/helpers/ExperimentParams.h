@@ -165,7 +165,10 @@ public:
     inline double temperature() const { return _temperature; }
     inline double high_temperature() const { return _high_temperature; }
     inline int max_iter_lowtemp() const { return _max_iter_lowtemp; }
+    inline int sdf_gradient_GH_degree() const { return _sdf_gradient_GH_degree; }
     
+    /// Collision factors use the sdf Jacobians (first order estimators) when the degree is positive.
+    inline void set_sdf_gradient_GH_degree(int deg){ _sdf_gradient_GH_degree = deg; }
     inline void set_temperature(double temperature){ _temperature = temperature; }
     inline void set_high_temperature(double high_temp){ _high_temperature = high_temp; }
     inline void set_boundary_penalties(double boundary_penalties){ _boundary_penalties = boundary_penalties; }
@@ -190,6 +193,7 @@ public:
         << " step size:                 " << this->step_size() << std::endl 
         << " max iterations:            " << this->max_iter() << std::endl 
         << " max iterations lowtemp:    " << this->max_iter_lowtemp() << std::endl 
+        << " sdf gradient GH degree:    " << this->sdf_gradient_GH_degree() << std::endl 
         << " Backtrack ratio:           " << this->backtrack_ratio() << std::endl 
         << " backtrack iterations:      " << this->max_n_backtrack() << std::endl
         << " initial conditions:        " << std::endl;
@@ -201,6 +205,7 @@ public:
 
 protected:    
     int _max_iter_lowtemp;
+    int _sdf_gradient_GH_degree = 0;
     double _coeff_Qc, _initial_precision_factor, _boundary_penalties, _temperature, _high_temperature;
 
 };
@@ -240,6 +245,19 @@ public:
     double sig0() const { return _sig0; }
     double sigT() const { return _sigT; }
     inline double eps() const { return _eps; }
+    inline int backtrack_threads() const { return _backtrack_threads; }
+    inline int n_threads() const { return _n_threads; }
+    inline bool banded_mean() const { return _banded_mean; }
+
+    /// The step sizes of a backtracking iteration are tried concurrently on these threads when not 1, 
+    /// on the hardware concurrency if <= 0.
+    inline void set_backtrack_threads(int n_threads){ _backtrack_threads = n_threads; }
+
+    /// The per-time-step Q/r assembly and linearization loops run on these threads, on the hardware concurrency if <= 0.
+    inline void set_n_threads(int n_threads){ _n_threads = n_threads; }
+
+    /// Solve the means of the linear covariance steering by one banded system instead of shooting through Phi12.
+    inline void set_banded_mean(bool banded){ _banded_mean = banded; }
 
     inline void print_params() override { 
         std::cout << "================ Experiment Parameters for PGCS-MP ================" << std::endl 
@@ -257,11 +275,17 @@ public:
         << " step size:                 " << this->step_size() << std::endl 
         << " max iterations:            " << this->max_iter() << std::endl 
         << " Backtrack ratio:           " << this->backtrack_ratio() << std::endl 
-        << " backtrack iterations:      " << this->max_n_backtrack() << std::endl;
+        << " backtrack iterations:      " << this->max_n_backtrack() << std::endl 
+        << " backtrack threads:         " << this->backtrack_threads() << std::endl 
+        << " time step threads:         " << this->n_threads() << std::endl 
+        << " banded mean:               " << this->banded_mean() << std::endl;
     }
 
 protected:
     double _sig0, _sigT, _eps;
+    int _backtrack_threads = 1;
+    int _n_threads = 1;
+    bool _banded_mean = false;
 
 };
 
@@ -376,6 +376,21 @@ public:
             params.update_sdf_file(sdf_file);
         }
 
+        if (commonParams->first_node("backtrack_threads")){
+            int backtrack_threads = atoi(commonParams->first_node("backtrack_threads")->value());
+            params.set_backtrack_threads(backtrack_threads);
+        }
+
+        if (commonParams->first_node("n_threads")){
+            int n_threads = atoi(commonParams->first_node("n_threads")->value());
+            params.set_n_threads(n_threads);
+        }
+
+        if (commonParams->first_node("banded_mean")){
+            int banded_mean = atoi(commonParams->first_node("banded_mean")->value());
+            params.set_banded_mean(banded_mean != 0);
+        }
+
     }
 
     virtual void read_boundary_conditions(const rapidxml::xml_node<>* paramNode, PGCSParams& params) = 0;
@@ -0,0 +1,341 @@
+/**
+ * @file IncrementalSDF.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief A signed distance field kept in sync with an occupancy grid under local changes.
+ * The intermediate passes of the separable distance transforms (helpers/SDFGenerator.h) are kept, so that
+ * a changed box of the occupancy only recomputes the lines of each pass whose inputs changed:
+ * the lines along y through the box, then the lines along x whose values after the first pass changed,
+ * then the lines along z whose values after the second pass changed. The result is exactly the full transform.
+ * @version 0.1
+ * @date 2023-09-15
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+
+#include "helpers/SDFGenerator.h"
+
+namespace vimp{
+
+/**
+ * @brief A box of grid cells [begin, end) in (row, col, layer).
+ */
+struct SDFRegion{
+    int row_begin = 0, row_end = 0;
+    int col_begin = 0, col_end = 0;
+    int layer_begin = 0, layer_end = 0;
+
+    inline bool empty() const { return row_end <= row_begin || col_end <= col_begin || layer_end <= layer_begin; }
+
+    void extend(int row, int col, int layer){
+        if (empty()){
+            *this = SDFRegion{row, row + 1, col, col + 1, layer, layer + 1};
+            return;
+        }
+        row_begin = std::min(row_begin, row); row_end = std::max(row_end, row + 1);
+        col_begin = std::min(col_begin, col); col_end = std::max(col_end, col + 1);
+        layer_begin = std::min(layer_begin, layer); layer_end = std::max(layer_end, layer + 1);
+    }
+
+    void extend(const SDFRegion& other){
+        if (!other.empty()){
+            extend(other.row_begin, other.col_begin, other.layer_begin);
+            extend(other.row_end - 1, other.col_end - 1, other.layer_end - 1);
+        }
+    }
+};
+
+class IncrementalSDF : public SDFGenerator{
+public:
+    /**
+     * @param occupancy one layer (rows: y, cols: x) per z, a single layer for a planar map
+     */
+    IncrementalSDF(const std::vector<Eigen::MatrixXd>& occupancy, const Eigen::VectorXd& origin, double cell_size,
+                   double threshold=0.75, int n_threads=0):
+    SDFGenerator(threshold, n_threads), _origin(origin), _cell_size(cell_size)
+    {
+        if (occupancy.empty() || origin.size() != (occupancy.size() == 1 ? 2 : 3)){
+            throw std::runtime_error("Inconsistent occupancy grid and origin for the incremental sdf.");
+        }
+        _rows = occupancy[0].rows();
+        _cols = occupancy[0].cols();
+        _layers = occupancy.size();
+        const size_t size = static_cast<size_t>(_rows) * _cols * _layers;
+        _obstacle.resize(size);
+        for (int k=0; k<_layers; k++){
+            if (occupancy[k].rows() != _rows || occupancy[k].cols() != _cols){
+                throw std::runtime_error("Inconsistent layer sizes for the incremental sdf.");
+            }
+            for (int c=0; c<_cols; c++){
+                for (int r=0; r<_rows; r++){
+                    _obstacle[index(r, c, k)] = occupancy[k](r, c) > _threshold;
+                }
+            }
+        }
+        _n_obstacles = std::count(_obstacle.begin(), _obstacle.end(), 1);
+
+        for (Transform& transform : _transforms){
+            transform.passes.assign(_layers > 1 ? 3 : 2, std::vector<double>(size));
+        }
+        _field.assign(_layers, Eigen::MatrixXd(_rows, _cols));
+        update(SDFRegion{0, _rows, 0, _cols, 0, _layers}, true);
+    }
+
+    inline int rows() const { return _rows; }
+    inline int cols() const { return _cols; }
+    inline int layers() const { return _layers; }
+    inline double cell_size() const { return _cell_size; }
+    inline const Eigen::VectorXd& origin() const { return _origin; }
+
+    /**
+     * @brief The field layers (rows: y, cols: x), in the layout of the gpmp2 sdf classes.
+     */
+    inline const std::vector<Eigen::MatrixXd>& field() const { return _field; }
+
+    /**
+     * @brief Replace the occupancy of the box starting at (row, col, layer) by the given layers.
+     * @return the cells whose signed distance changed, empty if none did
+     */
+    SDFRegion update_occupancy(int row, int col, int layer, const std::vector<Eigen::MatrixXd>& occupancy){
+        if (occupancy.empty()){
+            return SDFRegion{};
+        }
+        SDFRegion box{row, row + static_cast<int>(occupancy[0].rows()), col, col + static_cast<int>(occupancy[0].cols()),
+                      layer, layer + static_cast<int>(occupancy.size())};
+        if (box.row_begin < 0 || box.col_begin < 0 || box.layer_begin < 0 ||
+            box.row_end > _rows || box.col_end > _cols || box.layer_end > _layers){
+            throw std::runtime_error("The occupancy update is out of the incremental sdf grid.");
+        }
+
+        SDFRegion changed_occupancy;
+        for (int k=box.layer_begin; k<box.layer_end; k++){
+            const Eigen::MatrixXd& layer_k = occupancy[k - box.layer_begin];
+            if (layer_k.rows() != box.row_end - box.row_begin || layer_k.cols() != box.col_end - box.col_begin){
+                throw std::runtime_error("Inconsistent layer sizes for the occupancy update.");
+            }
+            for (int c=box.col_begin; c<box.col_end; c++){
+                for (int r=box.row_begin; r<box.row_end; r++){
+                    uint8_t obstacle = layer_k(r - box.row_begin, c - box.col_begin) > _threshold;
+                    uint8_t& cell = _obstacle[index(r, c, k)];
+                    if (cell != obstacle){
+                        _n_obstacles += obstacle ? 1 : -1;
+                        cell = obstacle;
+                        changed_occupancy.extend(r, c, k);
+                    }
+                }
+            }
+        }
+        if (changed_occupancy.empty()){
+            return SDFRegion{};
+        }
+        return update(changed_occupancy, false);
+    }
+
+    /**
+     * @brief Planar maps.
+     */
+    SDFRegion update_occupancy(int row, int col, const Eigen::MatrixXd& occupancy){
+        return update_occupancy(row, col, 0, std::vector<Eigen::MatrixXd>{occupancy});
+    }
+
+    /**
+     * @brief The workspace box of the queries whose interpolation reads a cell of the region:
+     * the region grown by one cell. Planar maps span all z.
+     */
+    Eigen::AlignedBox3d region_box(const SDFRegion& region) const{
+        if (region.empty()){
+            return Eigen::AlignedBox3d{};
+        }
+        Eigen::Vector3d lower, upper;
+        lower << _origin(0) + (region.col_begin - 1) * _cell_size, _origin(1) + (region.row_begin - 1) * _cell_size, 0.0;
+        upper << _origin(0) + region.col_end * _cell_size, _origin(1) + region.row_end * _cell_size, 0.0;
+        if (_layers > 1){
+            lower(2) = _origin(2) + (region.layer_begin - 1) * _cell_size;
+            upper(2) = _origin(2) + region.layer_end * _cell_size;
+        }else{
+            lower(2) = -std::numeric_limits<double>::infinity();
+            upper(2) = std::numeric_limits<double>::infinity();
+        }
+        return Eigen::AlignedBox3d{lower, upper};
+    }
+
+protected:
+    Eigen::VectorXd _origin;
+    double _cell_size;
+    int _rows = 0, _cols = 0, _layers = 0;
+
+    std::vector<uint8_t> _obstacle;
+    size_t _n_obstacles = 0;
+    std::vector<Eigen::MatrixXd> _field;
+    bool _constant_field = true;
+
+    /// the squared distances after each pass, to the obstacles and to the free space
+    struct Transform{
+        std::vector<std::vector<double>> passes;
+    };
+    Transform _transforms[2];
+
+    inline size_t index(int r, int c, int k) const{
+        return static_cast<size_t>(r) + static_cast<size_t>(_rows) * (c + static_cast<size_t>(_cols) * k);
+    }
+
+    /**
+     * @brief Recompute the passes downstream of the changed occupancy box, and the field of the changed cells.
+     */
+    SDFRegion update(const SDFRegion& changed_occupancy, bool full){
+        SDFRegion changed;
+        for (int t=0; t<2; t++){
+            changed.extend(update_transform(t, changed_occupancy, full));
+        }
+
+        // without obstacles or without free space the field is constant, as in SDFGenerator
+        if (_n_obstacles == 0 || _n_obstacles == _obstacle.size()){
+            for (Eigen::MatrixXd& layer : _field){
+                layer.setConstant(NO_FEATURE_DISTANCE);
+            }
+            _constant_field = true;
+            return SDFRegion{0, _rows, 0, _cols, 0, _layers};
+        }
+        // leaving the constant field changes all the cells
+        if (_constant_field){
+            changed = SDFRegion{0, _rows, 0, _cols, 0, _layers};
+            _constant_field = false;
+        }
+
+        const std::vector<double>& to_obstacle = _transforms[0].passes.back();
+        const std::vector<double>& to_free = _transforms[1].passes.back();
+        for (int k=changed.layer_begin; k<changed.layer_end; k++){
+            for (int c=changed.col_begin; c<changed.col_end; c++){
+                for (int r=changed.row_begin; r<changed.row_end; r++){
+                    size_t i = index(r, c, k);
+                    _field[k](r, c) = (std::sqrt(to_obstacle[i]) - std::sqrt(to_free[i])) * _cell_size;
+                }
+            }
+        }
+        return changed;
+    }
+
+    /**
+     * @brief Recompute the lines of the passes of one transform (0: to the obstacles, 1: to the free space)
+     * whose inputs changed. Returns the box of the cells whose final squared distance changed.
+     */
+    SDFRegion update_transform(int t, const SDFRegion& box, bool full){
+        std::vector<std::vector<double>>& passes = _transforms[t].passes;
+        const uint8_t feature = t == 0 ? 1 : 0;
+        const size_t layer_size = static_cast<size_t>(_rows) * _cols;
+
+        // pass along y: the lines (c, k) through the changed occupancy
+        std::vector<int> lines;
+        for (int k=box.layer_begin; k<box.layer_end; k++){
+            for (int c=box.col_begin; c<box.col_end; c++){
+                lines.push_back(c + _cols * k);
+            }
+        }
+        std::vector<uint8_t> changed_1(static_cast<size_t>(_rows) * _layers, 0);
+        transform_lines(lines, _rows, 1, changed_1, full,
+            [this](int line){ return index(0, line % _cols, line / _cols); },
+            [this, feature](size_t i){ return _obstacle[i] == feature ? 0.0 : INF; },
+            passes[0],
+            [this](int line, int q){ return static_cast<size_t>(q) + static_cast<size_t>(_rows) * (line / _cols); });
+
+        // pass along x: the lines (r, k) with a changed value after the first pass
+        lines.clear();
+        for (int k=0; k<_layers; k++){
+            for (int r=0; r<_rows; r++){
+                if (changed_1[r + static_cast<size_t>(_rows) * k]){
+                    lines.push_back(r + _rows * k);
+                }
+            }
+        }
+        const std::vector<double>& pass_1 = passes[0];
+        std::vector<uint8_t> changed_2(layer_size, 0);
+        transform_lines(lines, _cols, _rows, changed_2, full,
+            [this](int line){ return index(line % _rows, 0, line / _rows); },
+            [&pass_1](size_t i){ return pass_1[i]; },
+            passes[1],
+            [this](int line, int q){ return static_cast<size_t>(line % _rows) + static_cast<size_t>(_rows) * q; });
+
+        SDFRegion changed;
+        if (_layers == 1){
+            for (int c=0; c<_cols; c++){
+                for (int r=0; r<_rows; r++){
+                    if (changed_2[r + static_cast<size_t>(_rows) * c]){
+                        changed.extend(r, c, 0);
+                    }
+                }
+            }
+            return changed;
+        }
+
+        // pass along z: the lines (r, c) with a changed value after the second pass
+        lines.clear();
+        for (size_t i=0; i<layer_size; i++){
+            if (changed_2[i]){
+                lines.push_back(i);
+            }
+        }
+        const std::vector<double>& pass_2 = passes[1];
+        std::vector<uint8_t> changed_3(layer_size * _layers, 0);
+        transform_lines(lines, _layers, layer_size, changed_3, full,
+            [](int line){ return static_cast<size_t>(line); },
+            [&pass_2](size_t i){ return pass_2[i]; },
+            passes[2],
+            [layer_size](int line, int q){ return static_cast<size_t>(line) + layer_size * q; });
+
+        for (int line : lines){
+            for (int k=0; k<_layers; k++){
+                if (changed_3[line + layer_size * k]){
+                    changed.extend(line % _rows, line / _rows, k);
+                }
+            }
+        }
+        return changed;
+    }
+
+    /**
+     * @brief The 1D transforms of the given lines from the input values into the output pass, split over the threads.
+     * The changed outputs are flagged in changed at flag_index(line, q); all of them if full.
+     */
+    template <typename LineStart, typename Input, typename FlagIndex>
+    void transform_lines(const std::vector<int>& lines, int len, size_t stride, std::vector<uint8_t>& changed, bool full,
+                         const LineStart& line_start, const Input& input, std::vector<double>& output,
+                         const FlagIndex& flag_index) const{
+        std::mutex mutex;
+        parallel_for(lines.size(), _n_threads, [&](int begin, int end){
+            std::vector<double> f(len), d(len), z(len + 1);
+            std::vector<int> v(len);
+            std::vector<std::pair<int, int>> changed_chunk;
+            for (int l=begin; l<end; l++){
+                const int line = lines[l];
+                const size_t start = line_start(line);
+                for (int q=0; q<len; q++){
+                    f[q] = input(start + q*stride);
+                }
+                distance_transform_1d(f.data(), len, d.data(), v.data(), z.data());
+                for (int q=0; q<len; q++){
+                    double& out = output[start + q*stride];
+                    if (full || out != d[q]){
+                        out = d[q];
+                        changed_chunk.emplace_back(line, q);
+                    }
+                }
+            }
+            // the lines of different chunks may flag the same entries
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto& line_q : changed_chunk){
+                changed[flag_index(line_q.first, line_q.second)] = 1;
+            }
+        });
+    }
+
+};
+
+} // namespace vimp
@@ -12,24 +12,83 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <stdexcept>
 
 using namespace Eigen;
 
 namespace vimp{
 
+/**
+ * @brief Zero-copy view of the time slice i of a time-indexed matrix in shape (rows*cols, nt), as a (rows, cols) matrix.
+ */
+inline Eigen::Map<MatrixXd> slice3d(MatrixXd& mat3d, int rows, int cols, int i){
+    return Eigen::Map<MatrixXd>(mat3d.col(i).data(), rows, cols);
+}
+
+inline Eigen::Map<const MatrixXd> slice3d(const MatrixXd& mat3d, int rows, int cols, int i){
+    return Eigen::Map<const MatrixXd>(mat3d.col(i).data(), rows, cols);
+}
+
+/**
+ * @brief A time-indexed matrix: the (rows, cols) matrix of time i is stored column-major in the column i.
+ * The slice shape is known when constructed with (rows, cols, nt) or copied from a Matrix3D; constructing from or 
+ * assigning a MatrixXd drops it. slice(i, rows, cols) works on any shape.
+ */
 class Matrix3D : public MatrixXd{
 public:
     Matrix3D(){}
-    Matrix3D(int row, int col, int nt):MatrixXd(row*col, nt) {}    
-    Matrix3D(const Matrix3D& mat): Eigen::MatrixXd(mat) {}
+    Matrix3D(int row, int col, int nt):MatrixXd(row*col, nt), _slice_rows(row), _slice_cols(col) {}    
+    Matrix3D(const Matrix3D& mat): Eigen::MatrixXd(mat), _slice_rows(mat._slice_rows), _slice_cols(mat._slice_cols) {}
     Matrix3D(const MatrixXd & mat): MatrixXd(mat){}
 
+    Matrix3D& operator=(const Matrix3D& other){
+        Eigen::MatrixXd::operator=(other);
+        _slice_rows = other._slice_rows;
+        _slice_cols = other._slice_cols;
+        return *this;
+    }
+
     // Overloaded assignment operator that takes an Eigen::MatrixXd as input
     Matrix3D& operator=(const Eigen::MatrixXd& other) {
         Eigen::MatrixXd::operator=(other); // call base class assignment operator
-        // additional custom logic for MyMatrix
+        // a plain matrix does not know its slice shape
+        _slice_rows = 0;
+        _slice_cols = 0;
         return *this;
     }
+
+    /**
+     * @brief Zero-copy views of the time slice i, valid until the matrix is resized.
+     */
+    inline Eigen::Map<MatrixXd> slice(int i){
+        check_slice_shape();
+        return slice3d(*this, _slice_rows, _slice_cols, i);
+    }
+
+    inline Eigen::Map<const MatrixXd> slice(int i) const{
+        check_slice_shape();
+        return slice3d(*this, _slice_rows, _slice_cols, i);
+    }
+
+    inline Eigen::Map<MatrixXd> slice(int i, int rows, int cols){
+        return slice3d(*this, rows, cols, i);
+    }
+
+    inline Eigen::Map<const MatrixXd> slice(int i, int rows, int cols) const{
+        return slice3d(*this, rows, cols, i);
+    }
+
+    inline int slice_rows() const { return _slice_rows; }
+    inline int slice_cols() const { return _slice_cols; }
+
+protected:
+    int _slice_rows = 0, _slice_cols = 0;
+
+    inline void check_slice_shape() const{
+        if (_slice_rows * _slice_cols != rows() || _slice_rows == 0){
+            throw std::runtime_error("Unknown slice shape of the Matrix3D, use slice(i, rows, cols).");
+        }
+    }
     
 };
 
@@ -0,0 +1,71 @@
+/**
+ * @file ParallelFor.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Split a range of independent tasks into contiguous chunks run on std::threads.
+ * The chunks are deterministic in the number of threads, so that each task is always done by one thread.
+ * @version 0.1
+ * @date 2023-09-14
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace vimp{
+
+/**
+ * @brief The number of threads to use: n_threads if positive, otherwise the hardware concurrency.
+ */
+inline int resolve_n_threads(int n_threads){
+    if (n_threads > 0){
+        return n_threads;
+    }
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+/**
+ * @brief Run chunk(begin, end) on the chunks of [0, n), one chunk per thread, the first one on the calling thread.
+ * The first exception thrown by a chunk is rethrown after all the threads are joined.
+ * @param n_threads the number of threads, the hardware concurrency if <= 0
+ */
+inline void parallel_for(int n, int n_threads, const std::function<void(int, int)>& chunk){
+    const int n_chunks = std::min(resolve_n_threads(n_threads), std::max(n, 1));
+    if (n_chunks <= 1){
+        chunk(0, n);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(n_chunks);
+    auto run = [&](int i){
+        const int begin = static_cast<long>(n) * i / n_chunks, end = static_cast<long>(n) * (i + 1) / n_chunks;
+        try{
+            chunk(begin, end);
+        }catch (...){
+            errors[i] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(n_chunks - 1);
+    for (int i=1; i<n_chunks; i++){
+        threads.emplace_back(run, i);
+    }
+    run(0);
+    for (std::thread& thread : threads){
+        thread.join();
+    }
+    for (const std::exception_ptr& error : errors){
+        if (error){
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+} // namespace vimp
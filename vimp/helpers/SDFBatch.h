@@ -0,0 +1,404 @@
+/**
+ * @file SDFBatch.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Batch queries of a signed distance field: bilinear (2D) and trilinear (3D) interpolation
+ * of the distances and their gradients for arrays of points, e.g., all the sphere centers of all the
+ * sigma points or time steps of a trajectory in one call. The grid layout and the interpolation follow
+ * gpmp2::PlanarSDF and gpmp2::SignedDistanceField. With AVX2 (and AVX-512) the queries are evaluated
+ * 4 points at a time with gathers of the cell corners, otherwise by the scalar kernel.
+ *
+ * Points out of the grid have an infinite distance and a zero gradient, i.e., they are free,
+ * consistently with gpmp2::hingeLossObstacleCost which returns zero cost out of the field range.
+ * @version 0.1
+ * @date 2023-09-11
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <Eigen/Dense>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "helpers/SDFFile.h"
+
+namespace vimp{
+
+class BatchSDF{
+public:
+    BatchSDF(){}
+
+    /**
+     * @brief Copy the layers of a field (one layer for a planar map) into one contiguous grid.
+     * @param origin (x, y) or (x, y, z) of the cell (0, 0, 0)
+     * @param layers rows: y, cols: x, one layer per z
+     */
+    BatchSDF(const Eigen::VectorXd& origin, double cell_size, const std::vector<Eigen::MatrixXd>& layers):
+    _dim(origin.size()), _cell_size(cell_size), _origin(Eigen::Vector3d::Zero())
+    {
+        if (layers.empty() || (_dim != 2 && _dim != 3)){
+            throw std::runtime_error("Invalid field for the batch sdf.");
+        }
+        _rows = layers[0].rows();
+        _cols = layers[0].cols();
+        _layers = layers.size();
+        if (_rows < 2 || _cols < 2 || (_dim == 3 && _layers < 2) || (_dim == 2 && _layers != 1)){
+            throw std::runtime_error("The batch sdf needs at least 2 cells in each dimension.");
+        }
+        _origin.head(_dim) = origin;
+
+        _data.resize(static_cast<size_t>(_rows) * _cols * _layers);
+        for (int k=0; k<_layers; k++){
+            if (layers[k].rows() != _rows || layers[k].cols() != _cols){
+                throw std::runtime_error("Inconsistent layer sizes for the batch sdf.");
+            }
+            Eigen::Map<Eigen::MatrixXd>(_data.data() + layer_offset(k), _rows, _cols) = layers[k];
+        }
+    }
+
+    explicit BatchSDF(const MappedSDFFile& file):
+    BatchSDF(file.origin(), file.cell_size(), mapped_layers(file)){}
+
+    inline int dimension() const { return _dim; }
+    inline int rows() const { return _rows; }
+    inline int cols() const { return _cols; }
+    inline int layers() const { return _layers; }
+    inline double cell_size() const { return _cell_size; }
+    inline Eigen::VectorXd origin() const { return _origin.head(_dim); }
+
+    /**
+     * @brief The instruction set of the batch kernels in this build.
+     */
+    static const char* simd_instruction_set(){
+#if defined(__AVX512F__)
+        return "avx512";
+#elif defined(__AVX2__)
+        return "avx2";
+#else
+        return "scalar";
+#endif
+    }
+
+    /**
+     * @brief Signed distances of the points (dim, n).
+     */
+    void signed_distance(const Eigen::Ref<const Eigen::MatrixXd>& points, Eigen::VectorXd& distances) const{
+        check_points(points);
+        distances.resize(points.cols());
+        query<false>(points, distances.data(), nullptr);
+    }
+
+    /**
+     * @brief Signed distances of the points (dim, n) and their gradients (dim, n) wrt the points.
+     */
+    void signed_distance(const Eigen::Ref<const Eigen::MatrixXd>& points,
+                         Eigen::VectorXd& distances,
+                         Eigen::MatrixXd& gradients) const{
+        check_points(points);
+        distances.resize(points.cols());
+        gradients.resize(_dim, points.cols());
+        query<true>(points, distances.data(), gradients.data());
+    }
+
+    /**
+     * @brief Hinge losses max(0, eps_i - d(p_i)) of the points with per-point safety distances (e.g., epsilon + sphere radius).
+     */
+    void hinge_loss(const Eigen::Ref<const Eigen::MatrixXd>& points,
+                    const Eigen::Ref<const Eigen::VectorXd>& eps,
+                    Eigen::VectorXd& hinge) const{
+        signed_distance(points, hinge);
+        hinge = (eps - hinge).cwiseMax(0.0);
+    }
+
+    /**
+     * @brief Hinge losses and their gradients -grad d(p_i) wrt the points, zero where the hinge is inactive.
+     */
+    void hinge_loss(const Eigen::Ref<const Eigen::MatrixXd>& points,
+                    const Eigen::Ref<const Eigen::VectorXd>& eps,
+                    Eigen::VectorXd& hinge,
+                    Eigen::MatrixXd& gradients) const{
+        signed_distance(points, hinge, gradients);
+        for (int j=0; j<hinge.size(); j++){
+            double d = hinge(j);
+            if (d > eps(j)){
+                hinge(j) = 0.0;
+                gradients.col(j).setZero();
+            }else{
+                hinge(j) = eps(j) - d;
+                gradients.col(j) = -gradients.col(j);
+            }
+        }
+    }
+
+protected:
+    int _dim = 0;
+    int _rows = 0, _cols = 0, _layers = 0;
+    double _cell_size = 0.0;
+    Eigen::Vector3d _origin;
+    std::vector<double> _data;
+
+    static constexpr double OUT_OF_RANGE = std::numeric_limits<double>::infinity();
+
+    inline size_t layer_offset(int k) const { return static_cast<size_t>(k) * _rows * _cols; }
+
+    static std::vector<Eigen::MatrixXd> mapped_layers(const MappedSDFFile& file){
+        std::vector<Eigen::MatrixXd> layers;
+        layers.reserve(file.layers());
+        for (int k=0; k<file.layers(); k++){
+            layers.emplace_back(file.layer(k));
+        }
+        return layers;
+    }
+
+    void check_points(const Eigen::Ref<const Eigen::MatrixXd>& points) const{
+        if (points.rows() != _dim){
+            throw std::runtime_error("The batch sdf query points must have the dimension of the field.");
+        }
+    }
+
+    /// The gathers use 32-bit indices
+    inline bool simd_indexable() const{
+        return _data.size() + static_cast<size_t>(_rows) * _cols + _rows < static_cast<size_t>(std::numeric_limits<int>::max());
+    }
+
+    template <bool Gradient>
+    void query(const Eigen::Ref<const Eigen::MatrixXd>& points, double* distances, double* gradients) const{
+        const double* p = points.data();
+        int stride = points.outerStride();
+        int n = points.cols();
+        int begin = 0;
+#if defined(__AVX2__)
+        if (simd_indexable()){
+            if (_dim == 2){
+                begin = query_2d_avx2<Gradient>(p, stride, n, distances, gradients);
+            }else{
+                begin = query_3d_avx2<Gradient>(p, stride, n, distances, gradients);
+            }
+        }
+#endif
+        for (int j=begin; j<n; j++){
+            const double* pj = p + static_cast<size_t>(j) * stride;
+            double* gj = Gradient ? gradients + static_cast<size_t>(j) * _dim : nullptr;
+            distances[j] = _dim == 2 ? query_2d<Gradient>(pj, gj) : query_3d<Gradient>(pj, gj);
+        }
+    }
+
+    /**
+     * @brief Bilinear interpolation at one point, the cell indices as in gpmp2::PlanarSDF: row from y, col from x.
+     * The lower corner is clamped to the last full cell so that the upper boundary of the grid is inside.
+     */
+    template <bool Gradient>
+    inline double query_2d(const double* point, double* gradient) const{
+        double c = (point[0] - _origin(0)) / _cell_size;
+        double r = (point[1] - _origin(1)) / _cell_size;
+        if (!(c >= 0.0 && c <= _cols - 1.0 && r >= 0.0 && r <= _rows - 1.0)){
+            if (Gradient){
+                gradient[0] = 0.0;
+                gradient[1] = 0.0;
+            }
+            return OUT_OF_RANGE;
+        }
+        double lr = std::min(std::floor(r), _rows - 2.0), lc = std::min(std::floor(c), _cols - 2.0);
+        double hr = lr + 1.0, hc = lc + 1.0;
+        const double* v = _data.data() + static_cast<size_t>(lr) + static_cast<size_t>(lc) * _rows;
+        double v00 = v[0], v10 = v[1], v01 = v[_rows], v11 = v[_rows + 1];
+
+        if (Gradient){
+            gradient[0] = ((hr-r)*(v01-v00) + (r-lr)*(v11-v10)) / _cell_size;
+            gradient[1] = ((hc-c)*(v10-v00) + (c-lc)*(v11-v01)) / _cell_size;
+        }
+        return (hr-r)*(hc-c)*v00 + (r-lr)*(hc-c)*v10 + (hr-r)*(c-lc)*v01 + (r-lr)*(c-lc)*v11;
+    }
+
+    /**
+     * @brief Trilinear interpolation at one point, the cell indices as in gpmp2::SignedDistanceField: row from y, col from x, layer from z.
+     */
+    template <bool Gradient>
+    inline double query_3d(const double* point, double* gradient) const{
+        double c = (point[0] - _origin(0)) / _cell_size;
+        double r = (point[1] - _origin(1)) / _cell_size;
+        double z = (point[2] - _origin(2)) / _cell_size;
+        if (!(c >= 0.0 && c <= _cols - 1.0 && r >= 0.0 && r <= _rows - 1.0 && z >= 0.0 && z <= _layers - 1.0)){
+            if (Gradient){
+                gradient[0] = 0.0;
+                gradient[1] = 0.0;
+                gradient[2] = 0.0;
+            }
+            return OUT_OF_RANGE;
+        }
+        double lr = std::min(std::floor(r), _rows - 2.0), lc = std::min(std::floor(c), _cols - 2.0), lz = std::min(std::floor(z), _layers - 2.0);
+        double wr1 = r - lr, wc1 = c - lc, wz1 = z - lz;
+        double wr0 = lr + 1.0 - r, wc0 = lc + 1.0 - c, wz0 = lz + 1.0 - z;
+
+        size_t layer = static_cast<size_t>(_rows) * _cols;
+        const double* v = _data.data() + static_cast<size_t>(lr) + static_cast<size_t>(lc) * _rows + static_cast<size_t>(lz) * layer;
+        double v000 = v[0], v100 = v[1], v010 = v[_rows], v110 = v[_rows + 1];
+        double v001 = v[layer], v101 = v[layer + 1], v011 = v[layer + _rows], v111 = v[layer + _rows + 1];
+
+        // interpolate along the rows, then the cols, then the layers
+        double a00 = wr0*v000 + wr1*v100, a10 = wr0*v010 + wr1*v110;
+        double a01 = wr0*v001 + wr1*v101, a11 = wr0*v011 + wr1*v111;
+        double b0 = wc0*a00 + wc1*a10, b1 = wc0*a01 + wc1*a11;
+
+        if (Gradient){
+            double d00 = v100 - v000, d10 = v110 - v010, d01 = v101 - v001, d11 = v111 - v011;
+            gradient[0] = (wz0*(a10 - a00) + wz1*(a11 - a01)) / _cell_size;
+            gradient[1] = (wz0*(wc0*d00 + wc1*d10) + wz1*(wc0*d01 + wc1*d11)) / _cell_size;
+            gradient[2] = (b1 - b0) / _cell_size;
+        }
+        return wz0*b0 + wz1*b1;
+    }
+
+#if defined(__AVX2__)
+    /**
+     * @brief Lanes out of the grid are moved to the cell (0, 0, 0) so that the gathers stay in the grid,
+     * and are overwritten by OUT_OF_RANGE after the interpolation.
+     */
+    static inline __m256d in_range(__m256d idx, double upper){
+        return _mm256_and_pd(_mm256_cmp_pd(idx, _mm256_setzero_pd(), _CMP_GE_OQ),
+                             _mm256_cmp_pd(idx, _mm256_set1_pd(upper), _CMP_LE_OQ));
+    }
+
+    static inline __m256d lower_corner(__m256d idx, double last_cell){
+        return _mm256_min_pd(_mm256_floor_pd(idx), _mm256_set1_pd(last_cell));
+    }
+
+    static inline __m256d load_coordinate(const double* p, int stride, int k){
+        return _mm256_set_pd(p[3*stride + k], p[2*stride + k], p[stride + k], p[k]);
+    }
+
+    static inline void store_out_of_range(__m256d mask, __m256d value, double* distances){
+        _mm256_storeu_pd(distances, _mm256_blendv_pd(_mm256_set1_pd(OUT_OF_RANGE), value, mask));
+    }
+
+    static inline void store_gradient(__m256d mask, __m256d g, int dim, int k, double* gradients){
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, _mm256_and_pd(g, mask));
+        for (int l=0; l<4; l++){
+            gradients[l*dim + k] = lanes[l];
+        }
+    }
+
+    template <bool Gradient>
+    int query_2d_avx2(const double* p, int stride, int n, double* distances, double* gradients) const{
+        const __m256d cell = _mm256_set1_pd(_cell_size);
+        const __m256d ox = _mm256_set1_pd(_origin(0)), oy = _mm256_set1_pd(_origin(1));
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d rows = _mm256_set1_pd(_rows);
+        const double* data = _data.data();
+
+        int j = 0;
+        for (; j + 4 <= n; j += 4){
+            const double* pj = p + static_cast<size_t>(j) * stride;
+            __m256d c = _mm256_div_pd(_mm256_sub_pd(load_coordinate(pj, stride, 0), ox), cell);
+            __m256d r = _mm256_div_pd(_mm256_sub_pd(load_coordinate(pj, stride, 1), oy), cell);
+            __m256d mask = _mm256_and_pd(in_range(c, _cols - 1.0), in_range(r, _rows - 1.0));
+            c = _mm256_and_pd(c, mask);
+            r = _mm256_and_pd(r, mask);
+
+            __m256d lr = lower_corner(r, _rows - 2.0), lc = lower_corner(c, _cols - 2.0);
+            __m256d hr = _mm256_add_pd(lr, one), hc = _mm256_add_pd(lc, one);
+            __m128i idx = _mm256_cvtpd_epi32(_mm256_add_pd(lr, _mm256_mul_pd(lc, rows)));
+
+            __m256d v00 = _mm256_i32gather_pd(data, idx, 8);
+            __m256d v10 = _mm256_i32gather_pd(data + 1, idx, 8);
+            __m256d v01 = _mm256_i32gather_pd(data + _rows, idx, 8);
+            __m256d v11 = _mm256_i32gather_pd(data + _rows + 1, idx, 8);
+
+            __m256d wr0 = _mm256_sub_pd(hr, r), wr1 = _mm256_sub_pd(r, lr);
+            __m256d wc0 = _mm256_sub_pd(hc, c), wc1 = _mm256_sub_pd(c, lc);
+
+            // same operation order as the scalar kernel
+            __m256d d = _mm256_mul_pd(_mm256_mul_pd(wr0, wc0), v00);
+            d = _mm256_add_pd(d, _mm256_mul_pd(_mm256_mul_pd(wr1, wc0), v10));
+            d = _mm256_add_pd(d, _mm256_mul_pd(_mm256_mul_pd(wr0, wc1), v01));
+            d = _mm256_add_pd(d, _mm256_mul_pd(_mm256_mul_pd(wr1, wc1), v11));
+            store_out_of_range(mask, d, distances + j);
+
+            if (Gradient){
+                __m256d gx = _mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(wr0, _mm256_sub_pd(v01, v00)),
+                                                         _mm256_mul_pd(wr1, _mm256_sub_pd(v11, v10))), cell);
+                __m256d gy = _mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(wc0, _mm256_sub_pd(v10, v00)),
+                                                         _mm256_mul_pd(wc1, _mm256_sub_pd(v11, v01))), cell);
+                double* gj = gradients + static_cast<size_t>(j) * 2;
+                store_gradient(mask, gx, 2, 0, gj);
+                store_gradient(mask, gy, 2, 1, gj);
+            }
+        }
+        return j;
+    }
+
+    template <bool Gradient>
+    int query_3d_avx2(const double* p, int stride, int n, double* distances, double* gradients) const{
+        const __m256d cell = _mm256_set1_pd(_cell_size);
+        const __m256d ox = _mm256_set1_pd(_origin(0)), oy = _mm256_set1_pd(_origin(1)), oz = _mm256_set1_pd(_origin(2));
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d rows = _mm256_set1_pd(_rows);
+        const __m256d layer_size = _mm256_set1_pd(static_cast<double>(_rows) * _cols);
+        const size_t layer = static_cast<size_t>(_rows) * _cols;
+        const double* data = _data.data();
+
+        int j = 0;
+        for (; j + 4 <= n; j += 4){
+            const double* pj = p + static_cast<size_t>(j) * stride;
+            __m256d c = _mm256_div_pd(_mm256_sub_pd(load_coordinate(pj, stride, 0), ox), cell);
+            __m256d r = _mm256_div_pd(_mm256_sub_pd(load_coordinate(pj, stride, 1), oy), cell);
+            __m256d z = _mm256_div_pd(_mm256_sub_pd(load_coordinate(pj, stride, 2), oz), cell);
+            __m256d mask = _mm256_and_pd(_mm256_and_pd(in_range(c, _cols - 1.0), in_range(r, _rows - 1.0)),
+                                         in_range(z, _layers - 1.0));
+            c = _mm256_and_pd(c, mask);
+            r = _mm256_and_pd(r, mask);
+            z = _mm256_and_pd(z, mask);
+
+            __m256d lr = lower_corner(r, _rows - 2.0), lc = lower_corner(c, _cols - 2.0), lz = lower_corner(z, _layers - 2.0);
+            __m256d wr1 = _mm256_sub_pd(r, lr), wc1 = _mm256_sub_pd(c, lc), wz1 = _mm256_sub_pd(z, lz);
+            __m256d wr0 = _mm256_sub_pd(_mm256_add_pd(lr, one), r);
+            __m256d wc0 = _mm256_sub_pd(_mm256_add_pd(lc, one), c);
+            __m256d wz0 = _mm256_sub_pd(_mm256_add_pd(lz, one), z);
+            __m128i idx = _mm256_cvtpd_epi32(_mm256_add_pd(_mm256_add_pd(lr, _mm256_mul_pd(lc, rows)), _mm256_mul_pd(lz, layer_size)));
+
+            __m256d v000 = _mm256_i32gather_pd(data, idx, 8);
+            __m256d v100 = _mm256_i32gather_pd(data + 1, idx, 8);
+            __m256d v010 = _mm256_i32gather_pd(data + _rows, idx, 8);
+            __m256d v110 = _mm256_i32gather_pd(data + _rows + 1, idx, 8);
+            __m256d v001 = _mm256_i32gather_pd(data + layer, idx, 8);
+            __m256d v101 = _mm256_i32gather_pd(data + layer + 1, idx, 8);
+            __m256d v011 = _mm256_i32gather_pd(data + layer + _rows, idx, 8);
+            __m256d v111 = _mm256_i32gather_pd(data + layer + _rows + 1, idx, 8);
+
+            auto lerp = [](__m256d w0, __m256d w1, __m256d a, __m256d b){
+                return _mm256_add_pd(_mm256_mul_pd(w0, a), _mm256_mul_pd(w1, b));
+            };
+            __m256d a00 = lerp(wr0, wr1, v000, v100), a10 = lerp(wr0, wr1, v010, v110);
+            __m256d a01 = lerp(wr0, wr1, v001, v101), a11 = lerp(wr0, wr1, v011, v111);
+            __m256d b0 = lerp(wc0, wc1, a00, a10), b1 = lerp(wc0, wc1, a01, a11);
+            store_out_of_range(mask, lerp(wz0, wz1, b0, b1), distances + j);
+
+            if (Gradient){
+                __m256d gx = _mm256_div_pd(lerp(wz0, wz1, _mm256_sub_pd(a10, a00), _mm256_sub_pd(a11, a01)), cell);
+                __m256d gy = _mm256_div_pd(lerp(wz0, wz1,
+                                                lerp(wc0, wc1, _mm256_sub_pd(v100, v000), _mm256_sub_pd(v110, v010)),
+                                                lerp(wc0, wc1, _mm256_sub_pd(v101, v001), _mm256_sub_pd(v111, v011))), cell);
+                __m256d gz = _mm256_div_pd(_mm256_sub_pd(b1, b0), cell);
+                double* gj = gradients + static_cast<size_t>(j) * 3;
+                store_gradient(mask, gx, 3, 0, gj);
+                store_gradient(mask, gy, 3, 1, gj);
+                store_gradient(mask, gz, 3, 2, gj);
+            }
+        }
+        return j;
+    }
+#endif
+
+};
+
+} // namespace vimp
@@ -0,0 +1,299 @@
+/**
+ * @file SDFBlockGrid.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief A two-level signed distance field: the grid is split into blocks of block_size cells per dimension,
+ * and only the blocks near the obstacle surfaces (any sample within the band distance) keep their fine samples.
+ * Every block keeps the minimum of its samples, which is a lower bound of the interpolated distance anywhere in it.
+ *
+ * Queries in a fine block are the bilinear / trilinear interpolation of helpers/SDFBatch.h (the same values).
+ * Queries in a coarse block return the lower bound and a zero gradient, without touching the fine samples.
+ * Since the bound is larger than the band, the hinge losses max(0, eps - d) are exact for all eps <= band.
+ * @version 0.1
+ * @date 2023-09-13
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "helpers/SDFFile.h"
+
+namespace vimp{
+
+class BlockSDF{
+public:
+    BlockSDF(){}
+
+    /**
+     * @param origin (x, y) or (x, y, z) of the cell (0, 0, 0)
+     * @param layers rows: y, cols: x, one layer per z
+     * @param band the blocks with a sample closer than band keep their fine samples
+     * @param block_size cells per block in each dimension
+     */
+    BlockSDF(const Eigen::VectorXd& origin, double cell_size, const std::vector<Eigen::MatrixXd>& layers,
+             double band, int block_size=8):
+    BlockSDF(origin, cell_size, layers.empty() ? 0 : layers[0].rows(), layers.empty() ? 0 : layers[0].cols(), layers.size(),
+             [&layers](int k) -> Eigen::MatrixXd { return layers[k]; }, band, block_size){}
+
+    /**
+     * @brief Build from a mapped binary sdf file, reading block_size+1 layers at a time,
+     * so that the full grid is never resident.
+     */
+    BlockSDF(const MappedSDFFile& file, double band, int block_size=8):
+    BlockSDF(file.origin(), file.cell_size(), file.rows(), file.cols(), file.layers(),
+             [&file](int k) -> Eigen::MatrixXd { return file.layer(k); }, band, block_size){}
+
+    inline int dimension() const { return _dim; }
+    inline int rows() const { return _rows; }
+    inline int cols() const { return _cols; }
+    inline int layers() const { return _layers; }
+    inline double cell_size() const { return _cell_size; }
+    inline Eigen::VectorXd origin() const { return _origin.head(_dim); }
+    inline double band() const { return _band; }
+    inline int block_size() const { return _block; }
+
+    inline int n_blocks() const { return _block_min.size(); }
+    inline int n_fine_blocks() const { return _fine.size() / _block_samples; }
+
+    /**
+     * @brief The bytes of the fine samples and of the block tables.
+     */
+    inline size_t memory_bytes() const{
+        return _fine.size() * sizeof(double) + _block_min.size() * sizeof(double) + _block_index.size() * sizeof(int32_t);
+    }
+
+    /**
+     * @brief Signed distances of the points (dim, n), the lower bounds in the coarse blocks.
+     */
+    void signed_distance(const Eigen::Ref<const Eigen::MatrixXd>& points, Eigen::VectorXd& distances) const{
+        check_points(points);
+        distances.resize(points.cols());
+        for (int j=0; j<points.cols(); j++){
+            distances(j) = query<false>(points.col(j).data(), nullptr);
+        }
+    }
+
+    /**
+     * @brief Signed distances of the points (dim, n) and their gradients (dim, n), zero in the coarse blocks.
+     */
+    void signed_distance(const Eigen::Ref<const Eigen::MatrixXd>& points,
+                         Eigen::VectorXd& distances,
+                         Eigen::MatrixXd& gradients) const{
+        check_points(points);
+        distances.resize(points.cols());
+        gradients.resize(_dim, points.cols());
+        for (int j=0; j<points.cols(); j++){
+            distances(j) = query<true>(points.col(j).data(), gradients.col(j).data());
+        }
+    }
+
+    /**
+     * @brief Hinge losses max(0, eps_i - d(p_i)) of the points, exact for eps_i <= band.
+     */
+    void hinge_loss(const Eigen::Ref<const Eigen::MatrixXd>& points,
+                    const Eigen::Ref<const Eigen::VectorXd>& eps,
+                    Eigen::VectorXd& hinge) const{
+        check_eps(eps);
+        signed_distance(points, hinge);
+        hinge = (eps - hinge).cwiseMax(0.0);
+    }
+
+    /**
+     * @brief Hinge losses and their gradients -grad d(p_i) wrt the points, zero where the hinge is inactive.
+     */
+    void hinge_loss(const Eigen::Ref<const Eigen::MatrixXd>& points,
+                    const Eigen::Ref<const Eigen::VectorXd>& eps,
+                    Eigen::VectorXd& hinge,
+                    Eigen::MatrixXd& gradients) const{
+        check_eps(eps);
+        signed_distance(points, hinge, gradients);
+        for (int j=0; j<hinge.size(); j++){
+            double d = hinge(j);
+            if (d > eps(j)){
+                hinge(j) = 0.0;
+                gradients.col(j).setZero();
+            }else{
+                hinge(j) = eps(j) - d;
+                gradients.col(j) = -gradients.col(j);
+            }
+        }
+    }
+
+protected:
+    int _dim = 0;
+    int _rows = 0, _cols = 0, _layers = 0;
+    double _cell_size = 0.0;
+    Eigen::Vector3d _origin;
+    double _band = 0.0;
+
+    /// cells per block, and samples per block (block_size+1 per dimension, the shared faces duplicated)
+    int _block = 0, _samples = 0, _block_samples = 0;
+    int _block_rows = 0, _block_cols = 0, _block_layers = 0;
+
+    /// per block: the minimum sample, and the index of the fine samples or -1
+    std::vector<double> _block_min;
+    std::vector<int32_t> _block_index;
+    std::vector<double> _fine;
+
+    static constexpr double OUT_OF_RANGE = std::numeric_limits<double>::infinity();
+
+    BlockSDF(const Eigen::VectorXd& origin, double cell_size, int rows, int cols, int layers,
+             const std::function<Eigen::MatrixXd(int)>& layer, double band, int block_size):
+    _dim(origin.size()), _rows(rows), _cols(cols), _layers(layers), _cell_size(cell_size),
+    _origin(Eigen::Vector3d::Zero()), _band(band), _block(block_size)
+    {
+        if ((_dim != 2 && _dim != 3) || _rows < 2 || _cols < 2 || (_dim == 3 && _layers < 2) || (_dim == 2 && _layers != 1)){
+            throw std::runtime_error("The block sdf needs at least 2 cells in each dimension.");
+        }
+        if (_block < 1){
+            throw std::runtime_error("Invalid block size for the block sdf.");
+        }
+        _origin.head(_dim) = origin;
+        _samples = _block + 1;
+        _block_samples = _dim == 2 ? _samples*_samples : _samples*_samples*_samples;
+        _block_rows = (_rows - 2) / _block + 1;
+        _block_cols = (_cols - 2) / _block + 1;
+        _block_layers = _dim == 2 ? 1 : (_layers - 2) / _block + 1;
+        build(layer);
+    }
+
+    /**
+     * @brief Blocks are built one slab of layers at a time. The samples past the grid repeat the last ones,
+     * they are never interpolated and do not count in the block minimum.
+     */
+    void build(const std::function<Eigen::MatrixXd(int)>& layer){
+        const int n_blocks = _block_rows * _block_cols * _block_layers;
+        _block_min.assign(n_blocks, 0.0);
+        _block_index.assign(n_blocks, -1);
+        _fine.clear();
+
+        const int slab_layers = _dim == 2 ? 1 : _samples;
+        std::vector<Eigen::MatrixXd> slab(slab_layers);
+        std::vector<double> samples(_block_samples);
+        for (int bz=0; bz<_block_layers; bz++){
+            const int z0 = bz * _block;
+            for (int k=0; k<slab_layers; k++){
+                if (z0 + k < _layers){
+                    slab[k] = layer(z0 + k);
+                }
+            }
+            for (int bc=0; bc<_block_cols; bc++){
+                for (int br=0; br<_block_rows; br++){
+                    const int r0 = br * _block, c0 = bc * _block;
+                    double block_min = std::numeric_limits<double>::infinity();
+                    for (int k=0; k<slab_layers; k++){
+                        const int kz = std::min(k, _layers - 1 - z0);
+                        for (int c=0; c<_samples; c++){
+                            const int cc = std::min(c, _cols - 1 - c0);
+                            for (int r=0; r<_samples; r++){
+                                const int rr = std::min(r, _rows - 1 - r0);
+                                const double v = slab[kz](r0 + rr, c0 + cc);
+                                samples[r + _samples*(c + _samples*k)] = v;
+                                if (rr == r && cc == c && kz == k){
+                                    block_min = std::min(block_min, v);
+                                }
+                            }
+                        }
+                    }
+
+                    const int b = block_id(br, bc, bz);
+                    _block_min[b] = block_min;
+                    if (block_min <= _band){
+                        _block_index[b] = n_fine_blocks();
+                        _fine.insert(_fine.end(), samples.begin(), samples.end());
+                    }
+                }
+            }
+        }
+        _fine.shrink_to_fit();
+    }
+
+    inline int block_id(int br, int bc, int bz) const{
+        return br + _block_rows * (bc + _block_cols * bz);
+    }
+
+    void check_points(const Eigen::Ref<const Eigen::MatrixXd>& points) const{
+        if (points.rows() != _dim){
+            throw std::runtime_error("The block sdf query points must have the dimension of the field.");
+        }
+    }
+
+    void check_eps(const Eigen::Ref<const Eigen::VectorXd>& eps) const{
+        if (eps.size() > 0 && eps.maxCoeff() > _band){
+            throw std::runtime_error("The hinge loss safety distances exceed the band of the block sdf.");
+        }
+    }
+
+    /**
+     * @brief The cell indices and the interpolation as in BatchSDF::query_2d and BatchSDF::query_3d,
+     * with the corners read from the fine samples of the block of the cell.
+     */
+    template <bool Gradient>
+    inline double query(const double* point, double* gradient) const{
+        double c = (point[0] - _origin(0)) / _cell_size;
+        double r = (point[1] - _origin(1)) / _cell_size;
+        double z = _dim == 3 ? (point[2] - _origin(2)) / _cell_size : 0.0;
+        if (!(c >= 0.0 && c <= _cols - 1.0 && r >= 0.0 && r <= _rows - 1.0 && z >= 0.0 && z <= _layers - 1.0)){
+            if (Gradient){
+                std::fill(gradient, gradient + _dim, 0.0);
+            }
+            return OUT_OF_RANGE;
+        }
+        double lr = std::min(std::floor(r), _rows - 2.0), lc = std::min(std::floor(c), _cols - 2.0);
+        double lz = _dim == 3 ? std::min(std::floor(z), _layers - 2.0) : 0.0;
+        const int ir = lr, ic = lc, iz = lz;
+        const int br = ir / _block, bc = ic / _block, bz = iz / _block;
+
+        const int b = block_id(br, bc, bz);
+        const int32_t index = _block_index[b];
+        if (index < 0){
+            if (Gradient){
+                std::fill(gradient, gradient + _dim, 0.0);
+            }
+            return _block_min[b];
+        }
+
+        const int row_stride = _samples, layer_stride = _samples * _samples;
+        const double* v = _fine.data() + static_cast<size_t>(index) * _block_samples
+                          + (ir - br*_block) + (ic - bc*_block) * row_stride + (iz - bz*_block) * layer_stride;
+        if (_dim == 2){
+            double hr = lr + 1.0, hc = lc + 1.0;
+            double v00 = v[0], v10 = v[1], v01 = v[row_stride], v11 = v[row_stride + 1];
+            if (Gradient){
+                gradient[0] = ((hr-r)*(v01-v00) + (r-lr)*(v11-v10)) / _cell_size;
+                gradient[1] = ((hc-c)*(v10-v00) + (c-lc)*(v11-v01)) / _cell_size;
+            }
+            return (hr-r)*(hc-c)*v00 + (r-lr)*(hc-c)*v10 + (hr-r)*(c-lc)*v01 + (r-lr)*(c-lc)*v11;
+        }
+
+        double wr1 = r - lr, wc1 = c - lc, wz1 = z - lz;
+        double wr0 = lr + 1.0 - r, wc0 = lc + 1.0 - c, wz0 = lz + 1.0 - z;
+        double v000 = v[0], v100 = v[1], v010 = v[row_stride], v110 = v[row_stride + 1];
+        double v001 = v[layer_stride], v101 = v[layer_stride + 1], v011 = v[layer_stride + row_stride], v111 = v[layer_stride + row_stride + 1];
+
+        double a00 = wr0*v000 + wr1*v100, a10 = wr0*v010 + wr1*v110;
+        double a01 = wr0*v001 + wr1*v101, a11 = wr0*v011 + wr1*v111;
+        double b0 = wc0*a00 + wc1*a10, b1 = wc0*a01 + wc1*a11;
+
+        if (Gradient){
+            double d00 = v100 - v000, d10 = v110 - v010, d01 = v101 - v001, d11 = v111 - v011;
+            gradient[0] = (wz0*(a10 - a00) + wz1*(a11 - a01)) / _cell_size;
+            gradient[1] = (wz0*(wc0*d00 + wc1*d10) + wz1*(wc0*d01 + wc1*d11)) / _cell_size;
+            gradient[2] = (b1 - b0) / _cell_size;
+        }
+        return wz0*b0 + wz1*b1;
+    }
+
+};
+
+} // namespace vimp
@@ -0,0 +1,469 @@
+/**
+ * @file SDFCompact.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief A float32 signed distance field for the batch queries of large maps, with the interface of helpers/SDFBatch.h.
+ * Two storage modes:
+ * 1. distances only (default): half the memory of the double grid, the gradients from the corner differences as in BatchSDF;
+ * 2. distances with precomputed gradients: each voxel holds {d, d(c+1) - d, d(r+1) - d, d(z+1) - d} interleaved
+ * in 16 aligned bytes (4 voxels per cache line), so a cell corner is one load and the gradient of the interpolation
+ * is the interpolation of the stored forward differences, rounded once instead of differences of rounded samples.
+ * It takes twice the memory of the double grid, and is meant for small cells where the float gradients lose digits.
+ *
+ * The interpolation, the gradients and the out of range convention are those of BatchSDF (and gpmp2),
+ * evaluated in double from the float samples.
+ * @version 0.1
+ * @date 2023-09-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "helpers/SDFFile.h"
+
+namespace vimp{
+
+class CompactSDF{
+public:
+    CompactSDF(){}
+
+    /**
+     * @param origin (x, y) or (x, y, z) of the cell (0, 0, 0)
+     * @param layers rows: y, cols: x, one layer per z
+     * @param gradients store the precomputed gradients with the distances
+     */
+    CompactSDF(const Eigen::VectorXd& origin, double cell_size, const std::vector<Eigen::MatrixXd>& layers, bool gradients=false):
+    CompactSDF(origin, cell_size, layers.empty() ? 0 : layers[0].rows(), layers.empty() ? 0 : layers[0].cols(), layers.size(),
+               [&layers](int k) -> Eigen::MatrixXd { return layers[k]; }, gradients){}
+
+    /**
+     * @brief Build from a mapped binary sdf file, 2 layers at a time.
+     */
+    explicit CompactSDF(const MappedSDFFile& file, bool gradients=false):
+    CompactSDF(file.origin(), file.cell_size(), file.rows(), file.cols(), file.layers(),
+               [&file](int k) -> Eigen::MatrixXd { return file.layer(k); }, gradients){}
+
+    inline int dimension() const { return _dim; }
+    inline int rows() const { return _rows; }
+    inline int cols() const { return _cols; }
+    inline int layers() const { return _layers; }
+    inline double cell_size() const { return _cell_size; }
+    inline Eigen::VectorXd origin() const { return _origin.head(_dim); }
+    inline bool has_gradients() const { return _channels == GRADIENT_CHANNELS; }
+
+    inline size_t memory_bytes() const { return _data.size() * sizeof(float); }
+
+    /**
+     * @brief Signed distances of the points (dim, n).
+     */
+    void signed_distance(const Eigen::Ref<const Eigen::MatrixXd>& points, Eigen::VectorXd& distances) const{
+        check_points(points);
+        distances.resize(points.cols());
+        query<false>(points, distances.data(), nullptr);
+    }
+
+    /**
+     * @brief Signed distances of the points (dim, n) and their gradients (dim, n) wrt the points.
+     */
+    void signed_distance(const Eigen::Ref<const Eigen::MatrixXd>& points,
+                         Eigen::VectorXd& distances,
+                         Eigen::MatrixXd& gradients) const{
+        check_points(points);
+        distances.resize(points.cols());
+        gradients.resize(_dim, points.cols());
+        query<true>(points, distances.data(), gradients.data());
+    }
+
+    /**
+     * @brief Hinge losses max(0, eps_i - d(p_i)) of the points with per-point safety distances (e.g., epsilon + sphere radius).
+     */
+    void hinge_loss(const Eigen::Ref<const Eigen::MatrixXd>& points,
+                    const Eigen::Ref<const Eigen::VectorXd>& eps,
+                    Eigen::VectorXd& hinge) const{
+        signed_distance(points, hinge);
+        hinge = (eps - hinge).cwiseMax(0.0);
+    }
+
+    /**
+     * @brief Hinge losses and their gradients -grad d(p_i) wrt the points, zero where the hinge is inactive.
+     */
+    void hinge_loss(const Eigen::Ref<const Eigen::MatrixXd>& points,
+                    const Eigen::Ref<const Eigen::VectorXd>& eps,
+                    Eigen::VectorXd& hinge,
+                    Eigen::MatrixXd& gradients) const{
+        signed_distance(points, hinge, gradients);
+        for (int j=0; j<hinge.size(); j++){
+            double d = hinge(j);
+            if (d > eps(j)){
+                hinge(j) = 0.0;
+                gradients.col(j).setZero();
+            }else{
+                hinge(j) = eps(j) - d;
+                gradients.col(j) = -gradients.col(j);
+            }
+        }
+    }
+
+protected:
+    int _dim = 0;
+    int _rows = 0, _cols = 0, _layers = 0;
+    double _cell_size = 0.0;
+    Eigen::Vector3d _origin;
+
+    /// floats per voxel
+    int _channels = 1;
+    std::vector<float, Eigen::aligned_allocator<float>> _data;
+
+    static constexpr int GRADIENT_CHANNELS = 4;
+    static constexpr double OUT_OF_RANGE = std::numeric_limits<double>::infinity();
+
+    CompactSDF(const Eigen::VectorXd& origin, double cell_size, int rows, int cols, int layers,
+               const std::function<Eigen::MatrixXd(int)>& layer, bool gradients):
+    _dim(origin.size()), _rows(rows), _cols(cols), _layers(layers), _cell_size(cell_size),
+    _origin(Eigen::Vector3d::Zero()), _channels(gradients ? GRADIENT_CHANNELS : 1)
+    {
+        if ((_dim != 2 && _dim != 3) || _rows < 2 || _cols < 2 || (_dim == 3 && _layers < 2) || (_dim == 2 && _layers != 1)){
+            throw std::runtime_error("The compact sdf needs at least 2 cells in each dimension.");
+        }
+        _origin.head(_dim) = origin;
+        build(layer);
+    }
+
+    /**
+     * @brief The forward differences are taken in double before the rounding, 0 past the last sample
+     * where they are never interpolated.
+     */
+    void build(const std::function<Eigen::MatrixXd(int)>& layer){
+        const size_t layer_size = static_cast<size_t>(_rows) * _cols;
+        _data.assign(layer_size * _layers * _channels, 0.0f);
+
+        Eigen::MatrixXd current = layer(0), next;
+        for (int k=0; k<_layers; k++){
+            if (current.rows() != _rows || current.cols() != _cols){
+                throw std::runtime_error("Inconsistent layer sizes for the compact sdf.");
+            }
+            if (k + 1 < _layers){
+                next = layer(k + 1);
+            }
+            float* out = _data.data() + k * layer_size * _channels;
+            for (int c=0; c<_cols; c++){
+                for (int r=0; r<_rows; r++){
+                    float* voxel = out + (static_cast<size_t>(r) + static_cast<size_t>(c) * _rows) * _channels;
+                    const double v = current(r, c);
+                    voxel[0] = static_cast<float>(v);
+                    if (_channels == GRADIENT_CHANNELS){
+                        voxel[1] = c + 1 < _cols ? static_cast<float>(current(r, c + 1) - v) : 0.0f;
+                        voxel[2] = r + 1 < _rows ? static_cast<float>(current(r + 1, c) - v) : 0.0f;
+                        voxel[3] = k + 1 < _layers ? static_cast<float>(next(r, c) - v) : 0.0f;
+                    }
+                }
+            }
+            current.swap(next);
+        }
+    }
+
+    void check_points(const Eigen::Ref<const Eigen::MatrixXd>& points) const{
+        if (points.rows() != _dim){
+            throw std::runtime_error("The compact sdf query points must have the dimension of the field.");
+        }
+    }
+
+    /// The gathers use 32-bit indices
+    inline bool simd_indexable() const{
+        return _data.size() + static_cast<size_t>(_rows) * _cols + _rows < static_cast<size_t>(std::numeric_limits<int>::max());
+    }
+
+    inline const float* voxel(size_t index) const { return _data.data() + index * _channels; }
+
+    template <bool Gradient>
+    void query(const Eigen::Ref<const Eigen::MatrixXd>& points, double* distances, double* gradients) const{
+        const double* p = points.data();
+        int stride = points.outerStride();
+        int n = points.cols();
+        int begin = 0;
+#if defined(__AVX2__)
+        if (simd_indexable()){
+            if (_dim == 2){
+                begin = query_2d_avx2<Gradient>(p, stride, n, distances, gradients);
+            }else{
+                begin = query_3d_avx2<Gradient>(p, stride, n, distances, gradients);
+            }
+        }
+#endif
+        for (int j=begin; j<n; j++){
+            const double* pj = p + static_cast<size_t>(j) * stride;
+            double* gj = Gradient ? gradients + static_cast<size_t>(j) * _dim : nullptr;
+            distances[j] = _dim == 2 ? query_2d<Gradient>(pj, gj) : query_3d<Gradient>(pj, gj);
+        }
+    }
+
+    /**
+     * @brief BatchSDF::query_2d on the float samples. With the stored forward differences
+     * X = d(c+1) - d and Y = d(r+1) - d, the gradient is ((hr-r)*X00 + (r-lr)*X10, (hc-c)*Y00 + (c-lc)*Y01) / cell_size.
+     */
+    template <bool Gradient>
+    inline double query_2d(const double* point, double* gradient) const{
+        double c = (point[0] - _origin(0)) / _cell_size;
+        double r = (point[1] - _origin(1)) / _cell_size;
+        if (!(c >= 0.0 && c <= _cols - 1.0 && r >= 0.0 && r <= _rows - 1.0)){
+            if (Gradient){
+                gradient[0] = 0.0;
+                gradient[1] = 0.0;
+            }
+            return OUT_OF_RANGE;
+        }
+        double lr = std::min(std::floor(r), _rows - 2.0), lc = std::min(std::floor(c), _cols - 2.0);
+        double hr = lr + 1.0, hc = lc + 1.0;
+        const size_t col = static_cast<size_t>(_rows) * _channels;
+        const float* v = voxel(static_cast<size_t>(lr) + static_cast<size_t>(lc) * _rows);
+        double v00 = v[0], v10 = v[_channels], v01 = v[col], v11 = v[col + _channels];
+
+        if (Gradient){
+            if (_channels == GRADIENT_CHANNELS){
+                gradient[0] = ((hr-r)*double(v[1]) + (r-lr)*double(v[_channels + 1])) / _cell_size;
+                gradient[1] = ((hc-c)*double(v[2]) + (c-lc)*double(v[col + 2])) / _cell_size;
+            }else{
+                gradient[0] = ((hr-r)*(v01-v00) + (r-lr)*(v11-v10)) / _cell_size;
+                gradient[1] = ((hc-c)*(v10-v00) + (c-lc)*(v11-v01)) / _cell_size;
+            }
+        }
+        return (hr-r)*(hc-c)*v00 + (r-lr)*(hc-c)*v10 + (hr-r)*(c-lc)*v01 + (r-lr)*(c-lc)*v11;
+    }
+
+    /**
+     * @brief BatchSDF::query_3d on the float samples. Each gradient component interpolates the forward differences
+     * along it over the other 2 dimensions, on the 4 corners at the lower side of the cell.
+     */
+    template <bool Gradient>
+    inline double query_3d(const double* point, double* gradient) const{
+        double c = (point[0] - _origin(0)) / _cell_size;
+        double r = (point[1] - _origin(1)) / _cell_size;
+        double z = (point[2] - _origin(2)) / _cell_size;
+        if (!(c >= 0.0 && c <= _cols - 1.0 && r >= 0.0 && r <= _rows - 1.0 && z >= 0.0 && z <= _layers - 1.0)){
+            if (Gradient){
+                gradient[0] = 0.0;
+                gradient[1] = 0.0;
+                gradient[2] = 0.0;
+            }
+            return OUT_OF_RANGE;
+        }
+        double lr = std::min(std::floor(r), _rows - 2.0), lc = std::min(std::floor(c), _cols - 2.0), lz = std::min(std::floor(z), _layers - 2.0);
+        double wr1 = r - lr, wc1 = c - lc, wz1 = z - lz;
+        double wr0 = lr + 1.0 - r, wc0 = lc + 1.0 - c, wz0 = lz + 1.0 - z;
+
+        const size_t row = _channels, col = static_cast<size_t>(_rows) * _channels, layer = static_cast<size_t>(_rows) * _cols * _channels;
+        const float* v = voxel(static_cast<size_t>(lr) + static_cast<size_t>(lc) * _rows + static_cast<size_t>(lz) * _rows * _cols);
+        const float *p000 = v, *p100 = v + row, *p010 = v + col, *p110 = v + col + row;
+        const float *p001 = v + layer, *p101 = v + layer + row, *p011 = v + layer + col, *p111 = v + layer + col + row;
+        double v000 = p000[0], v100 = p100[0], v010 = p010[0], v110 = p110[0];
+        double v001 = p001[0], v101 = p101[0], v011 = p011[0], v111 = p111[0];
+
+        double a00 = wr0*v000 + wr1*v100, a10 = wr0*v010 + wr1*v110;
+        double a01 = wr0*v001 + wr1*v101, a11 = wr0*v011 + wr1*v111;
+        double b0 = wc0*a00 + wc1*a10, b1 = wc0*a01 + wc1*a11;
+
+        if (Gradient){
+            if (_channels == GRADIENT_CHANNELS){
+                gradient[0] = (wz0*(wr0*double(p000[1]) + wr1*double(p100[1])) + wz1*(wr0*double(p001[1]) + wr1*double(p101[1]))) / _cell_size;
+                gradient[1] = (wz0*(wc0*double(p000[2]) + wc1*double(p010[2])) + wz1*(wc0*double(p001[2]) + wc1*double(p011[2]))) / _cell_size;
+                gradient[2] = (wc0*(wr0*double(p000[3]) + wr1*double(p100[3])) + wc1*(wr0*double(p010[3]) + wr1*double(p110[3]))) / _cell_size;
+            }else{
+                double d00 = v100 - v000, d10 = v110 - v010, d01 = v101 - v001, d11 = v111 - v011;
+                gradient[0] = (wz0*(a10 - a00) + wz1*(a11 - a01)) / _cell_size;
+                gradient[1] = (wz0*(wc0*d00 + wc1*d10) + wz1*(wc0*d01 + wc1*d11)) / _cell_size;
+                gradient[2] = (b1 - b0) / _cell_size;
+            }
+        }
+        return wz0*b0 + wz1*b1;
+    }
+
+#if defined(__AVX2__)
+    /**
+     * @brief The samples of a cell corner for 4 points, in double. Without the stored gradients one float gather,
+     * with them one aligned load of the voxel per point, transposed into the channels.
+     */
+    struct Corner4{
+        __m256d d, x, y, z;
+    };
+
+    inline Corner4 load_corner(__m128i idx, const int* lanes, size_t offset) const{
+        Corner4 corner;
+        if (_channels != GRADIENT_CHANNELS){
+            corner.d = _mm256_cvtps_pd(_mm_i32gather_ps(_data.data() + offset, idx, 4));
+            return corner;
+        }
+        const float* data = _data.data() + offset * GRADIENT_CHANNELS;
+        __m128 v0 = _mm_load_ps(data + static_cast<size_t>(lanes[0]) * GRADIENT_CHANNELS);
+        __m128 v1 = _mm_load_ps(data + static_cast<size_t>(lanes[1]) * GRADIENT_CHANNELS);
+        __m128 v2 = _mm_load_ps(data + static_cast<size_t>(lanes[2]) * GRADIENT_CHANNELS);
+        __m128 v3 = _mm_load_ps(data + static_cast<size_t>(lanes[3]) * GRADIENT_CHANNELS);
+        _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+        corner.d = _mm256_cvtps_pd(v0);
+        corner.x = _mm256_cvtps_pd(v1);
+        corner.y = _mm256_cvtps_pd(v2);
+        corner.z = _mm256_cvtps_pd(v3);
+        return corner;
+    }
+
+    static inline __m256d in_range(__m256d idx, double upper){
+        return _mm256_and_pd(_mm256_cmp_pd(idx, _mm256_setzero_pd(), _CMP_GE_OQ),
+                             _mm256_cmp_pd(idx, _mm256_set1_pd(upper), _CMP_LE_OQ));
+    }
+
+    static inline __m256d lower_corner(__m256d idx, double last_cell){
+        return _mm256_min_pd(_mm256_floor_pd(idx), _mm256_set1_pd(last_cell));
+    }
+
+    static inline __m256d load_coordinate(const double* p, int stride, int k){
+        return _mm256_set_pd(p[3*stride + k], p[2*stride + k], p[stride + k], p[k]);
+    }
+
+    static inline __m256d lerp(__m256d w0, __m256d w1, __m256d a, __m256d b){
+        return _mm256_add_pd(_mm256_mul_pd(w0, a), _mm256_mul_pd(w1, b));
+    }
+
+    static inline void store_out_of_range(__m256d mask, __m256d value, double* distances){
+        _mm256_storeu_pd(distances, _mm256_blendv_pd(_mm256_set1_pd(OUT_OF_RANGE), value, mask));
+    }
+
+    static inline void store_gradient(__m256d mask, __m256d g, int dim, int k, double* gradients){
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, _mm256_and_pd(g, mask));
+        for (int l=0; l<4; l++){
+            gradients[l*dim + k] = lanes[l];
+        }
+    }
+
+    template <bool Gradient>
+    int query_2d_avx2(const double* p, int stride, int n, double* distances, double* gradients) const{
+        const __m256d cell = _mm256_set1_pd(_cell_size);
+        const __m256d ox = _mm256_set1_pd(_origin(0)), oy = _mm256_set1_pd(_origin(1));
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d rows = _mm256_set1_pd(_rows);
+        const bool stored_gradients = _channels == GRADIENT_CHANNELS;
+        alignas(16) int lanes[4];
+
+        int j = 0;
+        for (; j + 4 <= n; j += 4){
+            const double* pj = p + static_cast<size_t>(j) * stride;
+            __m256d c = _mm256_div_pd(_mm256_sub_pd(load_coordinate(pj, stride, 0), ox), cell);
+            __m256d r = _mm256_div_pd(_mm256_sub_pd(load_coordinate(pj, stride, 1), oy), cell);
+            __m256d mask = _mm256_and_pd(in_range(c, _cols - 1.0), in_range(r, _rows - 1.0));
+            c = _mm256_and_pd(c, mask);
+            r = _mm256_and_pd(r, mask);
+
+            __m256d lr = lower_corner(r, _rows - 2.0), lc = lower_corner(c, _cols - 2.0);
+            __m256d hr = _mm256_add_pd(lr, one), hc = _mm256_add_pd(lc, one);
+            __m128i idx = _mm256_cvtpd_epi32(_mm256_add_pd(lr, _mm256_mul_pd(lc, rows)));
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), idx);
+
+            Corner4 c00 = load_corner(idx, lanes, 0), c10 = load_corner(idx, lanes, 1);
+            Corner4 c01 = load_corner(idx, lanes, _rows), c11 = load_corner(idx, lanes, _rows + 1);
+
+            __m256d wr0 = _mm256_sub_pd(hr, r), wr1 = _mm256_sub_pd(r, lr);
+            __m256d wc0 = _mm256_sub_pd(hc, c), wc1 = _mm256_sub_pd(c, lc);
+
+            // same operation order as the scalar kernel
+            __m256d d = _mm256_mul_pd(_mm256_mul_pd(wr0, wc0), c00.d);
+            d = _mm256_add_pd(d, _mm256_mul_pd(_mm256_mul_pd(wr1, wc0), c10.d));
+            d = _mm256_add_pd(d, _mm256_mul_pd(_mm256_mul_pd(wr0, wc1), c01.d));
+            d = _mm256_add_pd(d, _mm256_mul_pd(_mm256_mul_pd(wr1, wc1), c11.d));
+            store_out_of_range(mask, d, distances + j);
+
+            if (Gradient){
+                __m256d gx, gy;
+                if (stored_gradients){
+                    gx = _mm256_div_pd(lerp(wr0, wr1, c00.x, c10.x), cell);
+                    gy = _mm256_div_pd(lerp(wc0, wc1, c00.y, c01.y), cell);
+                }else{
+                    gx = _mm256_div_pd(lerp(wr0, wr1, _mm256_sub_pd(c01.d, c00.d), _mm256_sub_pd(c11.d, c10.d)), cell);
+                    gy = _mm256_div_pd(lerp(wc0, wc1, _mm256_sub_pd(c10.d, c00.d), _mm256_sub_pd(c11.d, c01.d)), cell);
+                }
+                double* gj = gradients + static_cast<size_t>(j) * 2;
+                store_gradient(mask, gx, 2, 0, gj);
+                store_gradient(mask, gy, 2, 1, gj);
+            }
+        }
+        return j;
+    }
+
+    template <bool Gradient>
+    int query_3d_avx2(const double* p, int stride, int n, double* distances, double* gradients) const{
+        const __m256d cell = _mm256_set1_pd(_cell_size);
+        const __m256d ox = _mm256_set1_pd(_origin(0)), oy = _mm256_set1_pd(_origin(1)), oz = _mm256_set1_pd(_origin(2));
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d rows = _mm256_set1_pd(_rows);
+        const __m256d layer_size = _mm256_set1_pd(static_cast<double>(_rows) * _cols);
+        const size_t layer = static_cast<size_t>(_rows) * _cols;
+        const bool stored_gradients = _channels == GRADIENT_CHANNELS;
+        alignas(16) int lanes[4];
+
+        int j = 0;
+        for (; j + 4 <= n; j += 4){
+            const double* pj = p + static_cast<size_t>(j) * stride;
+            __m256d c = _mm256_div_pd(_mm256_sub_pd(load_coordinate(pj, stride, 0), ox), cell);
+            __m256d r = _mm256_div_pd(_mm256_sub_pd(load_coordinate(pj, stride, 1), oy), cell);
+            __m256d z = _mm256_div_pd(_mm256_sub_pd(load_coordinate(pj, stride, 2), oz), cell);
+            __m256d mask = _mm256_and_pd(_mm256_and_pd(in_range(c, _cols - 1.0), in_range(r, _rows - 1.0)),
+                                         in_range(z, _layers - 1.0));
+            c = _mm256_and_pd(c, mask);
+            r = _mm256_and_pd(r, mask);
+            z = _mm256_and_pd(z, mask);
+
+            __m256d lr = lower_corner(r, _rows - 2.0), lc = lower_corner(c, _cols - 2.0), lz = lower_corner(z, _layers - 2.0);
+            __m256d wr1 = _mm256_sub_pd(r, lr), wc1 = _mm256_sub_pd(c, lc), wz1 = _mm256_sub_pd(z, lz);
+            __m256d wr0 = _mm256_sub_pd(_mm256_add_pd(lr, one), r);
+            __m256d wc0 = _mm256_sub_pd(_mm256_add_pd(lc, one), c);
+            __m256d wz0 = _mm256_sub_pd(_mm256_add_pd(lz, one), z);
+            __m128i idx = _mm256_cvtpd_epi32(_mm256_add_pd(_mm256_add_pd(lr, _mm256_mul_pd(lc, rows)), _mm256_mul_pd(lz, layer_size)));
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), idx);
+
+            Corner4 c000 = load_corner(idx, lanes, 0), c100 = load_corner(idx, lanes, 1);
+            Corner4 c010 = load_corner(idx, lanes, _rows), c110 = load_corner(idx, lanes, _rows + 1);
+            Corner4 c001 = load_corner(idx, lanes, layer), c101 = load_corner(idx, lanes, layer + 1);
+            Corner4 c011 = load_corner(idx, lanes, layer + _rows), c111 = load_corner(idx, lanes, layer + _rows + 1);
+
+            __m256d a00 = lerp(wr0, wr1, c000.d, c100.d), a10 = lerp(wr0, wr1, c010.d, c110.d);
+            __m256d a01 = lerp(wr0, wr1, c001.d, c101.d), a11 = lerp(wr0, wr1, c011.d, c111.d);
+            __m256d b0 = lerp(wc0, wc1, a00, a10), b1 = lerp(wc0, wc1, a01, a11);
+            store_out_of_range(mask, lerp(wz0, wz1, b0, b1), distances + j);
+
+            if (Gradient){
+                __m256d gx, gy, gz;
+                if (stored_gradients){
+                    gx = _mm256_div_pd(lerp(wz0, wz1, lerp(wr0, wr1, c000.x, c100.x), lerp(wr0, wr1, c001.x, c101.x)), cell);
+                    gy = _mm256_div_pd(lerp(wz0, wz1, lerp(wc0, wc1, c000.y, c010.y), lerp(wc0, wc1, c001.y, c011.y)), cell);
+                    gz = _mm256_div_pd(lerp(wc0, wc1, lerp(wr0, wr1, c000.z, c100.z), lerp(wr0, wr1, c010.z, c110.z)), cell);
+                }else{
+                    gx = _mm256_div_pd(lerp(wz0, wz1, _mm256_sub_pd(a10, a00), _mm256_sub_pd(a11, a01)), cell);
+                    gy = _mm256_div_pd(lerp(wz0, wz1,
+                                            lerp(wc0, wc1, _mm256_sub_pd(c100.d, c000.d), _mm256_sub_pd(c110.d, c010.d)),
+                                            lerp(wc0, wc1, _mm256_sub_pd(c101.d, c001.d), _mm256_sub_pd(c111.d, c011.d))), cell);
+                    gz = _mm256_div_pd(_mm256_sub_pd(b1, b0), cell);
+                }
+                double* gj = gradients + static_cast<size_t>(j) * 3;
+                store_gradient(mask, gx, 3, 0, gj);
+                store_gradient(mask, gy, 3, 1, gj);
+                store_gradient(mask, gz, 3, 2, gj);
+            }
+        }
+        return j;
+    }
+#endif
+
+};
+
+} // namespace vimp
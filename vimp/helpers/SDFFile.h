@@ -0,0 +1,210 @@
+/**
+ * @file SDFFile.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief A versioned binary format for the signed distance fields, read through a read-only memory map.
+ * The pages of a map are loaded lazily on access and shared among all the processes reading the same file.
+ *
+ * Layout (little endian):
+ * [header, 128 bytes] magic "VIMPSDF", version, dimension (2 or 3), scalar size (4 or 8),
+ *                     rows, cols, layers, origin (x, y, z), cell size;
+ * [grid] layers * rows * cols scalars, each layer stored column-major as an Eigen matrix (rows: y, cols: x).
+ * @version 0.1
+ * @date 2023-09-08
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace vimp{
+
+struct SDFFileHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t dimension;
+    uint32_t scalar_size;
+    uint32_t reserved;
+    uint64_t rows, cols, layers;
+    double origin[3];
+    double cell_size;
+    char padding[128 - 8 - 4*4 - 3*8 - 4*8];
+};
+
+static_assert(sizeof(SDFFileHeader) == 128, "SDF file header must be 128 bytes.");
+
+constexpr char SDF_FILE_MAGIC[8] = "VIMPSDF";
+constexpr uint32_t SDF_FILE_VERSION = 1;
+
+/**
+ * @brief Write the layers of a field (one layer for a planar map) to the binary format.
+ *
+ * @param single_precision store the grid in float32
+ */
+inline void write_sdf_file(const std::string& path,
+                           const Eigen::VectorXd& origin,
+                           double cell_size,
+                           const std::vector<Eigen::MatrixXd>& layers,
+                           bool single_precision=false){
+    if (layers.empty()){
+        throw std::runtime_error("Empty field for the sdf file: " + path);
+    }
+
+    SDFFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SDF_FILE_MAGIC, sizeof(header.magic));
+    header.version = SDF_FILE_VERSION;
+    header.dimension = static_cast<uint32_t>(origin.size());
+    header.scalar_size = single_precision ? sizeof(float) : sizeof(double);
+    header.rows = layers[0].rows();
+    header.cols = layers[0].cols();
+    header.layers = layers.size();
+    for (int i=0; i<origin.size(); i++){
+        header.origin[i] = origin(i);
+    }
+    header.cell_size = cell_size;
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()){
+        throw std::runtime_error("Cannot open the sdf file for writing: " + path);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const Eigen::MatrixXd& layer : layers){
+        if (static_cast<uint64_t>(layer.rows()) != header.rows || static_cast<uint64_t>(layer.cols()) != header.cols){
+            throw std::runtime_error("Inconsistent layer sizes for the sdf file: " + path);
+        }
+        if (single_precision){
+            Eigen::MatrixXf layer_f = layer.cast<float>();
+            file.write(reinterpret_cast<const char*>(layer_f.data()), layer_f.size() * sizeof(float));
+        }else{
+            file.write(reinterpret_cast<const char*>(layer.data()), layer.size() * sizeof(double));
+        }
+    }
+}
+
+/**
+ * @brief Whether the file starts with the binary sdf magic.
+ */
+inline bool is_sdf_file(const std::string& path){
+    std::ifstream file(path, std::ios::binary);
+    char magic[8] = {0};
+    file.read(magic, sizeof(magic));
+    return file.good() && std::memcmp(magic, SDF_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+/**
+ * @brief A read-only memory map of a binary sdf file.
+ */
+class MappedSDFFile{
+public:
+    MappedSDFFile(){}
+
+    explicit MappedSDFFile(const std::string& path){ open(path); }
+
+    ~MappedSDFFile(){ close(); }
+
+    MappedSDFFile(const MappedSDFFile&) = delete;
+    MappedSDFFile& operator=(const MappedSDFFile&) = delete;
+
+    void open(const std::string& path){
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0){
+            throw std::runtime_error("File dose not exist ...: " + path);
+        }
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(sizeof(SDFFileHeader))){
+            ::close(fd);
+            throw std::runtime_error("Invalid sdf file: " + path);
+        }
+        _size = file_stat.st_size;
+        void* data = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED){
+            _size = 0;
+            throw std::runtime_error("Cannot map the sdf file: " + path);
+        }
+        _data = static_cast<const char*>(data);
+
+        const SDFFileHeader& h = header();
+        size_t grid_bytes = h.rows * h.cols * h.layers * h.scalar_size;
+        if (std::memcmp(h.magic, SDF_FILE_MAGIC, sizeof(h.magic)) != 0 || h.version != SDF_FILE_VERSION ||
+            (h.scalar_size != sizeof(float) && h.scalar_size != sizeof(double)) ||
+            _size < sizeof(SDFFileHeader) + grid_bytes){
+            close();
+            throw std::runtime_error("Invalid or unsupported sdf file: " + path);
+        }
+    }
+
+    void close(){
+        if (_data){
+            munmap(const_cast<char*>(_data), _size);
+            _data = nullptr;
+            _size = 0;
+        }
+    }
+
+    inline bool is_open() const { return _data != nullptr; }
+
+    inline const SDFFileHeader& header() const { return *reinterpret_cast<const SDFFileHeader*>(_data); }
+
+    inline int dimension() const { return header().dimension; }
+    inline int rows() const { return header().rows; }
+    inline int cols() const { return header().cols; }
+    inline int layers() const { return header().layers; }
+    inline double cell_size() const { return header().cell_size; }
+    inline bool single_precision() const { return header().scalar_size == sizeof(float); }
+
+    inline Eigen::VectorXd origin() const {
+        return Eigen::Map<const Eigen::VectorXd>(header().origin, dimension());
+    }
+
+    /**
+     * @brief Zero-copy views of a layer, valid while the file is mapped.
+     */
+    inline Eigen::Map<const Eigen::MatrixXd> layer_view(int k) const{
+        if (single_precision()){
+            throw std::runtime_error("The sdf grid is stored in float32, use layer_view_f.");
+        }
+        return Eigen::Map<const Eigen::MatrixXd>(reinterpret_cast<const double*>(grid()) + layer_offset(k), rows(), cols());
+    }
+
+    inline Eigen::Map<const Eigen::MatrixXf> layer_view_f(int k) const{
+        if (!single_precision()){
+            throw std::runtime_error("The sdf grid is stored in float64, use layer_view.");
+        }
+        return Eigen::Map<const Eigen::MatrixXf>(reinterpret_cast<const float*>(grid()) + layer_offset(k), rows(), cols());
+    }
+
+    /**
+     * @brief A double copy of a layer, for the consumers owning their grid (e.g., the gpmp2 sdf classes).
+     */
+    inline Eigen::MatrixXd layer(int k) const{
+        if (single_precision()){
+            return layer_view_f(k).cast<double>();
+        }
+        return layer_view(k);
+    }
+
+protected:
+    const char* _data = nullptr;
+    size_t _size = 0;
+
+    inline const char* grid() const { return _data + sizeof(SDFFileHeader); }
+    inline size_t layer_offset(int k) const { return static_cast<size_t>(k) * rows() * cols(); }
+};
+
+} // namespace vimp
@@ -0,0 +1,175 @@
+/**
+ * @file SDFGenerator.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Signed distance fields from 2D / 3D occupancy grids, the C++ counterpart of the matlab helpers
+ * signedDistanceField2D.m and signedDistanceField3D.m: field = (dist to the obstacles - dist to the free space) * cell_size,
+ * with the exact Euclidean distance transforms computed in linear time by the separable lower envelope of parabolas
+ * (Felzenszwalb and Huttenlocher, Distance Transforms of Sampled Functions), the lines of each pass split over threads.
+ *
+ * The grids are in the layout of the gpmp2 sdf classes: rows: y, cols: x, one layer per z.
+ * @version 0.1
+ * @date 2023-09-14
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <Eigen/Dense>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "helpers/ParallelFor.h"
+
+namespace vimp{
+
+class SDFGenerator{
+public:
+    /**
+     * @param threshold the cells with an occupancy above threshold are obstacles
+     * @param n_threads the threads of the distance transform passes, the hardware concurrency if <= 0
+     */
+    SDFGenerator(double threshold=0.75, int n_threads=0):
+    _threshold(threshold), _n_threads(n_threads){}
+
+    /**
+     * @brief The signed distance field of a planar occupancy map (rows: y, cols: x).
+     */
+    Eigen::MatrixXd signed_distance_field(const Eigen::MatrixXd& occupancy, double cell_size) const{
+        return signed_distance_field(std::vector<Eigen::MatrixXd>{occupancy}, cell_size)[0];
+    }
+
+    /**
+     * @brief The signed distance field of a 3D occupancy map, one layer (rows: y, cols: x) per z.
+     */
+    std::vector<Eigen::MatrixXd> signed_distance_field(const std::vector<Eigen::MatrixXd>& occupancy, double cell_size) const{
+        if (occupancy.empty()){
+            throw std::runtime_error("Empty occupancy grid for the sdf generation.");
+        }
+        const int rows = occupancy[0].rows(), cols = occupancy[0].cols(), layers = occupancy.size();
+        const size_t layer_size = static_cast<size_t>(rows) * cols;
+
+        // squared distances to the obstacles and to the free space, 0 on the features
+        std::vector<double> dist_obstacle(layer_size * layers), dist_free(layer_size * layers);
+        for (int k=0; k<layers; k++){
+            if (occupancy[k].rows() != rows || occupancy[k].cols() != cols){
+                throw std::runtime_error("Inconsistent layer sizes for the sdf generation.");
+            }
+            for (size_t i=0; i<layer_size; i++){
+                bool obstacle = occupancy[k].data()[i] > _threshold;
+                dist_obstacle[k*layer_size + i] = obstacle ? 0.0 : INF;
+                dist_free[k*layer_size + i] = obstacle ? INF : 0.0;
+            }
+        }
+        squared_distance_transform(dist_obstacle, rows, cols, layers);
+        squared_distance_transform(dist_free, rows, cols, layers);
+
+        // no obstacle or no free space: a constant field, as in the matlab helpers
+        std::vector<Eigen::MatrixXd> field(layers, Eigen::MatrixXd::Constant(rows, cols, NO_FEATURE_DISTANCE));
+        if (dist_obstacle[0] >= INF || dist_free[0] >= INF){
+            return field;
+        }
+        for (int k=0; k<layers; k++){
+            double* f = field[k].data();
+            for (size_t i=0; i<layer_size; i++){
+                f[i] = (std::sqrt(dist_obstacle[k*layer_size + i]) - std::sqrt(dist_free[k*layer_size + i])) * cell_size;
+            }
+        }
+        return field;
+    }
+
+    /**
+     * @brief Squared Euclidean distance transform in place of a grid (r + rows*(c + cols*k)) in cell units,
+     * features 0 and the other cells INF. The cells out of reach of any feature stay INF.
+     */
+    void squared_distance_transform(std::vector<double>& grid, int rows, int cols, int layers) const{
+        const size_t layer_size = static_cast<size_t>(rows) * cols;
+        // one pass per dimension over all the lines along it
+        transform_lines(grid, rows, 1, cols * layers, [rows](int line){
+            return static_cast<size_t>(line) * rows;
+        });
+        transform_lines(grid, cols, rows, rows * layers, [rows, cols](int line){
+            return static_cast<size_t>(line % rows) + static_cast<size_t>(line / rows) * rows * cols;
+        });
+        if (layers > 1){
+            transform_lines(grid, layers, layer_size, layer_size, [](int line){
+                return static_cast<size_t>(line);
+            });
+        }
+    }
+
+    /// squared distances of the cells without features
+    static constexpr double INF = 1e20;
+    /// the field without obstacles or free space, as in the matlab helpers
+    static constexpr double NO_FEATURE_DISTANCE = 1000.0;
+
+protected:
+    double _threshold;
+    int _n_threads;
+
+    /**
+     * @brief The 1D transform of n lines of length len with the given stride, the start of each line given by line_start.
+     */
+    template <typename LineStart>
+    void transform_lines(std::vector<double>& grid, int len, size_t stride, int n, const LineStart& line_start) const{
+        parallel_for(n, _n_threads, [&](int begin, int end){
+            std::vector<double> f(len), d(len), z(len + 1);
+            std::vector<int> v(len);
+            for (int line=begin; line<end; line++){
+                double* g = grid.data() + line_start(line);
+                for (int q=0; q<len; q++){
+                    f[q] = g[q*stride];
+                }
+                distance_transform_1d(f.data(), len, d.data(), v.data(), z.data());
+                for (int q=0; q<len; q++){
+                    g[q*stride] = d[q];
+                }
+            }
+        });
+    }
+
+    /**
+     * @brief d(q) = min_p (q - p)^2 + f(p), the lower envelope of the parabolas rooted at (p, f(p)).
+     * @param v, z the parabolas of the envelope and their boundaries, workspaces of sizes n and n+1
+     */
+    static void distance_transform_1d(const double* f, int n, double* d, int* v, double* z){
+        // skip the cells without features, their parabolas are never in the envelope
+        int k = -1;
+        for (int q=0; q<n; q++){
+            if (f[q] >= INF){
+                continue;
+            }
+            double s = 0.0;
+            while (k >= 0){
+                s = ((f[q] + static_cast<double>(q)*q) - (f[v[k]] + static_cast<double>(v[k])*v[k])) / (2.0*(q - v[k]));
+                if (s > z[k]){
+                    break;
+                }
+                k--;
+            }
+            k++;
+            v[k] = q;
+            z[k] = k == 0 ? -INF : s;
+            z[k+1] = INF;
+        }
+
+        if (k < 0){
+            for (int q=0; q<n; q++){
+                d[q] = INF;
+            }
+            return;
+        }
+        k = 0;
+        for (int q=0; q<n; q++){
+            while (z[k+1] < q){
+                k++;
+            }
+            d[q] = (q - v[k])*static_cast<double>(q - v[k]) + f[v[k]];
+        }
+    }
+
+};
+
+} // namespace vimp
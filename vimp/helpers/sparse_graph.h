@@ -10,6 +10,8 @@
  */
 
 #include "EigenWrapper.h"
+#include <vector>
+#include <utility>
 
 namespace vimp{
 struct Block{
@@ -21,13 +23,13 @@ public:
     _nrows(nrows),
     _ncols(ncols){}
 
-    int row(){ return _start_row;}
+    int row() const{ return _start_row;}
 
-    int nrows(){ return _nrows;}
+    int nrows() const{ return _nrows;}
 
-    int col(){ return _start_col;}
+    int col() const{ return _start_col;}
 
-    int ncols(){ return _ncols;}
+    int ncols() const{ return _ncols;}
 
     int _start_row;
     int _start_col;
@@ -47,36 +49,119 @@ public:
     _start_index(start_index),
     _block_length(block_length){
         _block = Block{_start_index*state_dim, _start_index*state_dim, _block_length, _block_length};
+        _segments.emplace_back(_start_index*state_dim, _block_length);
     };
 
-    SpMat extract(const SpMat & m){
-        return m.middleRows(_block.row(), _block.nrows()).middleCols(_block.col(), _block.ncols());
+    /**
+     * @brief A block over a general (possibly non-adjacent) set of states, 
+     * e.g., for loop closures or periodic constraints coupling the first and last states.
+     * @param states sorted indexes of the states in the scope of the factor.
+     */
+    TrajectoryBlock(int state_dim, int num_states, const std::vector<int>& states):
+    _state_dim(state_dim),
+    _num_states(num_states),
+    _start_index(states.front()),
+    _block_length(static_cast<int>(states.size())*state_dim){
+        _block = Block{_start_index*state_dim, _start_index*state_dim, _block_length, _block_length};
+        // merge the adjacent states into contiguous segments
+        for (int state : states){
+            if (!_segments.empty() && _segments.back().first + _segments.back().second == state*state_dim){
+                _segments.back().second += state_dim;
+            }else{
+                _segments.emplace_back(state*state_dim, state_dim);
+            }
+        }
+    };
+
+    SpMat extract(const SpMat & m) const{
+        if (is_contiguous()){
+            return m.middleRows(_block.row(), _block.nrows()).middleCols(_block.col(), _block.ncols());
+        }
+        Eigen::MatrixXd res(_block_length, _block_length);
+        int row = 0;
+        for (const auto & seg_r : _segments){
+            int col = 0;
+            for (const auto & seg_c : _segments){
+                res.block(row, col, seg_r.second, seg_c.second) = m.block(seg_r.first, seg_c.first, seg_r.second, seg_c.second);
+                col += seg_c.second;
+            }
+            row += seg_r.second;
+        }
+        return res.sparseView();
     }
 
-    Eigen::VectorXd extract_vector(const Eigen::VectorXd & vec){
-        return vec.block(_block.row(), 0, _block.nrows(), 1);
+    Eigen::VectorXd extract_vector(const Eigen::VectorXd & vec) const{
+        if (is_contiguous()){
+            return vec.block(_block.row(), 0, _block.nrows(), 1);
+        }
+        Eigen::VectorXd res(_block_length);
+        int row = 0;
+        for (const auto & seg : _segments){
+            res.segment(row, seg.second) = vec.segment(seg.first, seg.second);
+            row += seg.second;
+        }
+        return res;
     }
 
-    void fill(Eigen::MatrixXd & block, SpMat & matrix){
+    void fill(Eigen::MatrixXd & block, SpMat & matrix) const{
         Eigen::MatrixXd mat_full{matrix};
-        mat_full.block(_block.row(), _block.col(), _block.nrows(), _block.ncols()) = block;
+        int row = 0;
+        for (const auto & seg_r : _segments){
+            int col = 0;
+            for (const auto & seg_c : _segments){
+                mat_full.block(seg_r.first, seg_c.first, seg_r.second, seg_c.second) = block.block(row, col, seg_r.second, seg_c.second);
+                col += seg_c.second;
+            }
+            row += seg_r.second;
+        }
         matrix = mat_full.sparseView();
     }
 
-    void fill_vector(Eigen::VectorXd & vec, const Eigen::VectorXd & vec_block){
+    void fill_vector(Eigen::VectorXd & vec, const Eigen::VectorXd & vec_block) const{
         vec.setZero();
-        vec.block(_block.row(), 0, _block.nrows(), 1) = vec_block;
+        int row = 0;
+        for (const auto & seg : _segments){
+            vec.segment(seg.first, seg.second) = vec_block.segment(row, seg.second);
+            row += seg.second;
+        }
     }
 
-    double start_element(){
+    double start_element() const{
         return _start_index*_state_dim;
     }
 
-    double block_length(){
+    double block_length() const{
         return _block_length;
     }
 
-    void print(){
+    /**
+     * @brief The contiguous segments (starting element in the joint vector, length) of the block,
+     * ordered as they appear in the marginal vector.
+     */
+    inline const std::vector<std::pair<int, int>>& segments() const{
+        return _segments;
+    }
+
+    inline bool is_contiguous() const{
+        return _segments.size() == 1;
+    }
+
+    /**
+     * @brief The states covered by the block.
+     */
+    std::vector<int> states() const{
+        std::vector<int> states;
+        for (const auto& segment : _segments){
+            for (int state = segment.first / _state_dim; state <= (segment.first + segment.second - 1) / _state_dim; state++){
+                if (states.empty() || states.back() != state){
+                    states.push_back(state);
+                }
+            }
+        }
+        return states;
+    }
+
+    void print() const{
         std::cout << "(starting index, block length): " << "(" << _start_index << ", " << _block_length << ")" << std::endl;
     }
 
@@ -85,6 +170,7 @@ private:
     int _num_states;
     int _start_index, _block_length;
     Block _block = Block();
+    std::vector<std::pair<int, int>> _segments;
 
 }; // class TrajectoryBlock
 
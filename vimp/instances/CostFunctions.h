@@ -2,6 +2,8 @@
 #include "gp/minimum_acc_prior.h"
 #include <gpmp2/obstacle/ObstaclePlanarSDFFactor.h>
 #include <gpmp2/obstacle/ObstacleSDFFactor.h>
+#include <gpmp2/obstacle/ObstacleCost.h>
+#include <stdexcept>
 
 #include "3rdparty/rapidxml-1.13/rapidxml.hpp"
 #include "3rdparty/rapidxml-1.13/rapidxml_utils.hpp"
@@ -30,19 +32,173 @@ double cost_linear_gp(const VectorXd& pose_cmb, const vimp::MinimumAccGP& gp_min
     return gp_minacc.cost(pose_cmb.segment(0, dim), pose_cmb.segment(dim, dim));
 }
 
+/**
+ * Per-thread workspace of the obstacle cost kernels, reused across the calls (sigma points) 
+ * so that the kernels do not allocate besides the gpmp2 forward kinematics.
+ * */
+struct ObstacleCostWorkspace{
+    gtsam::Vector vec_err;
+    gtsam::Matrix J;
+    std::vector<gtsam::Point3> sphere_centers;
+    std::vector<gtsam::Matrix> J_centers;
+};
+
+inline ObstacleCostWorkspace& obstacle_cost_workspace(){
+    thread_local ObstacleCostWorkspace workspace;
+    return workspace;
+}
+
+/**
+ * The sdf type of a gpmp2 obstacle factor.
+ * */
+template <typename ObsFactor>
+struct ObstacleFactorSDF;
+
+template <typename ROBOT>
+struct ObstacleFactorSDF<gpmp2::ObstacleSDFFactor<ROBOT>>{ using type = gpmp2::SignedDistanceField; };
+
+template <typename ROBOT>
+struct ObstacleFactorSDF<gpmp2::ObstaclePlanarSDFFactor<ROBOT>>{ using type = gpmp2::PlanarSDF; };
+
+/**
+ * Hinge loss of one sphere center, and its Jacobian wrt the center (the z column is zero in the planar case).
+ * */
+inline double sphere_hinge_loss(const gtsam::Point3& center, const gpmp2::SignedDistanceField& sdf, double eps, gtsam::Matrix13* J){
+    if (!J){
+        return gpmp2::hingeLossObstacleCost(center, sdf, eps);
+    }
+    return gpmp2::hingeLossObstacleCost(center, sdf, eps, *J);
+}
+
+inline double sphere_hinge_loss(const gtsam::Point3& center, const gpmp2::PlanarSDF& sdf, double eps, gtsam::Matrix13* J){
+    const gtsam::Point2 center_2d(center.x(), center.y());
+    if (!J){
+        return gpmp2::hingeLossObstacleCost(center_2d, sdf, eps);
+    }
+    gtsam::Matrix12 J_2d;
+    double hinge = gpmp2::hingeLossObstacleCost(center_2d, sdf, eps, J_2d);
+    *J << J_2d, 0.0;
+    return hinge;
+}
+
+/**
+ * A gpmp2 obstacle factor which also keeps its robot, sdf, epsilon and sigma. gpmp2's evaluateError returns 
+ * a newly allocated vector on every call, hinge_error writes the same hinge losses into given buffers.
+ * */
+template <typename ObsFactor>
+class ObstacleHingeFactor : public ObsFactor{
+public:
+    using Robot = typename ObsFactor::Robot;
+    using SDF = typename ObstacleFactorSDF<ObsFactor>::type;
+
+    ObstacleHingeFactor(gtsam::Key pose_key, const Robot& robot, const SDF& sdf, double cost_sigma, double epsilon):
+        ObsFactor(pose_key, robot, sdf, cost_sigma, epsilon),
+        _robot(robot),
+        _sdf(sdf),
+        _epsilon(epsilon),
+        _inv_sigma(1.0 / cost_sigma){}
+
+    /**
+     * The hinge losses max(0, eps + r_j - d(c_j)) of the body spheres as in evaluateError, 
+     * and their Jacobian (n_spheres, dof) wrt the pose if J is not nullptr.
+     * */
+    void hinge_error(const VectorXd& pose, ObstacleCostWorkspace& workspace, gtsam::Matrix* J=nullptr) const{
+        const int n_spheres = _robot.nr_body_spheres();
+        if (J){
+            _robot.sphereCenters(pose, workspace.sphere_centers, workspace.J_centers);
+            J->resize(n_spheres, pose.size());
+        }else{
+            _robot.sphereCenters(pose, workspace.sphere_centers);
+        }
+        workspace.vec_err.resize(n_spheres);
+
+        gtsam::Matrix13 J_center;
+        for (int j=0; j<n_spheres; j++){
+            const double eps = _robot.sphere_radius(j) + _epsilon;
+            workspace.vec_err(j) = sphere_hinge_loss(workspace.sphere_centers[j], _sdf, eps, J ? &J_center : nullptr);
+            if (J){
+                J->row(j).noalias() = J_center * workspace.J_centers[j];
+            }
+        }
+    }
+
+    inline double inv_sigma() const { return _inv_sigma; }
+
+protected:
+    const Robot& _robot;
+    const SDF& _sdf;
+    double _epsilon, _inv_sigma;
+};
+
+/**
+ * The gpmp2 obstacle factors are built with an isotropic noise model, read its sigma directly 
+ * instead of copying the sigmas() vector.
+ * */
+template <typename ObsFactor>
+inline double obstacle_inv_sigma(const ObsFactor& obs_factor){
+    auto p_isotropic = boost::dynamic_pointer_cast<const gtsam::noiseModel::Isotropic>(obs_factor.get_noiseModel());
+    if (!p_isotropic){
+        throw std::invalid_argument("The obstacle cost kernels need an isotropic noise model.");
+    }
+    return 1.0 / p_isotropic->sigma();
+}
+
+/**
+ * Scaled squared hinge norm e^T e / sigma of an obstacle factor. The factors built as ObstacleHingeFactor 
+ * are evaluated into the workspace, the plain gpmp2 factors through evaluateError.
+ * */
+template <typename ObsFactor>
+inline double hinge_cost(const VectorXd& pose, const ObsFactor& obs_factor){
+    ObstacleCostWorkspace& workspace = obstacle_cost_workspace();
+    if (auto p_hinge = dynamic_cast<const ObstacleHingeFactor<ObsFactor>*>(&obs_factor)){
+        p_hinge->hinge_error(pose, workspace);
+        return workspace.vec_err.squaredNorm() * p_hinge->inv_sigma();
+    }
+    gtsam::Vector vec_err = obs_factor.evaluateError(pose);
+    return vec_err.squaredNorm() * obstacle_inv_sigma(obs_factor);
+}
+
+/**
+ * Scaled squared hinge norm e^T e / sigma, its gradient 2 J^T e / sigma 
+ * and the Gauss-Newton Hessian 2 J^T J / sigma from the sdf Jacobian.
+ * */
+template <typename ObsFactor>
+inline double hinge_cost_gradient(const VectorXd& pose, const ObsFactor& obs_factor, VectorXd& grad, MatrixXd& hess){
+    ObstacleCostWorkspace& workspace = obstacle_cost_workspace();
+    double inv_sigma = 0.0;
+    if (auto p_hinge = dynamic_cast<const ObstacleHingeFactor<ObsFactor>*>(&obs_factor)){
+        p_hinge->hinge_error(pose, workspace, &workspace.J);
+        inv_sigma = p_hinge->inv_sigma();
+    }else{
+        workspace.vec_err = obs_factor.evaluateError(pose, workspace.J);
+        inv_sigma = obstacle_inv_sigma(obs_factor);
+    }
+
+    grad.noalias() = (2.0 * inv_sigma) * workspace.J.transpose() * workspace.vec_err;
+    hess.noalias() = (2.0 * inv_sigma) * workspace.J.transpose() * workspace.J;
+
+    return workspace.vec_err.squaredNorm() * inv_sigma;
+}
+
 /**
  * Obstacle factor: planar case
  * */
 template <typename ROBOT>
 double cost_obstacle_planar(const VectorXd& pose, 
                     const gpmp2::ObstaclePlanarSDFFactor<ROBOT>& obs_factor){
-    VectorXd vec_err = obs_factor.evaluateError(pose);
-
-    MatrixXd precision_obs{MatrixXd::Identity(vec_err.rows(), vec_err.rows())};
-    precision_obs = precision_obs / obs_factor.get_noiseModel()->sigmas()[0];
+    return hinge_cost(pose, obs_factor);
+}
 
-    return vec_err.transpose().eval() * precision_obs * vec_err;
 
+/**
+ * Obstacle factor with gradient, planar case.
+ * */
+template <typename ROBOT>
+double cost_obstacle_planar_gradient(const VectorXd& pose, 
+                    const gpmp2::ObstaclePlanarSDFFactor<ROBOT>& obs_factor,
+                    VectorXd& grad, 
+                    MatrixXd& hess){
+    return hinge_cost_gradient(pose, obs_factor, grad, hess);
 }
 
 
@@ -52,19 +208,17 @@ double cost_obstacle_planar(const VectorXd& pose,
 template <typename ROBOT>
 double cost_obstacle(const VectorXd& pose, 
                     const gpmp2::ObstacleSDFFactor<ROBOT>& obs_factor){
-    VectorXd vec_err = obs_factor.evaluateError(pose);
-
-    // vimp::EigenWrapper ei;
-    // ei.print_matrix(pose, "pose");
-    // ei.print_matrix(vec_err, "vec_err");
-
-    // MatrixXd precision_obs;
-    MatrixXd precision_obs{MatrixXd::Identity(vec_err.rows(), vec_err.rows())};
-    precision_obs = precision_obs / obs_factor.get_noiseModel()->sigmas()[0];
-
-    // std::cout << "obs cost" << std::endl 
-    //           << vec_err.transpose().eval() * precision_obs * vec_err << std::endl;
+    return hinge_cost(pose, obs_factor);
+}
 
-    return vec_err.transpose().eval() * precision_obs * vec_err;
 
-}
\ No newline at end of file
+/**
+ * Obstacle factor with gradient.
+ * */
+template <typename ROBOT>
+double cost_obstacle_gradient(const VectorXd& pose, 
+                    const gpmp2::ObstacleSDFFactor<ROBOT>& obs_factor,
+                    VectorXd& grad, 
+                    MatrixXd& hess){
+    return hinge_cost_gradient(pose, obs_factor, grad, hess);
+}
@@ -13,6 +13,7 @@
 
 #include "instances/CostFunctions.h"
 #include "gvimp/GVIFactorizedNonlinerGH.h"
+#include "gvimp/GVIFactorizedNonlinerGradGH.h"
 #include "gvimp/GVI-GH.h"
 #include "gvimp/GVIFactorizedLinear.h"
 #include "gvimp/GVIFactorizedFixedGaussian.h"
@@ -27,6 +28,8 @@ namespace vimp{
     typedef GVIFactorizedLinear<MinimumAccGP> LinearGpPrior;
     template <typename ROBOT>
     using GVIFactorizedSDF = GVIFactorizedNonlinerGH<gpmp2::ObstacleSDFFactor<ROBOT>> ;
+    template <typename ROBOT>
+    using GVIFactorizedSDFGrad = GVIFactorizedNonlinerGradGH<gpmp2::ObstacleSDFFactor<ROBOT>>;
 
 }
 
@@ -13,6 +13,7 @@
 
 #include "instances/CostFunctions.h"
 #include "gvimp/GVIFactorizedNonlinerGH.h"
+#include "gvimp/GVIFactorizedNonlinerGradGH.h"
 #include "gvimp/GVI-GH.h"
 #include "gvimp/GVIFactorizedLinear.h"
 #include "gvimp/GVIFactorizedFixedGaussian.h"
@@ -26,6 +27,8 @@ namespace vimp{
     typedef GVIFactorizedLinear<MinimumAccGP> LinearGpPrior;
     template <typename ROBOT>
     using GVIFactorizedPlanarSDF = GVIFactorizedNonlinerGH<gpmp2::ObstaclePlanarSDFFactor<ROBOT>>;
+    template <typename ROBOT>
+    using GVIFactorizedPlanarSDFGrad = GVIFactorizedNonlinerGradGH<gpmp2::ObstaclePlanarSDFFactor<ROBOT>>;
 
 }
 
@@ -0,0 +1,154 @@
+/**
+ * @file SDFFreeSpaceBound.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief A conservative free-space test for the collision factors. 
+ * For a configuration ball B(q, r), every body sphere center moves at most L_j * r (L_j the Lipschitz constant 
+ * of the forward kinematics of the sphere), so the hinge loss is zero on the whole ball if 
+ * sdf(p_j(q)) - r_j - L_j * r > eps_sdf for all the spheres. 
+ * The same bound gives the collision factors affected by a local sdf update (SDFRegionBound).
+ * @version 0.1
+ * @date 2023-09-06
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+#pragma once
+
+#include <atomic>
+#include <Eigen/Geometry>
+#include <gpmp2/kinematics/ArmModel.h>
+#include <gpmp2/kinematics/PointRobotModel.h>
+#include <gpmp2/obstacle/PlanarSDF.h>
+#include <gpmp2/obstacle/SignedDistanceField.h>
+
+#include "helpers/EigenWrapper.h"
+
+namespace vimp{
+
+/**
+ * @brief Lipschitz constants of the sphere centers wrt the configuration: the point robot is the identity map.
+ */
+inline VectorXd sphere_lipschitz(const gpmp2::PointRobotModel& robot){
+    return VectorXd::Ones(robot.nr_body_spheres());
+}
+
+/**
+ * @brief Lipschitz constants of the sphere centers of a DH arm. A sphere on link l moves by at most 
+ * R_l * |dq_i| for joint i <= l, with R_l the reach of the chain up to the sphere, hence L = sqrt(l+1) * R_l.
+ */
+inline VectorXd sphere_lipschitz(const gpmp2::ArmModel& robot){
+    const gpmp2::Arm& arm = robot.fk_model();
+    VectorXd reach(arm.dof());
+    double cumulative_reach = 0.0;
+    for (int i=0; i<arm.dof(); i++){
+        cumulative_reach += std::sqrt(arm.a()(i)*arm.a()(i) + arm.d()(i)*arm.d()(i));
+        reach(i) = cumulative_reach;
+    }
+
+    VectorXd lipschitz(robot.nr_body_spheres());
+    for (int j=0; j<robot.nr_body_spheres(); j++){
+        int link = robot.sphere_link_id(j);
+        double center_offset = Vector3d{robot.sphere_center_wrt_link(j)}.norm();
+        lipschitz(j) = std::sqrt(double(link + 1)) * (reach(link) + center_offset);
+    }
+    return lipschitz;
+}
+
+inline double sdf_signed_distance(const gpmp2::SignedDistanceField& sdf, const Vector3d& point){
+    return sdf.getSignedDistance(gtsam::Point3(point));
+}
+
+inline double sdf_signed_distance(const gpmp2::PlanarSDF& sdf, const Vector3d& point){
+    return sdf.getSignedDistance(gtsam::Point2(point.head(2)));
+}
+
+template <typename Robot, typename SDF>
+class SDFFreeSpaceBound{
+public:
+    /**
+     * @brief The robot and the sdf are held by reference, the same as the gpmp2 collision factors built from them.
+     */
+    SDFFreeSpaceBound(const Robot& robot, const SDF& sdf, double eps_sdf):
+        _robot(robot),
+        _sdf(sdf),
+        _eps_sdf(eps_sdf),
+        _lipschitz(sphere_lipschitz(robot)),
+        _radii(robot.nr_body_spheres()){
+            for (int j=0; j<_radii.size(); j++){
+                _radii(j) = robot.sphere_radius(j);
+            }
+        }
+
+    /**
+     * @brief Whether the hinge loss is proven zero on the ball of the radius around the configuration. 
+     * Queries outside of the sdf are never proven free.
+     */
+    bool operator()(const VectorXd& conf, double radius) const{
+        _n_queries++;
+        try{
+            MatrixXd centers = _robot.sphereCentersMat(conf);
+            for (int j=0; j<centers.cols(); j++){
+                Vector3d center = Vector3d::Zero();
+                center.head(centers.rows()) = centers.col(j);
+                if (sdf_signed_distance(_sdf, center) - _radii(j) - _lipschitz(j) * radius <= _eps_sdf){
+                    return false;
+                }
+            }
+        }catch(...){
+            return false;
+        }
+        _n_skipped++;
+        return true;
+    }
+
+    inline size_t n_queries() const { return _n_queries; }
+
+    inline size_t n_skipped() const { return _n_skipped; }
+
+    inline void reset_counters(){ _n_queries = 0; _n_skipped = 0; }
+
+protected:
+    const Robot& _robot;
+    const SDF& _sdf;
+    double _eps_sdf;
+    VectorXd _lipschitz, _radii;
+
+    mutable std::atomic<size_t> _n_queries{0}, _n_skipped{0};
+};
+
+/**
+ * @brief The test of the collision factors affected by an sdf update in a workspace box (IncrementalSDF::region_box):
+ * on the configuration ball B(q, r) the body sphere centers stay within L_j * r of p_j(q), so the hinge losses
+ * only read the updated sdf values if dist(p_j(q), box) <= L_j * r for a sphere.
+ */
+template <typename Robot>
+class SDFRegionBound{
+public:
+    SDFRegionBound(const Robot& robot, const Eigen::AlignedBox3d& box):
+        _robot(robot),
+        _box(box),
+        _lipschitz(sphere_lipschitz(robot)){}
+
+    bool operator()(const VectorXd& conf, double radius) const{
+        if (_box.isEmpty()){
+            return false;
+        }
+        MatrixXd centers = _robot.sphereCentersMat(conf);
+        for (int j=0; j<centers.cols(); j++){
+            Vector3d center = Vector3d::Zero();
+            center.head(centers.rows()) = centers.col(j);
+            if (_box.exteriorDistance(center) <= _lipschitz(j) * radius){
+                return true;
+            }
+        }
+        return false;
+    }
+
+protected:
+    const Robot& _robot;
+    Eigen::AlignedBox3d _box;
+    VectorXd _lipschitz;
+};
+
+} // namespace vimp
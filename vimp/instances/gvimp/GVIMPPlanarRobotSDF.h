@@ -11,6 +11,7 @@
 
 #include "helpers/ExperimentParams.h"
 #include "instances/FactorizedGVIPlanar.h"
+#include "instances/SDFFreeSpaceBound.h"
 #include <gpmp2/obstacle/ObstaclePlanarSDFFactor.h>
 #include <gtsam/inference/Symbol.h>
 
@@ -21,6 +22,7 @@ template <typename Robot, typename RobotSDF>
 class GVIMPPlanarRobotSDF{
     using SDFPR = gpmp2::ObstaclePlanarSDFFactor<Robot>;
     using GVIFactorizedPlanarSDFRobot = GVIFactorizedPlanarSDF<Robot>;
+    using GVIFactorizedPlanarSDFGradRobot = GVIFactorizedPlanarSDFGrad<Robot>;
 
 public:
     virtual ~GVIMPPlanarRobotSDF(){}
@@ -58,8 +60,10 @@ public:
         /// Vector of base factored optimizers
         vector<std::shared_ptr<GVIFactorizedBase>> vec_factors;
         
-        auto robot_model = _robot_sdf.RobotModel();
-        auto sdf = _robot_sdf.sdf();
+        /// follow the updates of the shared map by other robots
+        _robot_sdf.sync_sdf();
+        const auto& robot_model = _robot_sdf.RobotModel();
+        const auto& sdf = _robot_sdf.sdf();
         double sig_obs = params.sig_obs(), eps_sdf = params.eps_sdf();
         double temperature = params.temperature();
 
@@ -70,6 +74,25 @@ public:
         /// prior 
         double delt_t = params.total_time() / N;
 
+        /// one GP prior definition (Phi, Q^{-1}, closed-form terms) shared among all the linear prior factors
+        auto gp_model = std::make_shared<const MinimumAccGPModel>(Qc, delt_t);
+
+        /// one collision cost object (robot model and sdf) shared by reference among all the collision factors, 
+        /// evaluated into the per-thread workspace of the cost kernels
+        std::shared_ptr<const SDFPR> p_obs_cost = std::make_shared<const ObstacleHingeFactor<SDFPR>>(gtsam::symbol('x', 0), robot_model, sdf, sig_obs, eps_sdf);
+
+        /// conservative free-space test skipping the collision integrations far from the obstacles
+        using FreeSpaceBound = SDFFreeSpaceBound<Robot, std::decay_t<decltype(sdf)>>;
+        auto p_free_space = std::make_shared<FreeSpaceBound>(robot_model, sdf, eps_sdf);
+        auto free_space_test = [p_free_space](const VectorXd& conf, double radius){ return (*p_free_space)(conf, radius); };
+
+        /// the collision costs of all the quadrature points of a factor with one batch sdf query, e^T e / sigma as in hinge_cost
+        auto batch_obs_cost = [this, sig_obs, eps_sdf](const MatrixXd& confs, VectorXd& costs){
+            MatrixXd hinge;
+            _robot_sdf.hinge_jacobian_batch(confs, eps_sdf, hinge);
+            costs = hinge.colwise().squaredNorm().transpose() / sig_obs;
+        };
+
         for (int i = 0; i < n_states; i++) {
 
             // initial state
@@ -79,7 +102,7 @@ public:
             theta_i.segment(dim_conf, dim_conf) = avg_vel;
             joint_init_theta.segment(i*dim_state, dim_state) = std::move(theta_i);   
 
-            MinimumAccGP lin_gp{Qc, i, delt_t, start_theta};
+            MinimumAccGP lin_gp{gp_model, i, start_theta};
 
             // fixed start and goal priors
             // Factor Order: [fixed_gp_0, lin_gp_1, obs_1, ..., lin_gp_(N-1), obs_(N-1), lin_gp_(N), fixed_gp_(N)] 
@@ -122,18 +145,32 @@ public:
 
                 // collision factor
                 auto cost_sdf_Robot = cost_obstacle_planar<Robot>;
-                vec_factors.emplace_back(new GVIFactorizedPlanarSDFRobot{dim_conf, 
-                                                                        dim_state, 
-                                                                        cost_sdf_Robot, 
-                                                                        SDFPR{gtsam::symbol('x', i), 
-                                                                        robot_model, 
-                                                                        sdf, 
-                                                                        sig_obs, 
-                                                                        eps_sdf}, 
-                                                                        n_states, 
-                                                                        i, 
-                                                                        params.temperature(), 
-                                                                        params.high_temperature()});    
+                GVIFactorizedPlanarSDFRobot* p_col_factor;
+                if (params.sdf_gradient_GH_degree() > 0){
+                    p_col_factor = new GVIFactorizedPlanarSDFGradRobot{dim_conf, 
+                                                                            dim_state, 
+                                                                            cost_sdf_Robot, 
+                                                                            cost_obstacle_planar_gradient<Robot>, 
+                                                                            p_obs_cost, 
+                                                                            n_states, 
+                                                                            i, 
+                                                                            params.temperature(), 
+                                                                            params.high_temperature(),
+                                                                            params.sdf_gradient_GH_degree()};
+                }else{
+                    p_col_factor = new GVIFactorizedPlanarSDFRobot{dim_conf, 
+                                                                            dim_state, 
+                                                                            cost_sdf_Robot, 
+                                                                            p_obs_cost, 
+                                                                            n_states, 
+                                                                            i, 
+                                                                            params.temperature(), 
+                                                                            params.high_temperature()};
+                }
+                p_col_factor->set_free_space_test(free_space_test);
+                p_col_factor->set_batch_cost(batch_obs_cost);
+                p_col_factor->set_cost_version([this](){ return _robot_sdf.sdf_version(); });
+                vec_factors.emplace_back(p_col_factor);
             }
         }
 
@@ -159,6 +196,11 @@ public:
 
         optimizer.optimize(verbose);
 
+        if (verbose){
+            std::cout << "collision integrations skipped in free space: " << p_free_space->n_skipped() 
+                      << " / " << p_free_space->n_queries() << std::endl;
+        }
+
         _last_iteration_mean_precision = std::make_tuple(optimizer.mean(), optimizer.precision());
 
         return _last_iteration_mean_precision;
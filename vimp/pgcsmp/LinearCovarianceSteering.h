@@ -15,7 +15,9 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include "helpers/BandedLU.h"
 #include "helpers/EigenWrapper.h"
+#include "helpers/ParallelFor.h"
 using namespace Eigen;
 
 namespace vimp{
@@ -77,157 +79,41 @@ public:
         compute_Phi();
     }
 
+    /**
+     * @brief The threads integrating Phi and s, in pieces of at least MIN_STEPS_PER_THREAD time steps.
+     * The results depend on the number of pieces up to the rounding, 1 thread is the sequential integration.
+     * @param n_threads the number of threads, the hardware concurrency if <= 0
+     */
+    void set_n_threads(int n_threads){ _n_threads = n_threads; }
+
+    /**
+     * @brief Solve the means by one banded linear system over all the time points instead of 
+     * shooting from the initial costate through Phi12, which is ill-conditioned for long horizons.
+     * The covariance part still uses Phi.
+     */
+    void use_banded_mean(bool banded=true){ _banded_mean = banded; }
+
+    /**
+     * @brief Assemble the Hamiltonian matrices Mt and integrate their transition matrix Phi, 
+     * together with the offset s of the system forced by (a, -r).
+     */
     void compute_Phi(){
-        MatrixXd Ai(_nx, _nx), Bi(_nx, _nu), BiT(_nu, _nx), Qi(_nx, _nx), Mi(2*_nx, 2*_nx);
-        for (int i=0; i< _nt; i++){
-            Ai = _ei.decomp3d(_At, _nx, _nx, i);
-            Qi = _ei.decomp3d(_Qt, _nx, _nx, i);
-            Bi = _ei.decomp3d(_Bt, _nx, _nu, i);
-            BiT = Bi.transpose();
-            Mi.block(0, 0, _nx, _nx) = Ai;
-            Mi.block(0, _nx, _nx, _nx) = -Bi*BiT;
-            Mi.block(_nx, 0, _nx, _nx) = -Qi;
-            Mi.block(_nx, _nx, _nx, _nx) = -Ai.transpose();
-            _ei.compress3d(Mi, _Mt, i);
-        }
-        _Phi = MatrixXd::Identity(2*_nx, 2*_nx);
-        MatrixXd Phi_tild(2*_nx, 2*_nx);
-
-        for (int i=0; i<_nt-1; i++){
-            Phi_tild.setZero();
-            MatrixXd Mi = _ei.decomp3d(_Mt, 2*_nx, 2*_nx, i);
-            MatrixXd Mi_next = _ei.decomp3d(_Mt, 2*_nx, 2*_nx, i+1);
-            Phi_tild = _Phi + Mi*_Phi*_delta_t;
-            _Phi = _Phi + _delta_t * (Mi*_Phi + Mi_next*Phi_tild) / 2.0;
-        }
+        if (_nx == 4 && _nu == 2){ compute_Phi_kernel<4, 2>(); }
+        else if (_nx == 6 && _nu == 2){ compute_Phi_kernel<6, 2>(); }
+        else if (_nx == 6 && _nu == 3){ compute_Phi_kernel<6, 3>(); }
+        else if (_nx == 14 && _nu == 7){ compute_Phi_kernel<14, 7>(); }
+        else{ compute_Phi_kernel<Eigen::Dynamic, Eigen::Dynamic>(); }
 
         _Phi11 = _Phi.block(0, 0, _nx, _nx);
         _Phi12 = _Phi.block(0, _nx, _nx, _nx);
-
-        // #define STRING(x) #x
-        // #define XSTRING(x) STRING(x)
-        // std::string source_root{XSTRING(SOURCE_ROOT)};
-
-        // MatrixIO mio;
-        // mio.saveData(source_root+"/Phi11.csv", _Phi11);
-        // mio.saveData(source_root+"/Phi12.csv", _Phi12);
-        // mio.saveData(source_root+"/Mt.csv", _Mt);
-
     }
 
     std::tuple<Matrix3D, Matrix3D> solve_return(){
-        Matrix3D Kt(_nu, _nx, _nt), dt(_nu, 1, _nt);
-        VectorXd s{VectorXd::Zero(2*_nx)}, s_tild{VectorXd::Zero(2*_nx)};
-        MatrixXd a_r{MatrixXd::Zero(2*_nx, _nt)};
-        a_r << _at, 
-              -_rt;
-        
-        MatrixXd Mi(2*_nx, 2*_nx), Mi_next(2*_nx, 2*_nx);
-        for (int i=0;i<_nt-1;i++){
-            Mi = _ei.decomp3d(_Mt, 2*_nx, 2*_nx, i);
-            Mi_next = _ei.decomp3d(_Mt, 2*_nx, 2*_nx, i+1);
-            s_tild = s + (Mi*s + a_r.col(i))*_delta_t;
-            s = s + _delta_t * ((Mi*s + a_r.col(i)) + (Mi_next*s_tild + a_r.col(i+1))) / 2.0;
-        }
-
-        // #define STRING(x) #x
-        // #define XSTRING(x) STRING(x)
-        // std::string source_root{XSTRING(SOURCE_ROOT)};
-
-        // MatrixIO mio;
-        // mio.saveData(source_root+"/s.csv", s);
-
-        VectorXd rhs{_m1 - _Phi11*_m0-s.block(0,0,_nx,1)};
-        VectorXd Lambda_0 = _Phi12.colPivHouseholderQr().solve(rhs);
-        MatrixXd Xt(2*_nx, _nt), X_tild(2*_nx, _nt);
-        VectorXd X0(2*_nx);
-        X0 << _m0, Lambda_0;
-
-        // mio.saveData(source_root+"/Lambda_0.csv", Lambda_0);
-
-        // #define STRING(x) #x
-        // #define XSTRING(x) STRING(x)
-        // std::string source_root{XSTRING(SOURCE_ROOT)};
-
-        // MatrixIO mio;
-        // mio.saveData(source_root+"/X0.csv", X0);
-
-        Xt.col(0) = X0;
-
-        for (int i=0; i<_nt-1; i++){
-            Mi = _ei.decomp3d(_Mt, 2*_nx, 2*_nx, i); 
-            Mi_next = _ei.decomp3d(_Mt, 2*_nx, 2*_nx, i+1); 
-            X_tild = Xt.col(i) + _delta_t*(Mi*Xt.col(i) + a_r.col(i));
-            Xt.col(i+1) = Xt.col(i) + _delta_t* ( (Mi*Xt.col(i) + a_r.col(i)) + (Mi_next*X_tild + a_r.col(i+1)) ) / 2.0;
-        }
-
-        // MatrixIO mio;
-        // mio.saveData(source_root+"/Xt.csv", Xt);
-
-        MatrixXd xt{Xt.block(0,0,_nx,_nt)};
-        MatrixXd lbdt{Xt.block(_nx, 0, _nx, _nt)};
-        MatrixXd v(_nu, _nt);
-        MatrixXd Bi(_nx, _nu), BiT(_nu, _nx);
-        
-        for (int i=0; i<_nt; i++){
-            Bi = _ei.decomp3d(_Bt, _nx, _nu, i);
-            BiT = Bi.transpose();
-            v.col(i) = -BiT*lbdt.col(i);
-        }
-        MatrixXd Sig0_inv_sqrt = _ei.psd_invsqrtm(_Sig0);
-        
-        MatrixXd Sig0_sqrt = _ei.psd_sqrtm(_Sig0);
-        MatrixXd _Phi12T(_nx, _nx);
-        _Phi12T = _Phi12.transpose();
-        MatrixXd temp = _eps*_eps*MatrixXd::Identity(_nx, _nx)/4 + 
-                        Sig0_sqrt*_Phi12.inverse()*_Sig1*_Phi12T.inverse()*Sig0_sqrt;
-
-        MatrixXd Pi_0 = _eps * _Sig0.inverse() / 2.0 - _Phi12.inverse()*_Phi11 - 
-                        Sig0_inv_sqrt *_ei.psd_sqrtm(temp)*Sig0_inv_sqrt;
-        
-        MatrixXd Pi_0_T = Pi_0.transpose();
-        Pi_0 = (Pi_0 + Pi_0_T)/2;
-        _ei.compress3d(Pi_0, _Pit, 0);
-        MatrixXd Ai(_nx, _nx), AiT(_nx, _nx), Qi(_nx, _nx), Pii(_nx, _nx), Pinew(_nx, _nx);
-        MatrixXd Ai_next(_nx, _nx), AiT_next(_nx, _nx), Qi_next(_nx, _nx), Pii_next(_nx, _nx), Pi_next(_nx, _nx);
-        MatrixXd Bi_next(_nx, _nu), BiT_next(_nu, _nx);
-        Ai.setZero(); AiT.setZero(); Qi.setZero(); Pii.setZero(); Pinew.setZero(); Bi_next.setZero(); BiT_next.setZero();
-        Ai_next.setZero(); AiT_next.setZero(); Qi_next.setZero(); Pii_next.setZero(); Pi_next.setZero();
-        for (int i=0; i<_nt-1; i++){
-            Pii = _ei.decomp3d(_Pit, _nx, _nx, i);
-            Qi = _ei.decomp3d(_Qt, _nx, _nx, i);
-            Ai = _ei.decomp3d(_At, _nx, _nx, i);
-            Bi = _ei.decomp3d(_Bt, _nx, _nu, i);
-            BiT = Bi.transpose();
-            AiT = Ai.transpose();
-
-            Pii_next = _ei.decomp3d(_Pit, _nx, _nx, i+1);
-            Qi_next = _ei.decomp3d(_Qt, _nx, _nx, i+1);
-            Ai_next = _ei.decomp3d(_At, _nx, _nx, i+1);
-            Bi_next = _ei.decomp3d(_Bt, _nx, _nu, i+1);
-            BiT_next = Bi_next.transpose();
-            AiT_next = Ai_next.transpose();
-
-            Pinew = Pii - _delta_t*(AiT*Pii+Pii*Ai-Pii*Bi*BiT*Pii+Qi);
-            Pi_next = Pii - _delta_t* ( (AiT*Pii+Pii*Ai-Pii*Bi*BiT*Pii+Qi) + 
-                                        (AiT_next*Pinew+Pinew*Ai_next-Pinew*Bi_next*BiT_next*Pinew+Qi_next) ) / 2.0;
-            _ei.compress3d(Pi_next, _Pit, i+1);
-        }
-
-        // mio.saveData(source_root+"/Pit.csv", _Pit);
-
-        MatrixXd Ki(_nu, _nx);
-        Ki.setZero();
-        for (int i=0; i<_nt; i++){
-            Bi = _ei.decomp3d(_Bt, _nx, _nu, i);
-            BiT = Bi.transpose();
-            Pii = _ei.decomp3d(_Pit, _nx, _nx, i);
-            Ki = - BiT * Pii;
-            _ei.compress3d(Ki, Kt, i);
-            dt.col(i) = v.col(i) + BiT * Pii * xt.col(i);
-        }
-
-        return std::make_tuple(Kt, dt);
+        if (_nx == 4 && _nu == 2){ return solve_return_kernel<4, 2>(); }
+        if (_nx == 6 && _nu == 2){ return solve_return_kernel<6, 2>(); }
+        if (_nx == 6 && _nu == 3){ return solve_return_kernel<6, 3>(); }
+        if (_nx == 14 && _nu == 7){ return solve_return_kernel<14, 7>(); }
+        return solve_return_kernel<Eigen::Dynamic, Eigen::Dynamic>();
     }
 
     void solve(){
@@ -246,6 +132,8 @@ public:
 
     inline Matrix3D Pit(){ return _Pit; }
 
+    inline MatrixXd Xt(){ return _Xt; }
+
     inline MatrixXd Pit(int i){ return _ei.decomp3d(_Pit, _nx, _nx, i); }
 
     inline Matrix3D Qt(){ return _Qt; }
@@ -292,12 +180,265 @@ public:
 
 
 private:
+    /**
+     * @brief The integrators in fixed sizes (NX, NU) for the shipped systems, Eigen::Dynamic for the others.
+     * The time slices are mapped in place and all the temporaries are allocated before the time loops.
+     */
+    template <int NX, int NU>
+    void compute_Phi_kernel(){
+        constexpr int NH = NX == Eigen::Dynamic ? Eigen::Dynamic : 2*NX;
+        using MatXX = Eigen::Matrix<double, NX, NX>;
+        using MatXU = Eigen::Matrix<double, NX, NU>;
+        using MatHH = Eigen::Matrix<double, NH, NH>;
+        using VecH = Eigen::Matrix<double, NH, 1>;
+
+        // a time invariant B needs B*B^T once
+        bool B_constant = _ei.is_time_invariant(_Bt);
+        MatXX BBT0(_nx, _nx);
+        Eigen::Map<const MatXU> B0(_Bt.col(0).data(), _nx, _nu);
+        BBT0.noalias() = B0 * B0.transpose();
+
+        // the steps of the Heun's method are independent affine maps in pieces of the horizon
+        const int n_steps = _nt - 1;
+        const int n_chunks = std::max(1, std::min(resolve_n_threads(_n_threads), n_steps / MIN_STEPS_PER_THREAD));
+
+        parallel_for(_nt, n_chunks, [&](int begin, int end){
+            for (int i=begin; i<end; i++){
+                Eigen::Map<const MatXX> Ai(_At.col(i).data(), _nx, _nx);
+                Eigen::Map<const MatXX> Qi(_Qt.col(i).data(), _nx, _nx);
+                Eigen::Map<const MatXU> Bi(_Bt.col(i).data(), _nx, _nu);
+                Eigen::Map<MatHH> Mi(_Mt.col(i).data(), 2*_nx, 2*_nx);
+                Mi.block(0, 0, _nx, _nx) = Ai;
+                if (B_constant){
+                    Mi.block(0, _nx, _nx, _nx) = -BBT0;
+                }else{
+                    Mi.block(0, _nx, _nx, _nx).noalias() = -Bi*Bi.transpose();
+                }
+                Mi.block(_nx, 0, _nx, _nx) = -Qi;
+                Mi.block(_nx, _nx, _nx, _nx) = -Ai.transpose();
+            }
+        });
+
+        MatrixXd a_r(2*_nx, _nt);
+        a_r << _at, 
+              -_rt;
+
+        /**
+         * The Heun's method from (I, 0) over the steps [begin, end) gives the transition Phi and the 
+         * offset s of the affine map X -> Phi*X + s of these steps. The maps of the chunks are computed
+         * in parallel and combined in order; with a single chunk it is the sequential integration.
+         */
+        std::vector<MatHH, Eigen::aligned_allocator<MatHH>> Phi_chunks(n_chunks, MatHH(2*_nx, 2*_nx));
+        std::vector<VecH, Eigen::aligned_allocator<VecH>> s_chunks(n_chunks, VecH(2*_nx));
+        parallel_for(n_chunks, n_chunks, [&](int chunk_begin, int chunk_end){
+            MatHH Phi_tild(2*_nx, 2*_nx), MPhi(2*_nx, 2*_nx), MPhi_next(2*_nx, 2*_nx);
+            VecH s_tild(2*_nx), f(2*_nx), f_next(2*_nx);
+            for (int c=chunk_begin; c<chunk_end; c++){
+                MatHH& Phi = Phi_chunks[c];
+                VecH& s = s_chunks[c];
+                Phi.setIdentity();
+                s.setZero();
+                const int begin = static_cast<long>(n_steps) * c / n_chunks, end = static_cast<long>(n_steps) * (c + 1) / n_chunks;
+                for (int i=begin; i<end; i++){
+                    Eigen::Map<const MatHH> Mi(_Mt.col(i).data(), 2*_nx, 2*_nx);
+                    Eigen::Map<const MatHH> Mi_next(_Mt.col(i+1).data(), 2*_nx, 2*_nx);
+                    MPhi.noalias() = Mi*Phi;
+                    Phi_tild = Phi + MPhi*_delta_t;
+                    MPhi_next.noalias() = Mi_next*Phi_tild;
+                    Phi = Phi + _delta_t * (MPhi + MPhi_next) / 2.0;
+
+                    f.noalias() = Mi*s;
+                    f += a_r.col(i);
+                    s_tild = s + f*_delta_t;
+                    f_next.noalias() = Mi_next*s_tild;
+                    f_next += a_r.col(i+1);
+                    s = s + _delta_t * (f + f_next) / 2.0;
+                }
+            }
+        });
+
+        MatHH Phi{Phi_chunks[0]}, Phi_prev(2*_nx, 2*_nx);
+        VecH s{s_chunks[0]}, s_prev(2*_nx);
+        for (int c=1; c<n_chunks; c++){
+            Phi_prev = Phi;
+            s_prev = s;
+            Phi.noalias() = Phi_chunks[c]*Phi_prev;
+            s = s_chunks[c];
+            s.noalias() += Phi_chunks[c]*s_prev;
+        }
+        _Phi = Phi;
+        _s = s;
+    }
+
+    template <int NX, int NU>
+    std::tuple<Matrix3D, Matrix3D> solve_return_kernel(){
+        constexpr int NH = NX == Eigen::Dynamic ? Eigen::Dynamic : 2*NX;
+        using MatXX = Eigen::Matrix<double, NX, NX>;
+        using MatXU = Eigen::Matrix<double, NX, NU>;
+        using MatUX = Eigen::Matrix<double, NU, NX>;
+        using MatHH = Eigen::Matrix<double, NH, NH>;
+        using VecH = Eigen::Matrix<double, NH, 1>;
+        using VecU = Eigen::Matrix<double, NU, 1>;
+
+        Matrix3D Kt(_nu, _nx, _nt), dt(_nu, 1, _nt);
+        MatrixXd a_r{MatrixXd::Zero(2*_nx, _nt)};
+        a_r << _at, 
+              -_rt;
+        VecH f(2*_nx), f_next(2*_nx);
+
+        MatrixXd& Xt = _Xt;
+        if (_banded_mean){
+            solve_mean_banded<NX>(a_r, Xt);
+        }else{
+            // shooting from the initial costate
+            VectorXd rhs{_m1 - _Phi11*_m0-_s.head(_nx)};
+            VectorXd Lambda_0 = _Phi12.colPivHouseholderQr().solve(rhs);
+            Xt.resize(2*_nx, _nt);
+            VecH X(2*_nx), X_tild(2*_nx);
+            X << _m0, Lambda_0;
+            Xt.col(0) = X;
+
+            for (int i=0; i<_nt-1; i++){
+                Eigen::Map<const MatHH> Mi(_Mt.col(i).data(), 2*_nx, 2*_nx);
+                Eigen::Map<const MatHH> Mi_next(_Mt.col(i+1).data(), 2*_nx, 2*_nx);
+                f.noalias() = Mi*X;
+                f += a_r.col(i);
+                X_tild = X + _delta_t*f;
+                f_next.noalias() = Mi_next*X_tild;
+                f_next += a_r.col(i+1);
+                X = X + _delta_t* (f + f_next) / 2.0;
+                Xt.col(i+1) = X;
+            }
+        }
+
+        MatrixXd Sig0_inv_sqrt = _ei.psd_invsqrtm(_Sig0);
+        
+        MatrixXd Sig0_sqrt = _ei.psd_sqrtm(_Sig0);
+        MatrixXd _Phi12T(_nx, _nx);
+        _Phi12T = _Phi12.transpose();
+        MatrixXd temp = _eps*_eps*MatrixXd::Identity(_nx, _nx)/4 + 
+                        Sig0_sqrt*_Phi12.inverse()*_Sig1*_Phi12T.inverse()*Sig0_sqrt;
+
+        MatrixXd Pi_0 = _eps * _Sig0.inverse() / 2.0 - _Phi12.inverse()*_Phi11 - 
+                        Sig0_inv_sqrt *_ei.psd_sqrtm(temp)*Sig0_inv_sqrt;
+        
+        MatrixXd Pi_0_T = Pi_0.transpose();
+        Pi_0 = (Pi_0 + Pi_0_T)/2;
+        _ei.compress3d(Pi_0, _Pit, 0);
+
+        // Riccati equation, -dPi/dt = A^T*Pi + Pi*A - Pi*B*B^T*Pi + Q
+        MatXU PiB(_nx, _nu);
+        MatXX PiBBT(_nx, _nx);
+        auto riccati = [&](const MatXX& Pi, const Eigen::Map<const MatXX>& A, const Eigen::Map<const MatXU>& B, 
+                           const Eigen::Map<const MatXX>& Q, MatXX& dPi){
+            dPi.noalias() = A.transpose()*Pi;
+            dPi.noalias() += Pi*A;
+            PiB.noalias() = Pi*B;
+            PiBBT.noalias() = PiB*B.transpose();
+            dPi.noalias() -= PiBBT*Pi;
+            dPi += Q;
+        };
+
+        MatXX Pi(Pi_0), Pinew(_nx, _nx), dPi(_nx, _nx), dPi_next(_nx, _nx);
+        for (int i=0; i<_nt-1; i++){
+            Eigen::Map<const MatXX> Qi(_Qt.col(i).data(), _nx, _nx), Qi_next(_Qt.col(i+1).data(), _nx, _nx);
+            Eigen::Map<const MatXX> Ai(_At.col(i).data(), _nx, _nx), Ai_next(_At.col(i+1).data(), _nx, _nx);
+            Eigen::Map<const MatXU> Bi(_Bt.col(i).data(), _nx, _nu), Bi_next(_Bt.col(i+1).data(), _nx, _nu);
+
+            riccati(Pi, Ai, Bi, Qi, dPi);
+            Pinew = Pi - _delta_t*dPi;
+            riccati(Pinew, Ai_next, Bi_next, Qi_next, dPi_next);
+            Pi = Pi - _delta_t* (dPi + dPi_next) / 2.0;
+            Eigen::Map<MatXX>(_Pit.col(i+1).data(), _nx, _nx) = Pi;
+        }
+
+        // the feedback K = -B^T*Pi and the feedforward d = -B^T*lambda + B^T*Pi*x
+        MatUX BiTPi(_nu, _nx);
+        VecU vi(_nu);
+        for (int i=0; i<_nt; i++){
+            Eigen::Map<const MatXU> Bi(_Bt.col(i).data(), _nx, _nu);
+            Eigen::Map<const MatXX> Pii(_Pit.col(i).data(), _nx, _nx);
+            BiTPi.noalias() = Bi.transpose() * Pii;
+            Eigen::Map<MatUX>(Kt.col(i).data(), _nu, _nx) = -BiTPi;
+            vi.noalias() = -Bi.transpose()*Xt.col(i).tail(_nx);
+            vi.noalias() += BiTPi * Xt.col(i).head(_nx);
+            dt.col(i) = vi;
+        }
+
+        return std::make_tuple(Kt, dt);
+    }
+
+    /**
+     * @brief The mean steering as one linear system in X_i = [x_i; lambda_i] of all the time points:
+     * x_0 = m0, the Heun's steps X_{i+1} - F_i*X_i = g_i, and x_{nt-1} = m1. The rows follow the time,
+     * so the matrix is banded with 3*nx-1 sub- and super-diagonals and its LU factorization with partial
+     * pivoting costs O(nt*nx^3). The band storage is kept between the solves.
+     */
+    template <int NX>
+    void solve_mean_banded(const MatrixXd& a_r, MatrixXd& Xt){
+        constexpr int NH = NX == Eigen::Dynamic ? Eigen::Dynamic : 2*NX;
+        using MatHH = Eigen::Matrix<double, NH, NH>;
+        using VecH = Eigen::Matrix<double, NH, 1>;
+        const int nh = 2*_nx, dim = nh*_nt;
+
+        if (_mean_lu.rows() != dim || _mean_lu.sub_diagonals() != 3*_nx-1){
+            _mean_lu = BandedLU(dim, 3*_nx-1, 3*_nx-1);
+        }else{
+            _mean_lu.setZero();
+        }
+
+        VectorXd rhs(dim);
+        for (int j=0; j<_nx; j++){
+            _mean_lu.coeffRef(j, j) = 1.0;
+            _mean_lu.coeffRef(dim-_nx+j, dim-nh+j) = 1.0;
+        }
+        rhs.head(_nx) = _m0;
+        rhs.tail(_nx) = _m1;
+
+        // F_i = I + dt/2*(M_i + M_{i+1} + dt*M_{i+1}*M_i), g_i = dt/2*(a_i + a_{i+1} + dt*M_{i+1}*a_i)
+        MatHH Fi(nh, nh);
+        VecH gi(nh);
+        for (int i=0; i<_nt-1; i++){
+            Eigen::Map<const MatHH> Mi(_Mt.col(i).data(), nh, nh);
+            Eigen::Map<const MatHH> Mi_next(_Mt.col(i+1).data(), nh, nh);
+            Fi.noalias() = Mi_next*Mi;
+            Fi = MatHH::Identity(nh, nh) + _delta_t * (Mi + Mi_next + _delta_t*Fi) / 2.0;
+            gi.noalias() = Mi_next*a_r.col(i);
+            gi = _delta_t * (a_r.col(i) + a_r.col(i+1) + _delta_t*gi) / 2.0;
+
+            const int row = _nx + nh*i;
+            for (int c=0; c<nh; c++){
+                for (int r=0; r<nh; r++){
+                    _mean_lu.coeffRef(row+r, nh*i+c) = -Fi(r, c);
+                }
+                _mean_lu.coeffRef(row+c, nh*(i+1)+c) = 1.0;
+            }
+            rhs.segment(row, nh) = gi;
+        }
+
+        if (!_mean_lu.factorize()){
+            throw std::runtime_error("LinearCovarianceSteering: the banded mean steering system is singular.");
+        }
+        VectorXd X = _mean_lu.solve(rhs);
+        Xt = X.reshaped(nh, _nt);
+    }
+
     Matrix3D _At, _Bt, _at;
     Matrix3D _Qt, _rt;
 
     int _nx, _nu, _nt;
 
     MatrixXd _Phi, _Phi11, _Phi12;
+    VectorXd _s; // the offset of the Hamiltonian system forced by (a, -r) over the horizon
+
+    // the means and costates [x; lambda], and the sparse solver of their boundary value problem
+    MatrixXd _Xt;
+    bool _banded_mean = false;
+    BandedLU _mean_lu;
+
+    // threads of the transition matrix integration, the hardware concurrency if <= 0
+    int _n_threads = 1;
+    static constexpr int MIN_STEPS_PER_THREAD = 128;
 
     Matrix3D _Mt, _Pit;
     VectorXd _m0, _m1;
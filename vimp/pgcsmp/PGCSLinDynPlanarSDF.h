@@ -42,7 +42,7 @@ public:
         std::pair<double, VectorXd> hingeloss_gradient;
         MatrixXd zi(_nx, 1);
         for (int i=0; i<_nt; i++){
-            zi = _ei.decomp3d(_zkt, _nx, 1, i);
+            zi = _zkt.slice(i, _nx, 1);
             double zi_x = zi(0), zi_y = zi(1);
             MatrixXd J_hxy(1, _nx/2);
             hingeloss_gradient = hingeloss_gradient_point(zi_x, zi_y, _sdf, _eps_sdf, J_hxy);
@@ -56,8 +56,8 @@ public:
         double total_Eu = 0;
         MatrixXd zi(_nx, 1), Ki(_nu, _nx);
         for (int i=0; i<_nt; i++){
-            zi = _ei.decomp3d(_zkt, _nx, 1, i);
-            Ki = _ei.decomp3d(_Kt, _nu, _nx, i);
+            zi = _zkt.slice(i, _nx, 1);
+            Ki = _Kt.slice(i, _nu, _nx);
             VectorXd u_i = Ki * zi;
             double E_ui = u_i.dot(u_i) * _deltt;
             total_Eu += E_ui;
@@ -101,14 +101,14 @@ public:
         _Qkt.setZero();
         _rkt.setZero();
         for (int i=0; i<_nt; i++){
-            Aki = _ei.decomp3d(_Akt, _nx, _nx, i);
-            aki = _ei.decomp3d(_akt, _nx, 1, i);
-            hAi = _ei.decomp3d(_hAkt, _nx, _nx, i);
-            hai = _ei.decomp3d(_hakt, _nx, 1, i);
-            Bi = _ei.decomp3d(_Bt, _nx, _nu, i);
-            Qti = _ei.decomp3d(_Qt, _nx, _nx, i);
-            pinvBBTi = _ei.decomp3d(_pinvBBTt, _nx, _nx, i);
-            zi = _ei.decomp3d(_zkt, _nx, 1, i);
+            Aki = _Akt.slice(i, _nx, _nx);
+            aki = _akt.slice(i, _nx, 1);
+            hAi = _hAkt.slice(i, _nx, _nx);
+            hai = _hakt.slice(i, _nx, 1);
+            Bi = _Bt.slice(i, _nx, _nu);
+            Qti = _Qt.slice(i, _nx, _nx);
+            pinvBBTi = pinvBBTt_i(i);
+            zi = _zkt.slice(i, _nx, 1);
             temp = (Aki - hAi).transpose();
 
             // Compute hinge loss and its gradients
@@ -10,6 +10,7 @@
  */
 
 #include "pgcsmp/ProximalGradientCSLinearDyn.h"
+#include "pgcsmp/TrajectoryCollision.h"
 #include "helpers/CostHelper.h"
 #include <iomanip>
 
@@ -31,29 +32,19 @@ public:
                         _eps_sdf(params.eps_sdf()),
                         _sig_obs(params.sig_obs()),
                         _robot_sdf(params.eps_sdf(), params.radius(), params.map_name(), params.sdf_file()),
-                        _cost_helper(_max_iter)
+                        _cost_helper(_max_iter),
+                        _collision(params.eps_sdf(), params.sig_obs(), params.max_n_backtrack()+1)
                         {}
 
-    double hingeloss(const Matrix3D& zt, const Matrix3D& Sigt){
-        double hingeloss = 0;
-        std::pair<double, VectorXd> hingeloss_gradient;
-        MatrixXd zi(_nx, 1);
-        for (int i=0; i<_nt; i++){
-            zi = _ei.decomp3d(zt, _nx, 1, i);
-
-            // Compute hinge loss and its gradients
-            int n_spheres = _robot_sdf.RobotModel().nr_body_spheres();
-            std::tuple<VectorXd, MatrixXd> hingeloss_gradient;
-
-            hingeloss_gradient = _robot_sdf.hinge_jacobian(zi.block(0,0,_nx/2,1));
-
-            VectorXd hinge(n_spheres);
-            hinge = std::get<0>(hingeloss_gradient);
+    /**
+     * @brief The hinge losses and Jacobians of all the time steps of zt, one batch sdf query per trajectory.
+     */
+    std::shared_ptr<const TrajectoryCollision> collision(const Matrix3D& zt){
+        return _collision.evaluate(_robot_sdf, zt, _nx/2);
+    }
 
-            MatrixXd Sig_obs{_sig_obs * MatrixXd::Identity(n_spheres, n_spheres)};
-            hingeloss += hinge.transpose() * Sig_obs * hinge;
-        }
-        return hingeloss;
+    double hingeloss(const Matrix3D& zt, const Matrix3D& Sigt){
+        return collision(zt)->hingeloss;
     }
 
     double hingeloss(){
@@ -65,9 +56,9 @@ public:
         MatrixXd zi(_nx, 1), Ki(_nu, _nx), di(_nu, 1);
 
         for (int i=0; i<_nt; i++){
-            zi = _ei.decomp3d(zt, _nx, 1, i);
-            Ki = _ei.decomp3d(Kt, _nu, _nx, i);
-            di = _ei.decomp3d(dt, _nu, 1, i);
+            zi = zt.slice(i, _nx, 1);
+            Ki = Kt.slice(i, _nu, _nx);
+            di = dt.slice(i, _nu, 1);
 
             VectorXd u_i(_nu, 1);
             u_i = Ki * zi + di;
@@ -138,6 +129,27 @@ public:
             
             // std::cout << "================ iter " << i_step << " ================" << std::endl;
 
+            // tentative one step and its costs
+            BacktrackTrial trial = [&](double step_size, LinearCovarianceSteering& linear_cs){
+                StepResult KtdtAtatztSigt; // return type of one step: (Kt, dt, At, at, zt, Sigt) 
+                KtdtAtatztSigt = step(i_step, step_size, _Akt, _Bt, _akt, _hAkt, _hakt, _zkt, _Sigkt, linear_cs);
+
+                const Matrix3D& Kt = std::get<0>(KtdtAtatztSigt);
+                const Matrix3D& dt = std::get<1>(KtdtAtatztSigt);
+                const Matrix3D& zt = std::get<4>(KtdtAtatztSigt);
+                const Matrix3D& Sigt = std::get<5>(KtdtAtatztSigt);
+
+                double collision_cost = hingeloss(zt, Sigt);
+                double Eu = control_energy(zt, Sigt, Kt, dt);
+                return std::make_tuple(KtdtAtatztSigt, collision_cost, Eu);
+            };
+
+            // all the step sizes at once, or one after another until a better cost
+            std::vector<TrialResult> trials;
+            if (_backtrack_threads != 1){
+                trials = speculative_backtrack(trial);
+            }
+
             // backtracking 
             double step_size = _eta; // initial step size
             double best_backtrack_cost = 1e9;
@@ -146,21 +158,12 @@ public:
 
                 // std::cout << " ----- backtracking " << i_bt << " ----- " << std::endl;
 
-                // tentative one step
-                StepResult KtdtAtatztSigt; // return type of one step: (Kt, dt, At, at, zt, Sigt) 
-                KtdtAtatztSigt = step(i_step, step_size, _Akt, _Bt, _akt, _hAkt, _hakt, _zkt, _Sigkt);
+                TrialResult trial_res = trials.empty() ? trial(step_size, _linear_cs) : trials[i_bt];
+                const StepResult& KtdtAtatztSigt = std::get<0>(trial_res);
 
-                // compute the tentative cost
-                Matrix3D zt(_nx, 1, _nt), Sigt(_nx, _nx, _nt), Kt(_nu, _nx, _nt), dt(_nu, 1, _nt);
-                zt.setZero(); Kt.setZero(); dt.setZero(); Sigt.setZero();
-                
-                Kt = std::get<0>(KtdtAtatztSigt);
-                dt = std::get<1>(KtdtAtatztSigt);
-                zt = std::get<4>(KtdtAtatztSigt);
-                Sigt = std::get<5>(KtdtAtatztSigt);
-
-                double total_cost = control_energy(zt, Sigt, Kt, dt) + hingeloss(zt, Sigt);
-                _cost_helper.add_cost(i_step, hingeloss(zt, Sigt), control_energy(zt, Sigt, Kt, dt));
+                // the tentative cost
+                double total_cost = std::get<2>(trial_res) + std::get<1>(trial_res);
+                _cost_helper.add_cost(i_step, std::get<1>(trial_res), std::get<2>(trial_res));
 
                 std::cout << " total cost " << std::fixed << std::setprecision(4) << total_cost << std::endl;
     
@@ -245,60 +248,33 @@ public:
                                               const Matrix3D& hat,
                                               const double step_size) override
     {
-        MatrixXd Ai(_nx, _nx), Bi(_nx, _nu), pinvBBTi(_nx, _nx), ai(_nx, 1), 
-                 hAi(_nx, _nx), hai(_nx, 1),
-                 Qti(_nx, _nx), Qki(_nx, _nx), rki(_nx, 1), zi(_nx, 1);
-        MatrixXd temp(_nx, _nx);
-
         Matrix3D Qt(_nx, _nx, _nt), rt(_nx, 1, _nt);
-        Qt.setZero();
-        rt.setZero();
 
-        for (int i=0; i<_nt; i++){
-            Ai = _ei.decomp3d(At, _nx, _nx, i);
-            ai = _ei.decomp3d(at, _nx, 1, i);
-            hAi = _ei.decomp3d(hAt, _nx, _nx, i);
-            hai = _ei.decomp3d(hat, _nx, 1, i);
-            Bi = _ei.decomp3d(Bt, _nx, _nu, i);
-            Qti = _ei.decomp3d(_Qt, _nx, _nx, i);
-            pinvBBTi = _ei.decomp3d(_pinvBBTt, _nx, _nx, i);
-            zi = _ei.decomp3d(zt, _nx, 1, i);
-            temp = (Ai - hAi).transpose();
-
-            // Compute hinge loss and its gradients
-            int n_spheres = _robot_sdf.RobotModel().nr_body_spheres();
-
-            std::tuple<VectorXd, MatrixXd> hingeloss_gradient;
-            
-            hingeloss_gradient = _robot_sdf.hinge_jacobian(zi.block(0,0,_nx/2,1));
-
-            VectorXd hinge(n_spheres);
-            MatrixXd J_hxy(n_spheres, _nx/2);
-            hinge = std::get<0>(hingeloss_gradient);
-            J_hxy = std::get<1>(hingeloss_gradient);
-
-            // MatrixXd grad_h(_nx, 1), velocity(_nx/2, 1);
-            MatrixXd grad_h(n_spheres, _nx);
-            grad_h.setZero();
-
-            for (int i_s=0; i_s<n_spheres; i_s++){
-                grad_h.block(i_s,0,1,_nx/2) = J_hxy.row(i_s);
-            }          
-            MatrixXd Sig_obs{_sig_obs * MatrixXd::Identity(n_spheres, n_spheres)};
-            MatrixXd Hess(_nx, _nx);
-            Hess.setZero();
-
-            // Hess = _sig_obs * _sig_obs * MatrixXd::Identity(_nx, _nx);
-
-            // Qki
-            Qki = Hess * step_size / (1+step_size) + temp * pinvBBTi * (Ai - hAi) * step_size / (1+step_size) / (1+step_size);
-            // rki
-            rki = grad_h.transpose() * Sig_obs * hinge * step_size / (1.0 + step_size) +  temp * pinvBBTi * (ai - hai) * step_size / (1+step_size) / (1+step_size);
-            
-            // update Qkt, rkt
-            _ei.compress3d(Qki, Qt, i);
-            _ei.compress3d(rki, rt, i);
-        }
+        // hinge losses and their gradients of all the time steps
+        std::shared_ptr<const TrajectoryCollision> p_col = collision(zt);
+
+        // the time steps are independent: each chunk writes the slices of its own ones
+        parallel_for(_nt, _n_threads, [&](int begin, int end){
+            MatrixXd temp(_nx, _nx), Hess{MatrixXd::Zero(_nx, _nx)};
+            for (int i=begin; i<end; i++){
+                auto Ai = At.slice(i, _nx, _nx);
+                auto ai = at.slice(i, _nx, 1);
+                auto hAi = hAt.slice(i, _nx, _nx);
+                auto hai = hat.slice(i, _nx, 1);
+                auto pinvBBTi = pinvBBTt_i(i);
+                temp = (Ai - hAi).transpose();
+
+                // gradient of the hinge loss: grad_h^T * Sig_obs * hinge
+                auto grad_V_i = p_col->grad_V.col(i);
+
+                // Hess = _sig_obs * _sig_obs * MatrixXd::Identity(_nx, _nx);
+
+                // Qki
+                Qt.slice(i, _nx, _nx) = Hess * step_size / (1+step_size) + temp * pinvBBTi * (Ai - hAi) * step_size / (1+step_size) / (1+step_size);
+                // rki
+                rt.slice(i, _nx, 1) = grad_V_i * step_size / (1.0 + step_size) +  temp * pinvBBTi * (ai - hai) * step_size / (1+step_size) / (1+step_size);
+            }
+        });
 
         return make_tuple(Qt, rt);
     }
@@ -317,6 +293,7 @@ public:
     template <typename SDF>
     void update_sdf(const SDF& sdf){
         _robot_sdf.update_sdf(sdf);
+        _collision.clear();
     }
 
 protected:
@@ -324,5 +301,6 @@ protected:
     double _eps_sdf;
     double _sig_obs; // The inverse of Covariance matrix related to the obs penalty. 
     CostHelper _cost_helper;
+    TrajectoryCollisionCache _collision; // the nominal and the backtracking trials
 };
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
  */
 
 #include "ProximalGradientCSNonlinearDyn.h"
+#include "TrajectoryCollision.h"
 #include "helpers/CostHelper.h"
 #include "helpers/hinge2Dhelper.h"
 #include <gpmp2/kinematics/PointRobotModel.h>
@@ -35,7 +36,12 @@ public:
                         _eps_sdf(params.eps_sdf()),
                         _sig_obs(params.sig_obs()),
                         _robot_sdf(params.eps_sdf(), params.radius(), params.map_name(), params.sdf_file()),
-                        _cost_helper(_max_iter){}
+                        _cost_helper(_max_iter),
+                        _collision(params.eps_sdf(), params.sig_obs(), params.max_n_backtrack()+1)
+                        {
+                            _Qkt.setZero();
+                            _rkt.setZero();
+                        }
 
     PGCSPlanarQuadSDF(const MatrixXd& A0, 
                         const VectorXd& a0, 
@@ -55,7 +61,12 @@ public:
                         int max_iter=20): ProxGradCovSteerNLDyn(A0, a0, B, sig, nt, eta, eps, z0, Sig0, zT, SigT, pdyn, max_iter),
                                         _eps_sdf(eps_sdf),
                                         _sdf(sdf),
-                                        _sig_obs(sig_obs){}
+                                        _sig_obs(sig_obs),
+                                        _collision(eps_sdf, sig_obs)
+                                        {
+                                            _Qkt.setZero();
+                                            _rkt.setZero();
+                                        }
 
     std::tuple<Matrix3D, Matrix3D> update_Qrk(const Matrix3D& zt, 
                                                 const Matrix3D& Sigt, 
@@ -76,85 +87,55 @@ public:
                                                 const Matrix3D& nTrt,
                                                 const double step_size) override
     {
-        MatrixXd Ai(_nx, _nx), Bi(_nx, _nu), pinvBBTi(_nx, _nx), ai(_nx, 1), 
-                 hAi(_nx, _nx), hai(_nx, 1), nTri(_nx, 1),
-                 Qti(_nx, _nx), Qki(_nx, _nx), rki(_nx, 1), zi(_nx, 1);
-        MatrixXd temp(_nx, _nx);
-
         Matrix3D Qt(_nx, _nx, _nt), rt(_nx, 1, _nt);
-        Qt.setZero();
-        rt.setZero();
 
-        // for each time step
-        _Qkt.setZero();
-        _rkt.setZero();
-        Matrix3D par_V_x = grad_V(zt);
-        for (int i=0; i<_nt; i++){
-            Ai = _ei.decomp3d(At, _nx, _nx, i);
-            ai = _ei.decomp3d(at, _nx, 1, i);
-            hAi = _ei.decomp3d(hAt, _nx, _nx, i);
-            hai = _ei.decomp3d(hat, _nx, 1, i);
-            Bi = _ei.decomp3d(Bt, _nx, _nu, i);
-            Qti = _ei.decomp3d(_Qt, _nx, _nx, i);
-            pinvBBTi = _ei.decomp3d(_pinvBBTt, _nx, _nx, i);
-            zi = _ei.decomp3d(zt, _nx, 1, i);
-            temp = (Ai - hAi).transpose();
-            nTri = _ei.decomp3d(nTrt, _nx, 1, i);
-
-            // Compute hinge loss and its gradients
-            VectorXd par_V_x_i = _ei.decomp3d(par_V_x, _nx, 1, i);
-            MatrixXd Hess(_nx, _nx);
-            Hess.setZero(); 
-
-            // Qki
-            Qki = Hess*step_size/(1+step_size) + temp*pinvBBTi*(Ai - hAi)*step_size/(1+step_size)/(1+step_size);
-            // rki
-            rki = par_V_x_i*step_size/(1+step_size) + 
-                    nTri*step_size/(1+step_size)/2 + 
-                    temp*pinvBBTi*(ai - hai)*step_size/(1+step_size) /(1+step_size);
-            
-            // update Qkt, rkt
-            _ei.compress3d(Qki, Qt, i);
-            _ei.compress3d(rki, rt, i);
-        }
+        // for each time step, the gradients of the state cost from the trajectory collision evaluation
+        std::shared_ptr<const TrajectoryCollision> p_col = collision(zt);
+
+        // the time steps are independent: each chunk writes the slices of its own ones
+        parallel_for(_nt, _n_threads, [&](int begin, int end){
+            MatrixXd temp(_nx, _nx), Hess{MatrixXd::Zero(_nx, _nx)};
+            for (int i=begin; i<end; i++){
+                auto Ai = At.slice(i, _nx, _nx);
+                auto ai = at.slice(i, _nx, 1);
+                auto hAi = hAt.slice(i, _nx, _nx);
+                auto hai = hat.slice(i, _nx, 1);
+                auto pinvBBTi = pinvBBTt_i(i);
+                auto nTri = nTrt.slice(i, _nx, 1);
+                temp = (Ai - hAi).transpose();
+
+                // gradient of the hinge loss
+                auto par_V_x_i = p_col->grad_V.col(i);
+
+                // Qki
+                Qt.slice(i, _nx, _nx) = Hess*step_size/(1+step_size) + temp*pinvBBTi*(Ai - hAi)*step_size/(1+step_size)/(1+step_size);
+                // rki
+                rt.slice(i, _nx, 1) = par_V_x_i*step_size/(1+step_size) + 
+                                      nTri*step_size/(1+step_size)/2 + 
+                                      temp*pinvBBTi*(ai - hai)*step_size/(1+step_size) /(1+step_size);
+            }
+        });
 
         return make_tuple(Qt, rt);
         
     }
 
 
+    /**
+     * @brief The hinge losses and Jacobians of the positions (px, pz) of all the time steps of zt, 
+     * one batch sdf query per trajectory.
+     */
+    std::shared_ptr<const TrajectoryCollision> collision(const Matrix3D& zt){
+        return _collision.evaluate(_robot_sdf, zt, 2);
+    }
+
+    /**
+     * @brief The gradients grad_h^T * Sig_obs * hinge of the state cost, the Jacobians w.r.t. the 2D positions (px, pz).
+     */
     Matrix3D grad_V(const Matrix3D& zt){
         Matrix3D grad_V_res(_nx, 1, _nt);
-
-        for (int i=0; i<_nt; i++){
-            VectorXd zi(_nx, 1);
-            zi = _ei.decomp3d(zt, _nx, 1, i);
-            std::tuple<VectorXd, MatrixXd> hingeloss_gradient;
-
-            hingeloss_gradient = _robot_sdf.hinge_jacobian(zi);
-            VectorXd hinge = std::get<0>(hingeloss_gradient);
-
-            int n_spheres = hinge.rows();
-            // Jacobian w.r.t. the 2D positions (px, pz)
-            MatrixXd J_hxy(n_spheres, 2);
-            J_hxy = std::get<1>(hingeloss_gradient);
-
-            // Jacobian w.r.t. the whole state space
-            MatrixXd grad_h(n_spheres, _nx);
-            grad_h.setZero();
-            
-            for (int i_s=0; i_s<n_spheres; i_s++){
-                grad_h.block(i_s,0,1,2) = J_hxy.row(i_s);
-            }      
-
-            MatrixXd Sig_obs{_sig_obs * MatrixXd::Identity(n_spheres, n_spheres)};
-            VectorXd grad_V_i = grad_h.transpose()*Sig_obs*hinge;
-            _ei.compress3d(grad_V_i, grad_V_res, i);
-
-        }
-
+        grad_V_res = collision(zt)->grad_V;
         return grad_V_res;
-
     }
 
     double control_energy(const Matrix3D& zt, const Matrix3D& Sigt, const Matrix3D& Kt, const Matrix3D& dt){
@@ -162,9 +143,9 @@ public:
         MatrixXd zi(_nx, 1), Ki(_nu, _nx), di(_nu, 1);
 
         for (int i=0; i<_nt; i++){
-            zi = _ei.decomp3d(zt, _nx, 1, i);
-            Ki = _ei.decomp3d(Kt, _nu, _nx, i);
-            di = _ei.decomp3d(dt, _nu, 1, i);
+            zi = zt.slice(i, _nx, 1);
+            Ki = Kt.slice(i, _nu, _nx);
+            di = dt.slice(i, _nu, 1);
 
             VectorXd u_i(_nu, 1);
             u_i = Ki * zi + di;
@@ -181,25 +162,7 @@ public:
     }
 
     double hingeloss(const Matrix3D& zt, const Matrix3D& Sigt){
-        double hingeloss = 0;
-        std::pair<double, VectorXd> hingeloss_gradient;
-        MatrixXd zi(_nx, 1);
-        for (int i=0; i<_nt; i++){
-            zi = _ei.decomp3d(zt, _nx, 1, i);
-
-            // Compute hinge loss and its gradients
-            int n_spheres = _robot_sdf.RobotModel().nr_body_spheres();
-            std::tuple<VectorXd, MatrixXd> hingeloss_gradient;
-
-            hingeloss_gradient = _robot_sdf.hinge_jacobian(zi.block(0,0,2,1));
-
-            VectorXd hinge(n_spheres);
-            hinge = std::get<0>(hingeloss_gradient);
-
-            MatrixXd Sig_obs{_sig_obs * MatrixXd::Identity(n_spheres, n_spheres)};
-            hingeloss += hinge.transpose() * Sig_obs * hinge;
-        }
-        return hingeloss;
+        return collision(zt)->hingeloss;
     }
 
     double hingeloss(){
@@ -227,6 +190,27 @@ public:
             
             std::cout << "================ iter " << i_step << " ================" << std::endl;
 
+            // tentative one step and its costs
+            BacktrackTrial trial = [&](double step_size, LinearCovarianceSteering& linear_cs){
+                StepResult KtdtAtatztSigt; // return type of one step: (Kt, dt, At, at, zt, Sigt) 
+                KtdtAtatztSigt = step(i_step, step_size, _Akt, _Bt, _akt, _zkt, _Sigkt, linear_cs);
+
+                const Matrix3D& Kt = std::get<0>(KtdtAtatztSigt);
+                const Matrix3D& dt = std::get<1>(KtdtAtatztSigt);
+                const Matrix3D& zt = std::get<4>(KtdtAtatztSigt);
+                const Matrix3D& Sigt = std::get<5>(KtdtAtatztSigt);
+
+                double collision_cost = hingeloss(zt, Sigt);
+                double Eu = control_energy(zt, Sigt, Kt, dt);
+                return std::make_tuple(KtdtAtatztSigt, collision_cost, Eu);
+            };
+
+            // all the step sizes at once, or one after another until a better cost
+            std::vector<TrialResult> trials;
+            if (_backtrack_threads != 1){
+                trials = speculative_backtrack(trial);
+            }
+
             // backtracking 
             double step_size = _eta; // initial step size
             double best_backtrack_cost = 1e9;
@@ -234,21 +218,12 @@ public:
             for (int i_bt=0; i_bt<_max_n_backtrack; i_bt++){
 
                 std::cout << " ----- backtracking " << i_bt << " ----- " << std::endl;
-                // tentative one step
-                StepResult KtdtAtatztSigt; // return type of one step: (Kt, dt, At, at, zt, Sigt) 
-                KtdtAtatztSigt = step(i_step, step_size, _Akt, _Bt, _akt, _zkt, _Sigkt);
-
-                // compute the tentative cost
-                Matrix3D zt(_nx, 1, _nt), Sigt(_nx, _nx, _nt), Kt(_nu, _nx, _nt), dt(_nu, 1, _nt);
-                zt.setZero(); Kt.setZero(); dt.setZero(); Sigt.setZero();
-
-                Kt = std::get<0>(KtdtAtatztSigt);
-                dt = std::get<1>(KtdtAtatztSigt);
-                zt = std::get<4>(KtdtAtatztSigt);
-                Sigt = std::get<5>(KtdtAtatztSigt);
+                TrialResult trial_res = trials.empty() ? trial(step_size, _linear_cs) : trials[i_bt];
+                const StepResult& KtdtAtatztSigt = std::get<0>(trial_res);
 
-                double total_cost = control_energy(zt, Sigt, Kt, dt) + hingeloss(zt, Sigt);
-                _cost_helper.add_cost(i_step, hingeloss(zt, Sigt), control_energy(zt, Sigt, Kt, dt));
+                // the tentative cost
+                double total_cost = std::get<2>(trial_res) + std::get<1>(trial_res);
+                _cost_helper.add_cost(i_step, std::get<1>(trial_res), std::get<2>(trial_res));
 
                 std::cout << " total cost " << std::fixed << std::setprecision(7) << total_cost << std::endl;
     
@@ -336,8 +311,8 @@ public:
         MatrixXd r_star_i(_nx, 1);
         r_star_i.setZero();
         for (int i=0; i<_nt; i++){
-            VectorXd par_V_x_i = _ei.decomp3d(par_V_x, _nx, 1, i);
-            VectorXd nTri = _ei.decomp3d(nTr_star, _nx, 1, i);
+            VectorXd par_V_x_i = par_V_x.slice(i, _nx, 1);
+            VectorXd nTri = nTr_star.slice(i, _nx, 1);
             r_star_i = par_V_x_i + nTri / 2;
             // r_star_i = _ei.decomp3d(nTr_star, _nx, 1, i) / 2;
             _ei.compress3d(r_star_i, r_star, i);
@@ -371,5 +346,6 @@ protected:
     double _eps_sdf;
     double _sig_obs; // The inverse of Covariance matrix related to the obs penalty. 
     CostHelper _cost_helper;
+    TrajectoryCollisionCache _collision; // the nominal and the backtracking trials
 };
 }
\ No newline at end of file
@@ -34,6 +34,7 @@ public:
                                 _hAkt = pdyn->At();
                                 _Bt = pdyn->Bt();
                                 _hakt = pdyn->at();
+                                update_pinvBBT();
                             }
 
     /**
@@ -68,6 +69,19 @@ public:
                     const Matrix3D& At, const Matrix3D& Bt, const Matrix3D& at,
                     const Matrix3D& hAt, const Matrix3D& hat, 
                     const VectorXd& z0, const MatrixXd& Sig0) override
+    {
+        return step(indx, step_size, At, Bt, at, hAt, hat, z0, Sig0, _linear_cs);
+    }
+
+    /**
+     * @brief A step solving its linear CS with the given solver, so that the steps of different step sizes can run concurrently.
+     * @return (Kkt, dkt, Akt, akt, zkt, Sigkt) 
+     */
+    StepResult step(int indx, double step_size, 
+                    const Matrix3D& At, const Matrix3D& Bt, const Matrix3D& at,
+                    const Matrix3D& hAt, const Matrix3D& hat, 
+                    const VectorXd& z0, const MatrixXd& Sig0,
+                    LinearCovarianceSteering& linear_cs)
     {
         // propagate the mean and the covariance
         
@@ -92,7 +106,7 @@ public:
 
         // solve inner loop linear CS
         std::tuple<Matrix3D, Matrix3D, Matrix3D, Matrix3D> KtdtAtat;
-        KtdtAtat = solve_linearCS_return(Aprior, Bt, aprior, Qt, rt);
+        KtdtAtat = solve_linearCS_return(Aprior, Bt, aprior, Qt, rt, linear_cs);
 
         return std::make_tuple(std::get<0>(KtdtAtat), 
                                std::get<1>(KtdtAtat), 
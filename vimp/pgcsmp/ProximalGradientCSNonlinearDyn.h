@@ -29,7 +29,9 @@ public:
                             const PGCSParams& params,
                             std::shared_ptr<NonlinearDynamics> pdyn): 
                                             ProxGradCovSteer(A0, a0, B, params), 
-                                            _pdyn(pdyn){}
+                                            _pdyn(pdyn){
+                                                _pdyn->set_n_threads(params.n_threads());
+                                            }
 
     ProxGradCovSteerNLDyn(const MatrixXd& A0, 
                         const VectorXd& a0, 
@@ -47,6 +49,11 @@ public:
                                             _pdyn(pdyn){}
     
 
+    void set_n_threads(int n_threads) override{
+        ProxGradCovSteer::set_n_threads(n_threads);
+        _pdyn->set_n_threads(n_threads);
+    }
+
     void step(int indx) override{}
 
     StepResult step(int indx, double step_size, 
@@ -61,6 +68,18 @@ public:
     StepResult step(int indx, double step_size, 
                     const Matrix3D& At, const Matrix3D& Bt, const Matrix3D& at, 
                     const VectorXd& z0, const MatrixXd& Sig0) override
+    {
+        return step(indx, step_size, At, Bt, at, z0, Sig0, _linear_cs);
+    }
+
+    /**
+     * @brief A step solving its linear CS with the given solver, so that the steps of different step sizes can run concurrently.
+     * @return (Kkt, dkt, Akt, akt, zkt, Sigkt) 
+     */
+    StepResult step(int indx, double step_size, 
+                    const Matrix3D& At, const Matrix3D& Bt, const Matrix3D& at, 
+                    const VectorXd& z0, const MatrixXd& Sig0,
+                    LinearCovarianceSteering& linear_cs)
     {
         // propagate the mean and the covariance
         std::tuple<Matrix3D, Matrix3D> ztSigt;
@@ -94,7 +113,7 @@ public:
 
         // solve inner loop linear CS
         std::tuple<Matrix3D, Matrix3D, Matrix3D, Matrix3D> KtdtAtat;
-        KtdtAtat = solve_linearCS_return(Aprior, Bt, aprior, Qt, rt);
+        KtdtAtat = solve_linearCS_return(Aprior, Bt, aprior, Qt, rt, linear_cs);
 
         return std::make_tuple(std::get<0>(KtdtAtat), 
                                std::get<1>(KtdtAtat), 
@@ -13,9 +13,11 @@
 
 #include "helpers/ExperimentParams.h"
 #include "LinearCovarianceSteering.h"
+#include <functional>
 #include <memory>
 #include <Eigen/QR>
 #include "helpers/DataRecorder.h"
+#include "helpers/ParallelFor.h"
 
 using namespace Eigen;
 
@@ -30,6 +32,12 @@ namespace vimp{
     // return type of linear covariance steering: (Kt, dt, At, at)
     using LinearCSResult = std::tuple<Matrix3D, Matrix3D, Matrix3D, Matrix3D>;
 
+    // return type of one backtracking trial: (step result, hinge loss, control energy)
+    using TrialResult = std::tuple<StepResult, double, double>;
+
+    // one backtracking trial with a step size, solving its linear CS with the given solver
+    using BacktrackTrial = std::function<TrialResult(double, LinearCovarianceSteering&)>;
+
     class ProxGradCovSteer
     {
     public:
@@ -60,13 +68,15 @@ namespace vimp{
                         _stop_err(params.stop_err()),
                         _backtrack_ratio(params.backtrack_ratio()),
                         _max_n_backtrack(params.max_n_backtrack()),
+                        _backtrack_threads(params.backtrack_threads()),
+                        _n_threads(params.n_threads()),
                         _Qkt(Matrix3D(params.nx(), params.nx(), params.nt())),
                         _Qt(Matrix3D(params.nx(), params.nx(), params.nt())),
                         _rkt(Matrix3D(params.nx(), 1, params.nt())),
                         _hAkt(Matrix3D(params.nx(), params.nx(), params.nt())),
                         _hakt(Matrix3D(params.nx(), 1, params.nt())),
                         _nTrt(Matrix3D(params.nx(), 1, params.nt())),
-                        _pinvBBTt(Matrix3D(params.nx(), params.nx(), params.nt())),
+                        _pinvBBTt(Matrix3D(params.nx(), params.nx(), 1)),
                         _zkt(_ei.replicate3d(params.m0(), params.nt())),
                         _Sigkt(_ei.replicate3d(params.Sig0(), params.nt())),
                         _Kt(params.nu(), params.nx(), params.nt()),
@@ -79,14 +89,10 @@ namespace vimp{
                             _ei.compress3d(_SigT, _Sigkt, _nt - 1);
 
                             // compute pinvBBT
-                            MatrixXd Bi(_nx, _nu), BiT(_nu, _nx), pinvBBTi(_nx, _nx);
-                            for (int i = 0; i < _nt; i++)
-                            {
-                                Bi = Bt_i(i);
-                                BiT = Bi.transpose();
-                                pinvBBTi = (Bi * BiT).completeOrthogonalDecomposition().pseudoInverse();
-                                _ei.compress3d(pinvBBTi, _pinvBBTt, i);
-                            }
+                            update_pinvBBT();
+
+                            _linear_cs.set_n_threads(params.n_threads());
+                            _linear_cs.use_banded_mean(params.banded_mean());
 
                         }
         
@@ -120,7 +126,7 @@ namespace vimp{
                         _hAkt(Matrix3D(_nx, _nx, nt)),
                         _hakt(Matrix3D(_nx, 1, nt)),
                         _nTrt(Matrix3D(_nx, 1, nt)),
-                        _pinvBBTt(Matrix3D(_nx, _nx, nt)),
+                        _pinvBBTt(Matrix3D(_nx, _nx, 1)),
                         _zkt(_ei.replicate3d(z0, nt)),
                         _Sigkt(_ei.replicate3d(Sig0, nt)),
                         _z0(z0),
@@ -137,13 +143,25 @@ namespace vimp{
             // Initialize the final time covariance
             _ei.compress3d(_SigT, _Sigkt, nt - 1);
             // compute pinvBBT
-            MatrixXd Bi(_nx, _nu), BiT(_nu, _nx), pinvBBTi(_nx, _nx);
-            for (int i = 0; i < nt; i++)
+            update_pinvBBT();
+        }
+
+        /**
+         * @brief The pseudo inverses of B*B^T in the state costs. A time invariant B is 
+         * factorized once and its pseudo inverse stored as a single slice.
+         */
+        void update_pinvBBT()
+        {
+            _B_constant = _ei.is_time_invariant(_Bt);
+            int n_slices = _B_constant ? 1 : _nt;
+            _pinvBBTt = Matrix3D(_nx, _nx, n_slices);
+
+            MatrixXd Bi(_nx, _nu), BiT(_nu, _nx);
+            for (int i = 0; i < n_slices; i++)
             {
-                Bi = Bt_i(i);
+                Bi = _Bt.slice(i, _nx, _nu);
                 BiT = Bi.transpose();
-                pinvBBTi = (Bi * BiT).completeOrthogonalDecomposition().pseudoInverse();
-                _ei.compress3d(pinvBBTi, _pinvBBTt, i);
+                _pinvBBTt.slice(i) = (Bi * BiT).completeOrthogonalDecomposition().pseudoInverse();
             }
         }
 
@@ -185,6 +203,49 @@ namespace vimp{
          */
         virtual std::tuple<Matrix3D, Matrix3D, NominalHistory> backtrack(){}
 
+        /**
+         * @brief The trials of all the step sizes eta, eta*ratio, ... of one backtracking iteration at once,
+         * on the backtrack threads and with one copy of the linear CS solver per trial. 
+         * The trials are independent, so the results are those of the trials run one after another.
+         */
+        std::vector<TrialResult> speculative_backtrack(const BacktrackTrial& trial)
+        {
+            std::vector<double> step_sizes(_max_n_backtrack);
+            double step_size = _eta;
+            for (int i_bt = 0; i_bt < _max_n_backtrack; i_bt++)
+            {
+                step_sizes[i_bt] = step_size;
+                step_size = _backtrack_ratio*step_size;
+            }
+
+            std::vector<LinearCovarianceSteering> linear_cs(_max_n_backtrack, _linear_cs);
+            std::vector<TrialResult> results(_max_n_backtrack);
+            parallel_for(_max_n_backtrack, _backtrack_threads, [&](int begin, int end){
+                for (int i_bt = begin; i_bt < end; i_bt++)
+                {
+                    results[i_bt] = trial(step_sizes[i_bt], linear_cs[i_bt]);
+                }
+            });
+            return results;
+        }
+
+        /**
+         * @brief Try the step sizes of a backtracking iteration concurrently when the backtrack threads is not 1.
+         * @param n_threads the number of threads, the hardware concurrency if <= 0
+         */
+        void set_backtrack_threads(int n_threads) { _backtrack_threads = n_threads; }
+
+        /**
+         * @brief The threads of the loops over the time steps, e.g., the Q/r assembly, and of the Phi and s 
+         * integration in the linear covariance steering. Each time step of the loops is computed as in the serial loop,
+         * the integration depends on the threads up to the rounding.
+         * @param n_threads the number of threads, the hardware concurrency if <= 0
+         */
+        virtual void set_n_threads(int n_threads) { 
+            _n_threads = n_threads; 
+            _linear_cs.set_n_threads(n_threads);
+        }
+
         /**
          * @brief step with given matrices, return a total cost of this step.
          */
@@ -247,31 +308,34 @@ namespace vimp{
                                              const MatrixXd &a, 
                                              const MatrixXd &Q, 
                                              const MatrixXd &r)
+        {
+            return solve_linearCS_return(A, B, a, Q, r, _linear_cs);
+        }
+
+        /**
+         * @brief solve linear CS with local matrix inputs and a given solver, e.g., one of the concurrent backtracking trials.
+         */
+        LinearCSResult solve_linearCS_return(const MatrixXd &A, 
+                                             const MatrixXd &B, 
+                                             const MatrixXd &a, 
+                                             const MatrixXd &Q, 
+                                             const MatrixXd &r,
+                                             LinearCovarianceSteering& linear_cs)
         {
             // solve for the linear covariance steering
-            _linear_cs.update_params(A, B, a, Q, r);
-            _linear_cs.solve();
+            linear_cs.update_params(A, B, a, Q, r);
+            linear_cs.solve();
 
             // retrieve (K, d)
             Matrix3D Kt(_nu, _nx, _nt), dt(_nu, 1, _nt), At(_nx, _nx, _nt), at(_nx, 1, _nt);
-            Kt = _linear_cs.Kt();
-            dt = _linear_cs.dt();
+            Kt = linear_cs.Kt();
+            dt = linear_cs.dt();
 
-            MatrixXd Ai(_nx, _nx), ai(_nx, 1), Bi(_nx, _nu), Aprior_i(_nx, _nx), aprior_i(_nx, 1), Ki(_nu, _nx), di(_nx, 1);
             for (int i = 0; i < _nt; i++)
             {
-                Aprior_i = _ei.decomp3d(A, _nx, _nx, i);
-                aprior_i = _ei.decomp3d(a, _nx, 1, i);
-
-                Bi = Bt_i(i);
-                Ki = _ei.decomp3d(Kt, _nu, _nx, i);
-                di = _ei.decomp3d(dt, _nu, 1, i);
-
-                Ai = Aprior_i + Bi * Ki;
-                ai = aprior_i + Bi * di;
-
-                _ei.compress3d(Ai, At, i);
-                _ei.compress3d(ai, at, i);
+                auto Bi = _Bt.slice(i, _nx, _nu);
+                At.slice(i, _nx, _nx) = slice3d(A, _nx, _nx, i) + Bi * Kt.slice(i, _nu, _nx);
+                at.slice(i, _nx, 1) = slice3d(a, _nx, 1, i) + Bi * dt.slice(i, _nu, 1);
             }
             return std::make_tuple(Kt, dt, At, at);
         }
@@ -290,13 +354,16 @@ namespace vimp{
                                                          const VectorXd& z0, 
                                                          const MatrixXd& Sig0)
         {
-            // The i_th matrices
-            Eigen::VectorXd zi(_nx), znew(_nx), zt_next(_nx), ai(_nx), ai_next(_nx);
-            Eigen::MatrixXd Ai(_nx, _nx), Bi(_nx, _nu), AiT(_nx, _nx), BiT(_nu, _nx); 
-            Eigen::MatrixXd Si(_nx, _nx), Snew(_nx, _nx), Si_next(_nx, _nx);
-            Eigen::MatrixXd Ai_next(_nx, _nx), Bi_next(_nx, _nu), AiT_next(_nx, _nx), BiT_next(_nu, _nx);
+            // The i_th matrices are views of the time slices
+            Eigen::VectorXd zt_next(_nx);
+            Eigen::MatrixXd Si_next(_nx, _nx);
             Matrix3D zt_new(_nx, 1, _nt), Sigt_new(_nx, _nx, _nt);
 
+            // the diffusions eps*B*B^T, computed once for a time invariant B
+            bool B_constant = _ei.is_time_invariant(Bt);
+            Eigen::MatrixXd BBTi(_nx, _nx), BBTi_next(_nx, _nx);
+            BBTi_next = Bt.slice(0, _nx, _nu) * Bt.slice(0, _nx, _nu).transpose();
+
             zt_new.setZero();
             Sigt_new.setZero();
 
@@ -305,33 +372,28 @@ namespace vimp{
 
             for (int i = 0; i < _nt - 1; i++)
             {
-                Ai = _ei.decomp3d(At, _nx, _nx, i);
-                ai = _ei.decomp3d(at, _nx, 1, i);
-                Bi = _ei.decomp3d(Bt, _nx, _nu, i);
-                AiT = Ai.transpose();
-                BiT = Bi.transpose();
+                auto Ai = At.slice(i, _nx, _nx);
+                auto ai = at.slice(i, _nx, 1);
+
+                auto zi = zt_new.slice(i, _nx, 1);
+                auto Si = Sigt_new.slice(i, _nx, _nx);
 
-                zi = _ei.decomp3d(zt_new, _nx, 1, i);
-                Si = _ei.decomp3d(Sigt_new, _nx, _nx, i);
+                BBTi = BBTi_next;
+                if (!B_constant){
+                    auto Bi_next = Bt.slice(i+1, _nx, _nu);
+                    BBTi_next = Bi_next * Bi_next.transpose();
+                }
                 
                 // Heun's method
                 zt_next = zi + _deltt * (Ai * zi + ai);
-                Si_next = Si + _deltt * (Ai * Si + Si * AiT + _eps * (Bi * BiT));
-
-                Ai_next = _ei.decomp3d(At, _nx, _nx, i+1);
-                ai_next = _ei.decomp3d(at, _nx, 1, i+1);
-                Bi_next = _ei.decomp3d(Bt, _nx, _nu, i+1);
-                AiT_next = Ai_next.transpose();
-                BiT_next = Bi_next.transpose();
-
-                VectorXd ztnew_i = VectorXd::Zero(_nx);
-                MatrixXd Snew_i = MatrixXd::Zero(_nx, _nx);
+                Si_next = Si + _deltt * (Ai * Si + Si * Ai.transpose() + _eps * BBTi);
 
-                ztnew_i = zi + _deltt*((Ai*zi + ai) + (Ai_next*zt_next + ai_next)) / 2.0;
-                Snew_i = Si + _deltt*((Ai*Si + Si*AiT + _eps*(Bi*BiT)) + (Ai_next*Si_next + Si_next*AiT_next + _eps*(Bi_next*BiT_next))) / 2.0;
+                auto Ai_next = At.slice(i+1, _nx, _nx);
+                auto ai_next = at.slice(i+1, _nx, 1);
 
-                _ei.compress3d(ztnew_i, zt_new, i + 1);
-                _ei.compress3d(Snew_i, Sigt_new, i + 1);
+                zt_new.slice(i + 1, _nx, 1) = zi + _deltt*((Ai*zi + ai) + (Ai_next*zt_next + ai_next)) / 2.0;
+                Sigt_new.slice(i + 1, _nx, _nx) = Si + _deltt*((Ai*Si + Si*Ai.transpose() + _eps*BBTi) + 
+                                                  (Ai_next*Si_next + Si_next*Ai_next.transpose() + _eps*BBTi_next)) / 2.0;
 
             }
 
@@ -380,7 +442,7 @@ namespace vimp{
 
         inline MatrixXd Qkt_i(int i){ return _ei.decomp3d(_Qkt, _nx, _nx, i);}
 
-        inline MatrixXd pinvBBTt_i(int i){ return _ei.decomp3d(_pinvBBTt, _nx, _nx, i);}
+        inline Eigen::Map<const MatrixXd> pinvBBTt_i(int i) const { return _pinvBBTt.slice(_B_constant ? 0 : i); }
 
         inline MatrixXd nTrt_i(int i){ return _ei.decomp3d(_nTrt, _nx, 1, i);}
         
@@ -406,10 +468,13 @@ namespace vimp{
         int _nx, _nu, _nt;
         double _eta, _total_time, _eps, _deltt, _stop_err, _backtrack_ratio;
         int _max_iter, _max_n_backtrack;
+        int _backtrack_threads = 1; // the step sizes of a backtracking iteration are tried concurrently when not 1
+        int _n_threads = 1; // threads of the loops over the time steps
 
         // All the variables are time variant (3d matrices)
         // iteration variables
         Matrix3D _Akt, _Bt, _akt, _pinvBBTt;
+        bool _B_constant = false; // _pinvBBTt is a single slice for all time points
         Matrix3D _Qkt, _Qt; // Qk is the Q in each iteration, and Qt is the quadratic state cost matrix.
         Matrix3D _rkt;
 
@@ -0,0 +1,101 @@
+/**
+ * @file TrajectoryCollision.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief The hinge losses and their Jacobians of all the states of a nominal trajectory,
+ * evaluated in one batch sdf query and cached per trajectory. The costs, the gradients of the
+ * state cost and the Q/r updates of PGCS all read the same evaluation.
+ * @version 0.1
+ * @date 2023-09-20
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace Eigen;
+
+namespace vimp{
+
+/**
+ * @brief The collision evaluation of a trajectory of nt states, whose first rows are the robot configurations.
+ */
+struct TrajectoryCollision{
+    MatrixXd positions; // (n_pos, nt) the configurations, the key of the cache
+    MatrixXd hinge; // (n_spheres, nt) the hinge losses of the collision spheres
+    std::vector<MatrixXd> jacobians; // nt Jacobians (n_spheres, n_pos) of the hinge losses wrt the configurations
+    MatrixXd grad_V; // (nx, nt) J^T*sig_obs*h in the configuration rows, 0 in the others
+    double hingeloss; // sig_obs * sum of the squared hinge losses
+};
+
+class TrajectoryCollisionCache{
+public:
+    TrajectoryCollisionCache(){}
+
+    /**
+     * @param capacity the number of trajectories kept, e.g., the nominal and the trials of a backtracking iteration
+     */
+    TrajectoryCollisionCache(double eps_sdf, double sig_obs, int capacity=1):
+    _eps_sdf(eps_sdf), _sig_obs(sig_obs), _capacity(std::max(capacity, 1)){}
+
+    /**
+     * @brief The collision evaluation of the trajectory zt (nx, nt), from the cache if the configurations
+     * zt.topRows(n_pos) were evaluated before, otherwise with one hinge_jacobian_batch query of the robot sdf.
+     * Safe to call concurrently.
+     */
+    template <typename RobotSDF>
+    std::shared_ptr<const TrajectoryCollision> evaluate(const RobotSDF& robot_sdf, const MatrixXd& zt, int n_pos){
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (const std::shared_ptr<const TrajectoryCollision>& p_col : _cache){
+                if (p_col->positions.rows() == n_pos && p_col->positions.cols() == zt.cols() &&
+                    p_col->positions == zt.topRows(n_pos)){
+                    return p_col;
+                }
+            }
+        }
+
+        const int nx = zt.rows(), nt = zt.cols();
+        std::shared_ptr<TrajectoryCollision> p_col = std::make_shared<TrajectoryCollision>();
+        p_col->positions = zt.topRows(n_pos);
+        robot_sdf.hinge_jacobian_batch(p_col->positions, _eps_sdf, p_col->hinge, &p_col->jacobians);
+
+        p_col->grad_V = MatrixXd::Zero(nx, nt);
+        for (int i=0; i<nt; i++){
+            p_col->grad_V.col(i).head(n_pos) = p_col->jacobians[i].transpose() * (_sig_obs * p_col->hinge.col(i));
+        }
+        p_col->hingeloss = _sig_obs * p_col->hinge.squaredNorm();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _cache.push_front(p_col);
+        if (_cache.size() > static_cast<size_t>(_capacity)){
+            _cache.pop_back();
+        }
+        return p_col;
+    }
+
+    /**
+     * @brief Drop the cached evaluations, e.g., when the sdf changes.
+     */
+    void clear(){
+        std::lock_guard<std::mutex> lock(_mutex);
+        _cache.clear();
+    }
+
+    inline int capacity() const { return _capacity; }
+
+private:
+    double _eps_sdf = 0.0, _sig_obs = 0.0;
+    int _capacity = 1;
+    std::deque<std::shared_ptr<const TrajectoryCollision>> _cache;
+    std::mutex _mutex;
+};
+
+}
@@ -0,0 +1,189 @@
+/**
+ * @file BatchArmKinematics.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Forward kinematics of the body sphere centers of a DH arm for a whole matrix of joint configurations at once,
+ * with the same conventions as gpmp2::Arm and gpmp2::ArmModel. The link frames are computed link by link
+ * for all the configurations, each frame component stored contiguously over the configurations (SoA),
+ * and the DH constants are precomputed. The centers come out in the layout of the batch sdf queries (helpers/SDFBatch.h).
+ * @version 0.1
+ * @date 2023-09-12
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace vimp{
+
+class BatchArmKinematics{
+public:
+    BatchArmKinematics(){}
+
+    /**
+     * @param a, alpha, d, theta_bias the DH parameters of the links,
+     * the transform of link j is Rz(theta_j + theta_bias_j) * Tz(d_j) * Tx(a_j) * Rx(alpha_j)
+     * @param base_rotation, base_position the base pose of the arm
+     * @param sphere_links the link of each sphere
+     * @param sphere_centers (3, n_spheres) the sphere centers in their link frames
+     */
+    BatchArmKinematics(const Eigen::VectorXd& a,
+                       const Eigen::VectorXd& alpha,
+                       const Eigen::VectorXd& d,
+                       const Eigen::VectorXd& theta_bias,
+                       const Eigen::Matrix3d& base_rotation,
+                       const Eigen::Vector3d& base_position,
+                       const std::vector<int>& sphere_links,
+                       const Eigen::Matrix3Xd& sphere_centers):
+    _dof(a.size()),
+    _a(a), _d(d), _theta_bias(theta_bias),
+    _cos_alpha(alpha.array().cos()), _sin_alpha(alpha.array().sin()),
+    _base_rotation(base_rotation), _base_position(base_position),
+    _sphere_links(sphere_links), _sphere_centers(sphere_centers)
+    {
+        if (alpha.size() != _dof || d.size() != _dof || theta_bias.size() != _dof){
+            throw std::runtime_error("Inconsistent DH parameters for the batch arm kinematics.");
+        }
+        if (static_cast<Eigen::Index>(sphere_links.size()) != sphere_centers.cols()){
+            throw std::runtime_error("Inconsistent body spheres for the batch arm kinematics.");
+        }
+        for (int link : sphere_links){
+            if (link < 0 || link >= _dof){
+                throw std::runtime_error("Body sphere on a non-existing link for the batch arm kinematics.");
+            }
+        }
+    }
+
+    inline int dof() const { return _dof; }
+    inline int n_spheres() const { return _sphere_links.size(); }
+
+    /**
+     * @brief The sphere centers of the configurations (dof, n).
+     * @param centers (3, n_spheres*n), the spheres of configuration i in the columns i*n_spheres, ..., (i+1)*n_spheres-1
+     * @param jacobians if not nullptr, (3*dof, n_spheres*n) in the Matrix3D layout:
+     * each column is the column-major (3, dof) Jacobian of a center wrt the configuration
+     */
+    void sphere_centers(const Eigen::Ref<const Eigen::MatrixXd>& confs,
+                        Eigen::MatrixXd& centers,
+                        Eigen::MatrixXd* jacobians=nullptr) const{
+        if (confs.rows() != _dof){
+            throw std::runtime_error("The configurations must have the dof of the arm.");
+        }
+        const int n = confs.cols();
+        const int ns = n_spheres();
+
+        Workspace& workspace = workspace_instance();
+        Eigen::ArrayXXd& frames = workspace.frames;
+        frames.resize(n, FRAME_SIZE*(_dof+1));
+        link_frames(confs, frames, workspace.cos_theta, workspace.sin_theta);
+
+        // the outputs are per sphere and configuration, computed configuration by configuration
+        // from the transposed frames with contiguous reads and writes
+        Eigen::MatrixXd& frames_t = workspace.frames_t;
+        frames_t = frames.matrix().transpose();
+        centers.resize(3, ns*n);
+        if (jacobians){
+            jacobians->resize(3*_dof, ns*n);
+        }
+
+        const double* local = _sphere_centers.data();
+        for (int i=0; i<n; i++){
+            const double* frames_i = frames_t.col(i).data();
+            for (int s=0; s<ns; s++){
+                const size_t k = static_cast<size_t>(i)*ns + s;
+                const int link = _sphere_links[s];
+
+                // the frame after the joint of the link
+                const double* frame = frames_i + FRAME_SIZE*(link + 1);
+                const double lx = local[3*s], ly = local[3*s + 1], lz = local[3*s + 2];
+                double* center = centers.col(k).data();
+                for (int r=0; r<3; r++){
+                    center[r] = frame[9 + r] + frame[3*r]*lx + frame[3*r + 1]*ly + frame[3*r + 2]*lz;
+                }
+
+                if (!jacobians){
+                    continue;
+                }
+
+                // revolute joint j rotates about the z axis of the frame before it: z_j x (center - o_j)
+                double* J = jacobians->col(k).data();
+                for (int j=0; j<=link; j++){
+                    const double* frame_j = frames_i + FRAME_SIZE*j;
+                    const double dx = center[0] - frame_j[9], dy = center[1] - frame_j[10], dz = center[2] - frame_j[11];
+                    J[3*j]     = frame_j[5]*dz - frame_j[8]*dy;
+                    J[3*j + 1] = frame_j[8]*dx - frame_j[2]*dz;
+                    J[3*j + 2] = frame_j[2]*dy - frame_j[5]*dx;
+                }
+                std::fill(J + 3*(link + 1), J + 3*_dof, 0.0);
+            }
+        }
+    }
+
+protected:
+    /// frame components: the rotation row-major, then the position
+    static constexpr int FRAME_SIZE = 12;
+
+    /// Per-thread buffers reused across the calls
+    struct Workspace{
+        Eigen::ArrayXXd frames;
+        Eigen::MatrixXd frames_t;
+        Eigen::ArrayXd cos_theta, sin_theta;
+    };
+
+    static Workspace& workspace_instance(){
+        thread_local Workspace workspace;
+        return workspace;
+    }
+
+    int _dof = 0;
+    Eigen::VectorXd _a, _d, _theta_bias;
+    Eigen::VectorXd _cos_alpha, _sin_alpha;
+    Eigen::Matrix3d _base_rotation;
+    Eigen::Vector3d _base_position;
+    std::vector<int> _sphere_links;
+    Eigen::Matrix3Xd _sphere_centers;
+
+    /**
+     * @brief Frame 0 is the base, frame j+1 the one after joint j, each in FRAME_SIZE columns of frames (n, FRAME_SIZE*(dof+1)).
+     */
+    void link_frames(const Eigen::Ref<const Eigen::MatrixXd>& confs, Eigen::ArrayXXd& frames, Eigen::ArrayXd& c, Eigen::ArrayXd& s) const{
+        for (int r=0; r<3; r++){
+            for (int k=0; k<3; k++){
+                frames.col(3*r + k).setConstant(_base_rotation(r, k));
+            }
+            frames.col(9 + r).setConstant(_base_position(r));
+        }
+
+        const int n = confs.cols();
+        c.resize(n);
+        s.resize(n);
+        for (int j=0; j<_dof; j++){
+            // one loop for both, fused into sincos by the compiler
+            for (int i=0; i<n; i++){
+                const double theta = confs(j, i) + _theta_bias(j);
+                c(i) = std::cos(theta);
+                s(i) = std::sin(theta);
+            }
+            const double ca = _cos_alpha(j), sa = _sin_alpha(j), a = _a(j), d = _d(j);
+
+            // link transform [Rz*Rx, Rz*(a, 0, d)], with Rz*Rx = [c, -s*ca, s*sa; s, c*ca, -c*sa; 0, sa, ca]
+            const int fp = FRAME_SIZE*j, fn = FRAME_SIZE*(j+1);
+            for (int r=0; r<3; r++){
+                const auto r0 = frames.col(fp + 3*r), r1 = frames.col(fp + 3*r + 1), r2 = frames.col(fp + 3*r + 2);
+                frames.col(fn + 3*r)     = r0*c + r1*s;
+                frames.col(fn + 3*r + 1) = (r1*c - r0*s)*ca + r2*sa;
+                frames.col(fn + 3*r + 2) = (r0*s - r1*c)*sa + r2*ca;
+                frames.col(fn + 9 + r)   = frames.col(fp + 9 + r) + (r0*c + r1*s)*a + r2*d;
+            }
+        }
+    }
+
+};
+
+} // namespace vimp
@@ -34,11 +34,7 @@ class PlanarArm2SDFExample: public BaseClass{
         _eps(epsilon), 
         _r(radius)
         {   
-            MatrixXd field = _m_io.load_csv(BaseClass::_field_file);  
-            BaseClass::_sdf = gpmp2::PlanarSDF(BaseClass::_origin, BaseClass::_cell_size, field);
-            BaseClass::_psdf = std::make_shared<gpmp2::PlanarSDF>(BaseClass::_sdf);
-
-            generate_arm_sdf(BaseClass::_sdf, radius);
+            generate_arm_sdf(*BaseClass::_psdf, radius);
         }
 
 
@@ -70,9 +66,8 @@ class PlanarArm2SDFExample: public BaseClass{
                 BaseClass::_psdf_factor = std::make_shared<ArmSDF>(ArmSDF(gtsam::symbol('x', 0), BaseClass::_robot, sdf, 0.0, _eps));
         }
 
-        inline void update_sdf(const gpmp2::PlanarSDF& sdf){
-            BaseClass::_psdf = std::make_shared<gpmp2::PlanarSDF>(sdf);
-            BaseClass::_psdf_factor = std::make_shared<ArmSDF>(ArmSDF(gtsam::symbol('x', 0), BaseClass::_robot, sdf, 0.0, _eps));
+        void update_sdf_factor() override{
+            BaseClass::_psdf_factor = std::make_shared<ArmSDF>(ArmSDF(gtsam::symbol('x', 0), BaseClass::_robot, *BaseClass::_psdf, 0.0, _eps));
         }
 
 
@@ -39,12 +39,7 @@ class PlanarPRSDFExample: public Base{
         _eps(epsilon), 
         _r(radius)
         { 
-            MatrixXd field = _m_io.load_csv(Base::_field_file);            
-
-            Base::_sdf = gpmp2::PlanarSDF(Base::_origin, Base::_cell_size, field);
-            Base::_psdf = std::make_shared<gpmp2::PlanarSDF>(Base::_sdf);
-
-            generate_pr_sdf(Base::_sdf, radius);
+            generate_pr_sdf(*Base::_psdf, radius);
         }
 
         void generate_pr_sdf(const gpmp2::PlanarSDF& sdf, double r){
@@ -57,9 +52,8 @@ class PlanarPRSDFExample: public Base{
             Base::_psdf_factor = std::make_shared<pRSDF>(pRSDF(gtsam::symbol('x', 0), Base::_robot, sdf, 0.0, _eps));
         }
         
-        inline void update_sdf(const gpmp2::PlanarSDF& sdf){
-            Base::_psdf = std::make_shared<gpmp2::PlanarSDF>(sdf);
-            Base::_psdf_factor = std::make_shared<pRSDF>(pRSDF(gtsam::symbol('x', 0), Base::_robot, sdf, 0.0, _eps));
+        void update_sdf_factor() override{
+            Base::_psdf_factor = std::make_shared<pRSDF>(pRSDF(gtsam::symbol('x', 0), Base::_robot, *Base::_psdf, 0.0, _eps));
         }
 
         public:
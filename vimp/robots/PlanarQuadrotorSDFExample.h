@@ -47,9 +47,8 @@ public:
             Base::_psdf_factor = std::make_shared<pRSDF>(pRSDF(gtsam::symbol('x', 0), Base::_robot, sdf, 0.0, _eps));
         }
         
-        inline void update_sdf(const gpmp2::PlanarSDF& sdf){
-            Base::_psdf = std::make_shared<gpmp2::PlanarSDF>(sdf);
-            Base::_psdf_factor = std::make_shared<pRSDF>(pRSDF(gtsam::symbol('x', 0), Base::_robot, sdf, 0.0, _eps));
+        void update_sdf_factor() override{
+            Base::_psdf_factor = std::make_shared<pRSDF>(pRSDF(gtsam::symbol('x', 0), Base::_robot, *Base::_psdf, 0.0, _eps));
         }
 
         std::tuple<VectorXd, MatrixXd> hinge_jacobian(const VectorXd& pose_PR) override{
@@ -41,13 +41,12 @@ class PointRobot3DSDFExample:public RobotSDFBase<PRModel, SDF, pRSDF>{
         _r(radius)
         {
             if (!sdf_file.empty()){
-                Base::_sdf.loadSDF(sdf_file);
-                Base::_psdf = std::make_shared<SDF>(Base::_sdf);
+                Base::use_registry_sdf(sdf_file);
             }
             else{
                 std::runtime_error("Empty sdf map file!");
             }
-            generate_pr_sdf(Base::_sdf, radius);
+            generate_pr_sdf(*Base::_psdf, radius);
         }
 
         void generate_pr_sdf(const SDF& sdf, double r){
@@ -60,9 +59,8 @@ class PointRobot3DSDFExample:public RobotSDFBase<PRModel, SDF, pRSDF>{
             _psdf_factor = std::make_shared<pRSDF>(pRSDF(gtsam::symbol('x', 0), _robot, sdf, 0.0, _eps));
         }
 
-        inline void update_sdf(const SDF& sdf){
-            _psdf = std::make_shared<SDF>(sdf);
-            _psdf_factor = std::make_shared<pRSDF>(pRSDF(gtsam::symbol('x', 0), _robot, sdf, 0.0, _eps));
+        void update_sdf_factor() override{
+            _psdf_factor = std::make_shared<pRSDF>(pRSDF(gtsam::symbol('x', 0), _robot, *_psdf, 0.0, _eps));
         }
 
         public:
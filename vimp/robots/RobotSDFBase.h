@@ -6,11 +6,16 @@
  * For nonlinear dynamics we define seperate robot model class under dynamics/ directory.  
  * 
  * Every derived class must have 2 functions: 
- * 1. update_sdf(); 
+ * 1. update_sdf_factor(), which rebuilds the collision factor on the current sdf; 
  * 2. default_sdf(); 
  * 
  * The main function is 
- * hinge_jacobian(pose) which returns the hinge loss and its gradients wrt the pose.
+ * hinge_jacobian(pose) which returns the hinge loss and its gradients wrt the pose, 
+ * and hinge_jacobian_batch(poses, eps) evaluates it for many poses with one batch sdf query
+ * (and the batch forward kinematics for the DH arms), optionally answered by a block sdf (use_block_sdf)
+ * or a float32 sdf (use_compact_sdf).
+ * update_sdf_region(incremental, region) applies a local map update to a copy of the sdf (copy on write), and 
+ * sdf_version() tells the users of the robot, e.g., the kept moments of the GH factors, that the sdf changed.
  * 
  * The class has 3 template parameters: 
  * 1. the robot model (including forward kinematics and the collision checking balls);
@@ -26,6 +31,9 @@
 #pragma once
 
 #include "helpers/MatrixIO.h"
+#include "robots/SDFRegistry.h"
+#include "robots/BatchArmKinematics.h"
+#include <gpmp2/kinematics/ArmModel.h>
 #include <gpmp2/obstacle/ObstaclePlanarSDFFactor.h>
 #include <Eigen/Dense>
 
@@ -33,6 +41,26 @@ using namespace Eigen;
 
 namespace vimp{
 
+/**
+ * @brief The batch forward kinematics of a gpmp2 arm model, from its DH parameters and body spheres.
+ * gpmp2::Arm does not expose the joint angle biases, the arms of the examples have none.
+ */
+inline BatchArmKinematics make_batch_arm_kinematics(const gpmp2::ArmModel& arm_model){
+    const gpmp2::Arm& arm = arm_model.fk_model();
+    const int n_spheres = arm_model.nr_body_spheres();
+    std::vector<int> sphere_links(n_spheres);
+    Eigen::Matrix3Xd sphere_centers(3, n_spheres);
+    for (int s=0; s<n_spheres; s++){
+        sphere_links[s] = arm_model.sphere_link_id(s);
+        const gtsam::Point3& center = arm_model.sphere_center_wrt_link(s);
+        sphere_centers.col(s) << center.x(), center.y(), center.z();
+    }
+    const gtsam::Pose3& base = arm.base_pose();
+    return BatchArmKinematics(arm.a(), arm.alpha(), arm.d(), Eigen::VectorXd::Zero(arm.dof()), 
+                              base.rotation().matrix(), Eigen::Vector3d{base.x(), base.y(), base.z()}, 
+                              sphere_links, sphere_centers);
+}
+
 template <typename ROBOT, typename SDF, typename SDFFACTOR>
 class RobotSDFBase{
 
@@ -44,54 +72,18 @@ public:
     RobotSDFBase(int ndof, int nlinks): 
     _ndof(ndof), _nlinks(nlinks){}
 
+    /**
+     * @brief Construct with a map registered in the SDFRegistry, the sdf instance is shared with all the other users of the map.
+     */
     RobotSDFBase(int ndof, int nlinks, int map_dim, const std::string& map_name): 
     _ndof(ndof), _nlinks(nlinks), _map_name(map_name), _origin(map_dim)
     {
-
-        // std::cout << "map_name" << std::endl << map_name << std::endl;
         if (map_dim == 2){
-                /// map and sdf
-                std::string source_root{XSTRING(SOURCE_ROOT)};
-
-                _origin.setZero();
-                _origin << -20.0, -10.0;
-                _cell_size = 0.1;
-
-                if (strcmp(map_name.data(), "2dpr_map0") == 0){
-                    _field_file = source_root+"/maps/2dpR/map0/field_multiobs_map0.csv";
-                    // layout of SDF: Bottom-left is (0,0), length is +/- cell_size per grid.
-                    _origin.setZero();
-                    _origin << -1, -1;
-                    _cell_size = 0.01;
-                }
-                else if(strcmp(map_name.data(), "2dpr_map1") == 0){
-                    _field_file = source_root+"/maps/2dpR/map1/field_multiobs_map1.csv";
-
-                }
-                else if(strcmp(map_name.data(), "2dpr_map2") == 0){
-                    _field_file = source_root+"/maps/2dpR/map2/field_multiobs_map2.csv";
-
-                }
-                else if(strcmp(map_name.data(), "2dpr_map3") == 0){
-                    _field_file = source_root+"/maps/2dpR/map3/field_multiobs_map3.csv";
-                }
-                else if(strcmp(map_name.data(), "2darm_map1") == 0){
-                    _cell_size=0.01;
-                    _origin << -1.0, -1.0;
-                    _field_file = source_root+"/maps/2dArm/field_one_obs.csv";
-                }
-                else if(strcmp(map_name.data(), "2darm_map2") == 0){
-                    _cell_size=0.01;
-                    _origin << -1.0, -1.0;
-                    _field_file = source_root+"/maps/2dArm/field_two_obs.csv";
-                }
-                else{
-                    std::runtime_error("No such map for 2d point robot sdf!");
-                }
-
-                // if (!field_file.empty()){
-                //     Base::update_field_file(field_file);
-                // }
+            SDFMapInfo map_info = SDFRegistry::instance().map_info(map_name);
+            _origin = map_info.origin;
+            _cell_size = map_info.cell_size;
+            _field_file = map_info.field_file;
+            use_registry_sdf(map_name);
 
         }else if (map_dim==3){
             std::cout << "3-D workspace map" << std::endl;
@@ -99,10 +91,41 @@ public:
             
     }
     
+    /**
+     * @brief Replace the sdf by a copy of the given one, which is no longer shared through the registry.
+     */
+    virtual void update_sdf(const SDF& sdf){
+        replace_psdf(std::make_shared<const SDF>(sdf), 0);
+    }
 
-    virtual void update_sdf(const SDF& sdf) = 0;
     virtual void default_sdf(){};
 
+    /**
+     * @brief Rebuild the collision factor (_psdf_factor) on the current sdf, after the sdf is replaced.
+     */
+    virtual void update_sdf_factor() = 0;
+
+    /**
+     * @brief The version of the sdf the robot reads, changed by every update_sdf, update_sdf_region and sync_sdf. 
+     * Results kept from the costs of the robot, e.g., the GH moments, are valid while it is the same.
+     */
+    inline size_t sdf_version() const { return _sdf_version; }
+
+    /**
+     * @brief Follow the shared registry instance of the map after another robot updated it (update_sdf_region), 
+     * e.g., before a replan. Robots not sharing their sdf through the registry keep theirs.
+     * @return whether the sdf was replaced
+     */
+    bool sync_sdf(){
+        if (_registry_version == 0 || SDFRegistry::instance().map_version(_map_name) == _registry_version){
+            return false;
+        }
+        size_t registry_version = 0;
+        std::shared_ptr<const SDF> p_sdf = SDFRegistry::instance().get_sdf<SDF>(_map_name, &registry_version);
+        replace_psdf(p_sdf, registry_version);
+        return true;
+    }
+
     /**
      * Obstacle Returns the Vector of h(x) and the Jacobian matrix.
      * */
@@ -113,14 +136,158 @@ public:
         return std::make_tuple(vec_err, Jacobian);
     }
 
+    /**
+     * @brief The hinge losses of the poses (ndof, n) as in hinge_jacobian with the gpmp2 obstacle factors, 
+     * i.e., max(0, eps + radius - d(center)) for each collision sphere, with one batch sdf query 
+     * for the spheres of all the poses.
+     * @param errors (n_spheres, n)
+     * @param jacobians if not nullptr, the n Jacobians (n_spheres, ndof) of the hinge losses wrt the poses
+     */
+    void hinge_jacobian_batch(const MatrixXd& poses, double eps, MatrixXd& errors, std::vector<MatrixXd>* jacobians=nullptr) const{
+        std::shared_ptr<const BlockSDF> p_block = std::atomic_load(&_pblock_sdf);
+        if (p_block){
+            hinge_jacobian_batch(*p_block, poses, eps, errors, jacobians);
+            return;
+        }
+        std::shared_ptr<const CompactSDF> p_compact = std::atomic_load(&_pcompact_sdf);
+        if (p_compact){
+            hinge_jacobian_batch(*p_compact, poses, eps, errors, jacobians);
+        }else{
+            std::shared_ptr<const BatchSDF> p_batch = batch_sdf();
+            hinge_jacobian_batch(*p_batch, poses, eps, errors, jacobians);
+        }
+    }
+
+    /**
+     * @brief Answer the batch hinge losses from a block sdf of the map (helpers/SDFBlockGrid.h), which keeps
+     * the fine grid only within band of the obstacles. The band must cover eps plus the largest sphere radius.
+     * Shared through the SDFRegistry when the sdf is the registry instance of the map.
+     */
+    void use_block_sdf(double band, int block_size=8){
+        std::shared_ptr<const BlockSDF> p_block;
+        if (_psdf && !_map_name.empty() && SDFRegistry::instance().has_map(_map_name) &&
+            SDFRegistry::instance().get_sdf<SDF>(_map_name) == _psdf){
+            p_block = SDFRegistry::instance().block_sdf(_map_name, band, block_size);
+        }else{
+            p_block = std::make_shared<const BlockSDF>(make_block_sdf(sdf(), band, block_size));
+        }
+        std::atomic_store(&_pblock_sdf, p_block);
+    }
+
+    /**
+     * @brief Answer the batch hinge losses from a float32 copy of the map (helpers/SDFCompact.h), 
+     * half the memory of the double grid, or with the precomputed gradients. A block sdf takes precedence.
+     * Shared through the SDFRegistry when the sdf is the registry instance of the map.
+     */
+    void use_compact_sdf(bool gradients=false){
+        std::shared_ptr<const CompactSDF> p_compact;
+        if (_psdf && !_map_name.empty() && SDFRegistry::instance().has_map(_map_name) &&
+            SDFRegistry::instance().get_sdf<SDF>(_map_name) == _psdf){
+            p_compact = SDFRegistry::instance().compact_sdf(_map_name, gradients);
+        }else{
+            p_compact = std::make_shared<const CompactSDF>(make_compact_sdf(sdf(), gradients));
+        }
+        std::atomic_store(&_pcompact_sdf, p_compact);
+    }
+
+    /**
+     * @brief Apply a local update of an incremental sdf (helpers/IncrementalSDF.h) of the same grid to a copy of the sdf,
+     * which replaces the sdf of the robot and, for a map shared through the registry, the registry instance (copy on write). 
+     * The previous instance is left unchanged for the factors and threads still reading it, the other robots on the map 
+     * follow with sync_sdf. The sdf version changes, the collision factors reaching the region can be found with 
+     * SDFRegionBound(robot, incremental.region_box(region)). Not concurrent with the queries of this robot.
+     */
+    void update_sdf_region(const IncrementalSDF& incremental, const SDFRegion& region){
+        if (region.empty()){
+            return;
+        }
+        sync_sdf();
+        std::shared_ptr<SDF> p_sdf = std::make_shared<SDF>(sdf());
+        update_sdf_field(*p_sdf, incremental, region);
+
+        size_t registry_version = 0;
+        if (_registry_version != 0){
+            registry_version = SDFRegistry::instance().update_map<SDF>(_map_name, p_sdf);
+        }
+        replace_psdf(p_sdf, registry_version);
+    }
+
+    /**
+     * @brief The sphere centers (3, n_spheres*n) of the poses (ndof, n), and their Jacobians wrt the poses 
+     * in the Matrix3D layout (3*ndof, n_spheres*n). The DH arms use the batch forward kinematics, 
+     * the other robots the gpmp2 robot model pose by pose.
+     */
+    void sphere_centers_batch(const MatrixXd& poses, MatrixXd& centers, MatrixXd* jacobians=nullptr) const{
+        if constexpr (std::is_same<ROBOT, gpmp2::ArmModel>::value){
+            batch_kinematics().sphere_centers(poses, centers, jacobians);
+        }else{
+            const int n_spheres = _robot.nr_body_spheres();
+            const int n = poses.cols();
+            const int dof = poses.rows();
+            centers.resize(3, n_spheres*n);
+            if (jacobians){
+                jacobians->resize(3*dof, n_spheres*n);
+            }
+
+            std::vector<gtsam::Point3> sphere_centers;
+            std::vector<gtsam::Matrix> J_center_pose;
+            for (int i=0; i<n; i++){
+                VectorXd pose = poses.col(i);
+                if (jacobians){
+                    _robot.sphereCenters(pose, sphere_centers, J_center_pose);
+                }else{
+                    _robot.sphereCenters(pose, sphere_centers);
+                }
+                for (int s=0; s<n_spheres; s++){
+                    centers.col(i*n_spheres + s) << sphere_centers[s].x(), sphere_centers[s].y(), sphere_centers[s].z();
+                    if (jacobians){
+                        jacobians->col(i*n_spheres + s) = J_center_pose[s].reshaped(3*dof, 1);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief The batch forward kinematics of the DH arms, built on the first call.
+     */
+    const BatchArmKinematics& batch_kinematics() const{
+        std::shared_ptr<const BatchArmKinematics> p_kinematics = std::atomic_load(&_pbatch_kinematics);
+        if (!p_kinematics){
+            p_kinematics = std::make_shared<const BatchArmKinematics>(make_batch_arm_kinematics(_robot));
+            std::atomic_store(&_pbatch_kinematics, p_kinematics);
+        }
+        return *p_kinematics;
+    }
+
+    /**
+     * @brief The batch query copy of the sdf, shared through the SDFRegistry for the registered maps.
+     * Built on the first call, concurrent first calls may build it more than once. Held by the caller, 
+     * it stays valid when the sdf is replaced.
+     */
+    std::shared_ptr<const BatchSDF> batch_sdf() const{
+        std::shared_ptr<const BatchSDF> p_batch = std::atomic_load(&_pbatch_sdf);
+        if (!p_batch){
+            if (_psdf){
+                p_batch = SDFRegistry::instance().batch_sdf(_psdf);
+            }else{
+                p_batch = std::make_shared<const BatchSDF>(make_batch_sdf(_sdf));
+            }
+            std::atomic_store(&_pbatch_sdf, p_batch);
+        }
+        return p_batch;
+    }
+
     /**
      * @brief Hinge loss function for nonlinear robot dynamics model.
      */
     virtual std::tuple<VectorXd, MatrixXd> hinge_jacobian_nonlinear_dyn(const VectorXd& pose){}
 
-    inline ROBOT RobotModel() const { return _robot; }
-    inline std::shared_ptr<SDF> psdf() const { return _psdf; }
-    inline SDF sdf() const { return _sdf; }
+    inline const ROBOT& RobotModel() const { return _robot; }
+    inline std::shared_ptr<const SDF> psdf() const { return _psdf; }
+
+    /// the shared sdf instance, or the locally owned one for the robots not using the registry
+    inline const SDF& sdf() const { return _psdf ? *_psdf : _sdf; }
     virtual inline int ndof() const {return _ndof;}
     virtual inline int nlinks() const {return _nlinks;}
 
@@ -128,6 +295,74 @@ public:
     double cell_size() const { return _cell_size; }
     std::string field_file() const { return _field_file; }
 
+protected:
+    /**
+     * @brief Read the shared registry instance of a map, for the constructors.
+     */
+    void use_registry_sdf(const std::string& map_name){
+        _map_name = map_name;
+        _psdf = SDFRegistry::instance().get_sdf<SDF>(map_name, &_registry_version);
+        _sdf_version = _registry_version;
+    }
+
+    /**
+     * @brief Replace the sdf, with the version of the registry instance of the map or 0 for an sdf outside of the registry.
+     * The batch query copy is dropped, the block and compact sdfs in use and the collision factor are rebuilt.
+     */
+    void replace_psdf(std::shared_ptr<const SDF> p_sdf, size_t registry_version){
+        _psdf = std::move(p_sdf);
+        _registry_version = registry_version;
+        _sdf_version = registry_version != 0 ? registry_version : SDFRegistry::instance().next_version();
+        std::atomic_store(&_pbatch_sdf, std::shared_ptr<const BatchSDF>{});
+
+        std::shared_ptr<const BlockSDF> p_block = std::atomic_load(&_pblock_sdf);
+        if (p_block){
+            use_block_sdf(p_block->band(), p_block->block_size());
+        }
+        std::shared_ptr<const CompactSDF> p_compact = std::atomic_load(&_pcompact_sdf);
+        if (p_compact){
+            use_compact_sdf(p_compact->has_gradients());
+        }
+        update_sdf_factor();
+    }
+
+    /**
+     * @brief The batch hinge losses with a BatchSDF or a BlockSDF.
+     */
+    template <typename BATCHSDF>
+    void hinge_jacobian_batch(const BATCHSDF& batch, const MatrixXd& poses, double eps, MatrixXd& errors, std::vector<MatrixXd>* jacobians) const{
+        const int sdf_dim = batch.dimension();
+        const int n_spheres = _robot.nr_body_spheres();
+        const int n = poses.cols();
+
+        MatrixXd centers, J_centers;
+        sphere_centers_batch(poses, centers, jacobians ? &J_centers : nullptr);
+
+        VectorXd sphere_eps(n_spheres*n);
+        for (int s=0; s<n_spheres; s++){
+            sphere_eps(Eigen::seqN(s, n, n_spheres)).setConstant(eps + _robot.sphere_radius(s));
+        }
+
+        VectorXd hinge;
+        if (!jacobians){
+            batch.hinge_loss(centers.topRows(sdf_dim), sphere_eps, hinge);
+        }else{
+            MatrixXd hinge_gradients;
+            batch.hinge_loss(centers.topRows(sdf_dim), sphere_eps, hinge, hinge_gradients);
+            const int dof = poses.rows();
+            jacobians->resize(n);
+            for (int i=0; i<n; i++){
+                MatrixXd& J = (*jacobians)[i];
+                J.resize(n_spheres, dof);
+                for (int s=0; s<n_spheres; s++){
+                    int k = i*n_spheres + s;
+                    J.row(s) = hinge_gradients.col(k).transpose() * J_centers.col(k).reshaped(3, dof).topRows(sdf_dim);
+                }
+            }
+        }
+        errors = Map<MatrixXd>(hinge.data(), n_spheres, n);
+    }
+
 public:
     ROBOT _robot;
     SDF _sdf;
@@ -135,8 +370,14 @@ public:
     double _cell_size;
 
     std::shared_ptr<SDFFACTOR> _psdf_factor; 
-    std::shared_ptr<SDF> _psdf;
+    std::shared_ptr<const SDF> _psdf;
+    mutable std::shared_ptr<const BatchSDF> _pbatch_sdf;
+    std::shared_ptr<const BlockSDF> _pblock_sdf;
+    std::shared_ptr<const CompactSDF> _pcompact_sdf;
+    mutable std::shared_ptr<const BatchArmKinematics> _pbatch_kinematics;
     int _ndof, _nlinks;
+    /// the version of the sdf, and of the registry instance of the map if the sdf is shared through the registry, else 0
+    size_t _sdf_version = 0, _registry_version = 0;
 
     MatrixIO _m_io;
 
@@ -0,0 +1,183 @@
+/**
+ * @file SDFLoader.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Loading the gpmp2 sdf classes from the binary sdf files (helpers/SDFFile.h), 
+ * falling back to the csv fields and the boost-serialized .bin maps, the converters between the formats,
+ * the batch and block query copies, and the sdf classes generated from occupancy grids.
+ * @version 0.1
+ * @date 2023-09-08
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+#pragma once
+
+#include <gpmp2/obstacle/PlanarSDF.h>
+#include <gpmp2/obstacle/SignedDistanceField.h>
+#include "helpers/MatrixIO.h"
+#include "helpers/SDFFile.h"
+#include "helpers/SDFBatch.h"
+#include "helpers/SDFBlockGrid.h"
+#include "helpers/SDFCompact.h"
+#include "helpers/IncrementalSDF.h"
+
+namespace vimp{
+
+/**
+ * @brief The binary file next to a csv or .bin map: the same path with the extension .sdfb.
+ */
+inline std::string binary_sdf_path(const std::string& map_file){
+    size_t dot = map_file.find_last_of('.');
+    return (dot == std::string::npos ? map_file : map_file.substr(0, dot)) + ".sdfb";
+}
+
+inline bool file_exists(const std::string& path){
+    std::ifstream file(path);
+    return file.good();
+}
+
+/**
+ * @brief Load a planar sdf from a binary file, or from the csv field with the given origin and cell size.
+ * A binary file next to the csv field is preferred if it exists.
+ */
+inline gpmp2::PlanarSDF load_planar_sdf(const std::string& field_file, const Eigen::VectorXd& origin, double cell_size){
+    std::string binary_file = is_sdf_file(field_file) ? field_file : binary_sdf_path(field_file);
+    if (file_exists(binary_file) && is_sdf_file(binary_file)){
+        MappedSDFFile mapped{binary_file};
+        if (mapped.dimension() != 2){
+            throw std::runtime_error("Not a planar sdf file: " + binary_file);
+        }
+        Eigen::VectorXd mapped_origin = mapped.origin();
+        return gpmp2::PlanarSDF(gtsam::Point2(mapped_origin(0), mapped_origin(1)), mapped.cell_size(), mapped.layer(0));
+    }
+
+    MatrixIO m_io;
+    return gpmp2::PlanarSDF(gtsam::Point2(origin(0), origin(1)), cell_size, m_io.load_csv(field_file));
+}
+
+/**
+ * @brief Load a 3D sdf from a binary file, or from a boost-serialized gpmp2 .bin map.
+ * A binary file next to the .bin map is preferred if it exists.
+ */
+inline gpmp2::SignedDistanceField load_sdf(const std::string& sdf_file){
+    std::string binary_file = is_sdf_file(sdf_file) ? sdf_file : binary_sdf_path(sdf_file);
+    if (file_exists(binary_file) && is_sdf_file(binary_file)){
+        MappedSDFFile mapped{binary_file};
+        if (mapped.dimension() != 3){
+            throw std::runtime_error("Not a 3D sdf file: " + binary_file);
+        }
+        Eigen::VectorXd mapped_origin = mapped.origin();
+        gpmp2::SignedDistanceField sdf(gtsam::Point3(mapped_origin(0), mapped_origin(1), mapped_origin(2)), 
+                                       mapped.cell_size(), mapped.rows(), mapped.cols(), mapped.layers());
+        for (int k=0; k<mapped.layers(); k++){
+            sdf.initFieldData(k, mapped.layer(k));
+        }
+        return sdf;
+    }
+
+    gpmp2::SignedDistanceField sdf;
+    sdf.loadSDF(sdf_file);
+    return sdf;
+}
+
+inline void write_sdf_file(const std::string& path, const gpmp2::PlanarSDF& sdf, bool single_precision=false){
+    Eigen::VectorXd origin(2);
+    origin << sdf.origin().x(), sdf.origin().y();
+    write_sdf_file(path, origin, sdf.cell_size(), std::vector<Eigen::MatrixXd>{sdf.raw_data()}, single_precision);
+}
+
+inline void write_sdf_file(const std::string& path, const gpmp2::SignedDistanceField& sdf, bool single_precision=false){
+    Eigen::VectorXd origin(3);
+    origin << sdf.origin().x(), sdf.origin().y(), sdf.origin().z();
+    std::vector<Eigen::MatrixXd> layers(sdf.raw_data().begin(), sdf.raw_data().end());
+    write_sdf_file(path, origin, sdf.cell_size(), layers, single_precision);
+}
+
+/**
+ * @brief Batch query copies of the gpmp2 sdf classes.
+ */
+inline BatchSDF make_batch_sdf(const gpmp2::PlanarSDF& sdf){
+    Eigen::VectorXd origin(2);
+    origin << sdf.origin().x(), sdf.origin().y();
+    return BatchSDF(origin, sdf.cell_size(), std::vector<Eigen::MatrixXd>{sdf.raw_data()});
+}
+
+inline BatchSDF make_batch_sdf(const gpmp2::SignedDistanceField& sdf){
+    Eigen::VectorXd origin(3);
+    origin << sdf.origin().x(), sdf.origin().y(), sdf.origin().z();
+    std::vector<Eigen::MatrixXd> layers(sdf.raw_data().begin(), sdf.raw_data().end());
+    return BatchSDF(origin, sdf.cell_size(), layers);
+}
+
+/**
+ * @brief Block sdf copies of the gpmp2 sdf classes, see helpers/SDFBlockGrid.h.
+ */
+inline BlockSDF make_block_sdf(const gpmp2::PlanarSDF& sdf, double band, int block_size=8){
+    Eigen::VectorXd origin(2);
+    origin << sdf.origin().x(), sdf.origin().y();
+    return BlockSDF(origin, sdf.cell_size(), std::vector<Eigen::MatrixXd>{sdf.raw_data()}, band, block_size);
+}
+
+inline BlockSDF make_block_sdf(const gpmp2::SignedDistanceField& sdf, double band, int block_size=8){
+    Eigen::VectorXd origin(3);
+    origin << sdf.origin().x(), sdf.origin().y(), sdf.origin().z();
+    std::vector<Eigen::MatrixXd> layers(sdf.raw_data().begin(), sdf.raw_data().end());
+    return BlockSDF(origin, sdf.cell_size(), layers, band, block_size);
+}
+
+/**
+ * @brief Float32 copies of the gpmp2 sdf classes, see helpers/SDFCompact.h.
+ */
+inline CompactSDF make_compact_sdf(const gpmp2::PlanarSDF& sdf, bool gradients=false){
+    Eigen::VectorXd origin(2);
+    origin << sdf.origin().x(), sdf.origin().y();
+    return CompactSDF(origin, sdf.cell_size(), std::vector<Eigen::MatrixXd>{sdf.raw_data()}, gradients);
+}
+
+inline CompactSDF make_compact_sdf(const gpmp2::SignedDistanceField& sdf, bool gradients=false){
+    Eigen::VectorXd origin(3);
+    origin << sdf.origin().x(), sdf.origin().y(), sdf.origin().z();
+    std::vector<Eigen::MatrixXd> layers(sdf.raw_data().begin(), sdf.raw_data().end());
+    return CompactSDF(origin, sdf.cell_size(), layers, gradients);
+}
+
+/**
+ * @brief The planar sdf of an occupancy map (rows: y, cols: x), e.g., for RobotSDFBase::update_sdf when the obstacles move.
+ */
+inline gpmp2::PlanarSDF make_planar_sdf(const Eigen::MatrixXd& occupancy, const Eigen::VectorXd& origin, double cell_size,
+                                        const SDFGenerator& generator=SDFGenerator()){
+    return gpmp2::PlanarSDF(gtsam::Point2(origin(0), origin(1)), cell_size, generator.signed_distance_field(occupancy, cell_size));
+}
+
+/**
+ * @brief The 3D sdf of an occupancy map, one layer (rows: y, cols: x) per z.
+ */
+inline gpmp2::SignedDistanceField make_sdf(const std::vector<Eigen::MatrixXd>& occupancy, const Eigen::VectorXd& origin, double cell_size,
+                                           const SDFGenerator& generator=SDFGenerator()){
+    std::vector<Eigen::MatrixXd> field = generator.signed_distance_field(occupancy, cell_size);
+    gpmp2::SignedDistanceField sdf(gtsam::Point3(origin(0), origin(1), origin(2)), cell_size, 
+                                   field[0].rows(), field[0].cols(), field.size());
+    for (int k=0; k<static_cast<int>(field.size()); k++){
+        sdf.initFieldData(k, field[k]);
+    }
+    return sdf;
+}
+
+/**
+ * @brief Write the changed region of an incremental sdf into a gpmp2 sdf, the copy which replaces the 
+ * shared instance in RobotSDFBase::update_sdf_region.
+ */
+inline void update_sdf_field(gpmp2::PlanarSDF& sdf, const IncrementalSDF& incremental, const SDFRegion& region){
+    if (!region.empty()){
+        sdf = gpmp2::PlanarSDF(sdf.origin(), sdf.cell_size(), incremental.field()[0]);
+    }
+}
+
+inline void update_sdf_field(gpmp2::SignedDistanceField& sdf, const IncrementalSDF& incremental, const SDFRegion& region){
+    for (int k=region.layer_begin; k<region.layer_end; k++){
+        sdf.initFieldData(k, incremental.field()[k]);
+    }
+}
+
+} // namespace vimp
@@ -0,0 +1,423 @@
+/**
+ * @file SDFRegistry.h
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief A process-wide registry of the sdf maps and robot models. Each map is loaded once
+ * and shared as shared_ptr<const SDF> by all the robots, factors, optimizers and threads.
+ * Maps are registered by name, either in code (register_map) or from an xml file at runtime (register_maps):
+ *
+ * <maps>
+ *     <map name="my_map" dimension="2" field_file="my_field.csv" origin_x="-1.0" origin_y="-1.0" cell_size="0.01"/>
+ *     <map name="my_3d_map" dimension="3" field_file="my_map.bin"/>
+ * </maps>
+ *
+ * Relative field files are resolved against the directory of the xml file.
+ * @version 0.1
+ * @date 2023-09-10
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#pragma once
+
+#ifndef XSTRING
+#define STRING(x) #x
+#define XSTRING(x) STRING(x)
+#endif
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <functional>
+#include <typeinfo>
+#include <type_traits>
+
+#include "3rdparty/rapidxml-1.13/rapidxml.hpp"
+#include "3rdparty/rapidxml-1.13/rapidxml_utils.hpp"
+#include "robots/SDFLoader.h"
+
+namespace vimp{
+
+struct SDFMapInfo{
+    int dimension = 2;
+    std::string field_file;
+    /// origin and cell size of the csv fields; the binary and .bin maps carry their own
+    Eigen::VectorXd origin;
+    double cell_size = 0.0;
+};
+
+class SDFRegistry{
+public:
+    static SDFRegistry& instance(){
+        static SDFRegistry registry;
+        return registry;
+    }
+
+    SDFRegistry(const SDFRegistry&) = delete;
+    SDFRegistry& operator=(const SDFRegistry&) = delete;
+
+    /**
+     * @brief Register (or replace) a map. A replaced map is reloaded on the next query,
+     * the instances already handed out stay valid.
+     */
+    void register_map(const std::string& name, const SDFMapInfo& info){
+        std::lock_guard<std::mutex> lock(_mutex);
+        _maps[name] = info;
+        _planar_sdfs.erase(name);
+        _sdfs.erase(name);
+        _map_versions.erase(name);
+        _updated_maps.erase(name);
+        release_map_copies(name);
+    }
+
+    /**
+     * @brief Register all the maps listed in an xml file.
+     */
+    void register_maps(const std::string& xml_file){
+        rapidxml::file<> xmlFile(xml_file.data());
+        rapidxml::xml_document<> doc;
+        doc.parse<0>(xmlFile.data());
+
+        std::string directory;
+        size_t slash = xml_file.find_last_of('/');
+        if (slash != std::string::npos){
+            directory = xml_file.substr(0, slash + 1);
+        }
+
+        rapidxml::xml_node<>* maps_node = doc.first_node("maps");
+        if (!maps_node){
+            throw std::runtime_error("No <maps> node in the map registry file: " + xml_file);
+        }
+        for (rapidxml::xml_node<>* node = maps_node->first_node("map"); node; node = node->next_sibling("map")){
+            auto attribute = [node, &xml_file](const char* key) -> std::string {
+                rapidxml::xml_attribute<>* attr = node->first_attribute(key);
+                if (!attr){
+                    throw std::runtime_error(std::string("Missing attribute ") + key + " in the map registry file: " + xml_file);
+                }
+                return attr->value();
+            };
+
+            SDFMapInfo info;
+            info.dimension = std::stoi(attribute("dimension"));
+            info.field_file = attribute("field_file");
+            if (!info.field_file.empty() && info.field_file[0] != '/'){
+                info.field_file = directory + info.field_file;
+            }
+            if (info.dimension == 2 && !is_sdf_file(info.field_file)){
+                info.origin = Eigen::Vector2d{std::stod(attribute("origin_x")), std::stod(attribute("origin_y"))};
+                info.cell_size = std::stod(attribute("cell_size"));
+            }
+            register_map(attribute("name"), info);
+        }
+    }
+
+    bool has_map(const std::string& name) const{
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _maps.count(name) > 0;
+    }
+
+    SDFMapInfo map_info(const std::string& name) const{
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _maps.find(name);
+        if (it == _maps.end()){
+            throw std::runtime_error("No such map in the sdf registry: " + name);
+        }
+        return it->second;
+    }
+
+    /**
+     * @brief The shared planar sdf of a registered map, loaded on the first query.
+     * @param version if not nullptr, the version of the returned instance (map_version)
+     */
+    std::shared_ptr<const gpmp2::PlanarSDF> planar_sdf(const std::string& name, size_t* version=nullptr){
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _planar_sdfs.find(name);
+        if (it != _planar_sdfs.end()){
+            set_version(name, version);
+            return it->second;
+        }
+        auto it_map = _maps.find(name);
+        if (it_map == _maps.end() || it_map->second.dimension != 2){
+            throw std::runtime_error("No such planar map in the sdf registry: " + name);
+        }
+        const SDFMapInfo& info = it_map->second;
+        auto p_sdf = std::make_shared<const gpmp2::PlanarSDF>(load_planar_sdf(info.field_file, info.origin, info.cell_size));
+        _planar_sdfs[name] = p_sdf;
+        _map_versions[name] = ++_version_counter;
+        set_version(name, version);
+        return p_sdf;
+    }
+
+    /**
+     * @brief The shared 3D sdf of a registered map, loaded on the first query.
+     * An unregistered name is taken as a map file and registered under its path.
+     * @param version if not nullptr, the version of the returned instance (map_version)
+     */
+    std::shared_ptr<const gpmp2::SignedDistanceField> sdf(const std::string& name, size_t* version=nullptr){
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _sdfs.find(name);
+        if (it != _sdfs.end()){
+            set_version(name, version);
+            return it->second;
+        }
+        auto it_map = _maps.find(name);
+        if (it_map == _maps.end()){
+            SDFMapInfo info;
+            info.dimension = 3;
+            info.field_file = name;
+            it_map = _maps.emplace(name, info).first;
+        }
+        if (it_map->second.dimension != 3){
+            throw std::runtime_error("No such 3D map in the sdf registry: " + name);
+        }
+        auto p_sdf = std::make_shared<const gpmp2::SignedDistanceField>(load_sdf(it_map->second.field_file));
+        _sdfs[name] = p_sdf;
+        _map_versions[name] = ++_version_counter;
+        set_version(name, version);
+        return p_sdf;
+    }
+
+    /**
+     * @brief Dispatch on the sdf type of the robot classes.
+     */
+    template <typename SDF>
+    std::shared_ptr<const SDF> get_sdf(const std::string& name, size_t* version=nullptr){
+        if constexpr (std::is_same<SDF, gpmp2::PlanarSDF>::value){
+            return planar_sdf(name, version);
+        }else{
+            return sdf(name, version);
+        }
+    }
+
+    /**
+     * @brief Replace the shared instance of a loaded map by an updated copy (copy on write, RobotSDFBase::update_sdf_region).
+     * The instance handed out before is left unchanged and stays valid for its holders, the query copies of the map are dropped
+     * and the block and compact sdfs are then built from the new instance instead of the map files.
+     * @return the new version of the map
+     */
+    template <typename SDF>
+    size_t update_map(const std::string& name, std::shared_ptr<const SDF> p_sdf){
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto& cached_sdfs = sdf_cache<SDF>();
+        auto it = cached_sdfs.find(name);
+        if (it == cached_sdfs.end()){
+            throw std::runtime_error("No such loaded map in the sdf registry: " + name);
+        }
+        _batch_sdfs.erase(it->second.get());
+        it->second = std::move(p_sdf);
+        _updated_maps.insert(name);
+        release_map_copies(name);
+        _map_versions[name] = ++_version_counter;
+        return _map_versions[name];
+    }
+
+    /**
+     * @brief The version of the shared instance of a map, changed by every update_map, 0 before it is loaded.
+     * The versions of all the maps and next_version are drawn from one counter, so they never repeat.
+     */
+    size_t map_version(const std::string& name) const{
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _map_versions.find(name);
+        return it == _map_versions.end() ? 0 : it->second;
+    }
+
+    /**
+     * @brief A new version for an sdf instance outside of the registry.
+     */
+    size_t next_version(){
+        std::lock_guard<std::mutex> lock(_mutex);
+        return ++_version_counter;
+    }
+
+    /**
+     * @brief The batch query copy of a shared sdf, built once per sdf instance.
+     */
+    template <typename SDF>
+    std::shared_ptr<const BatchSDF> batch_sdf(const std::shared_ptr<const SDF>& p_sdf){
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _batch_sdfs.find(p_sdf.get());
+        if (it != _batch_sdfs.end()){
+            return it->second.second;
+        }
+        auto p_batch = std::make_shared<const BatchSDF>(make_batch_sdf(*p_sdf));
+        // the source is kept alive with the copy so that its address is not reused by another sdf
+        _batch_sdfs[p_sdf.get()] = std::make_pair(std::shared_ptr<const void>(p_sdf), p_batch);
+        return p_batch;
+    }
+
+    /**
+     * @brief The shared block sdf of a registered map (helpers/SDFBlockGrid.h), built on the first query.
+     * Built from the memory-mapped binary file of the map when there is one, so that the fine grid is never
+     * resident in full, otherwise from the shared sdf.
+     */
+    std::shared_ptr<const BlockSDF> block_sdf(const std::string& name, double band, int block_size=8){
+        const std::string key = name + "@" + std::to_string(band) + "@" + std::to_string(block_size);
+        SDFMapInfo info;
+        bool updated = false;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _block_sdfs.find(key);
+            if (it != _block_sdfs.end()){
+                return it->second;
+            }
+            auto it_map = _maps.find(name);
+            if (it_map == _maps.end()){
+                throw std::runtime_error("No such map in the sdf registry: " + name);
+            }
+            info = it_map->second;
+            updated = _updated_maps.count(name) > 0;
+        }
+
+        // built out of the lock, concurrent first queries may build it more than once
+        std::shared_ptr<const BlockSDF> p_block;
+        std::string binary_file = is_sdf_file(info.field_file) ? info.field_file : binary_sdf_path(info.field_file);
+        if (!updated && file_exists(binary_file) && is_sdf_file(binary_file)){
+            MappedSDFFile mapped{binary_file};
+            p_block = std::make_shared<const BlockSDF>(mapped, band, block_size);
+        }else if (info.dimension == 2){
+            p_block = std::make_shared<const BlockSDF>(make_block_sdf(*planar_sdf(name), band, block_size));
+        }else{
+            p_block = std::make_shared<const BlockSDF>(make_block_sdf(*sdf(name), band, block_size));
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _block_sdfs.emplace(key, p_block).first->second;
+    }
+
+    /**
+     * @brief A robot model shared by key, built by make_robot on the first query.
+     */
+    template <typename Robot>
+    std::shared_ptr<const Robot> robot_model(const std::string& key, const std::function<Robot()>& make_robot){
+        std::string typed_key = key + "@" + typeid(Robot).name();
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _robots.find(typed_key);
+        if (it != _robots.end()){
+            return std::static_pointer_cast<const Robot>(it->second);
+        }
+        auto p_robot = std::make_shared<const Robot>(make_robot());
+        _robots[typed_key] = p_robot;
+        return p_robot;
+    }
+
+    /**
+     * @brief The shared float32 sdf of a registered map (helpers/SDFCompact.h), built on the first query,
+     * from the memory-mapped binary file of the map when there is one, otherwise from the shared sdf.
+     */
+    std::shared_ptr<const CompactSDF> compact_sdf(const std::string& name, bool gradients=false){
+        const std::string key = name + "@" + std::to_string(gradients);
+        SDFMapInfo info;
+        bool updated = false;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _compact_sdfs.find(key);
+            if (it != _compact_sdfs.end()){
+                return it->second;
+            }
+            auto it_map = _maps.find(name);
+            if (it_map == _maps.end()){
+                throw std::runtime_error("No such map in the sdf registry: " + name);
+            }
+            info = it_map->second;
+            updated = _updated_maps.count(name) > 0;
+        }
+
+        std::shared_ptr<const CompactSDF> p_compact;
+        std::string binary_file = is_sdf_file(info.field_file) ? info.field_file : binary_sdf_path(info.field_file);
+        if (!updated && file_exists(binary_file) && is_sdf_file(binary_file)){
+            MappedSDFFile mapped{binary_file};
+            p_compact = std::make_shared<const CompactSDF>(mapped, gradients);
+        }else if (info.dimension == 2){
+            p_compact = std::make_shared<const CompactSDF>(make_compact_sdf(*planar_sdf(name), gradients));
+        }else{
+            p_compact = std::make_shared<const CompactSDF>(make_compact_sdf(*sdf(name), gradients));
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _compact_sdfs.emplace(key, p_compact).first->second;
+    }
+
+    /**
+     * @brief Drop the cached instances, the ones already handed out stay valid.
+     */
+    void clear_cache(){
+        std::lock_guard<std::mutex> lock(_mutex);
+        _planar_sdfs.clear();
+        _sdfs.clear();
+        _batch_sdfs.clear();
+        _block_sdfs.clear();
+        _compact_sdfs.clear();
+        _map_versions.clear();
+        _updated_maps.clear();
+        _robots.clear();
+    }
+
+protected:
+    SDFRegistry(){
+        register_default_maps();
+    }
+
+    void register_default_maps(){
+        std::string source_root{XSTRING(SOURCE_ROOT)};
+
+        // layout of SDF: Bottom-left is (0,0), length is +/- cell_size per grid.
+        _maps["2dpr_map0"] = SDFMapInfo{2, source_root+"/maps/2dpR/map0/field_multiobs_map0.csv", Eigen::Vector2d{-1.0, -1.0}, 0.01};
+        _maps["2dpr_map1"] = SDFMapInfo{2, source_root+"/maps/2dpR/map1/field_multiobs_map1.csv", Eigen::Vector2d{-20.0, -10.0}, 0.1};
+        _maps["2dpr_map2"] = SDFMapInfo{2, source_root+"/maps/2dpR/map2/field_multiobs_map2.csv", Eigen::Vector2d{-20.0, -10.0}, 0.1};
+        _maps["2dpr_map3"] = SDFMapInfo{2, source_root+"/maps/2dpR/map3/field_multiobs_map3.csv", Eigen::Vector2d{-20.0, -10.0}, 0.1};
+        _maps["2darm_map1"] = SDFMapInfo{2, source_root+"/maps/2dArm/field_one_obs.csv", Eigen::Vector2d{-1.0, -1.0}, 0.01};
+        _maps["2darm_map2"] = SDFMapInfo{2, source_root+"/maps/2dArm/field_two_obs.csv", Eigen::Vector2d{-1.0, -1.0}, 0.01};
+        _maps["wam_desk"] = SDFMapInfo{3, source_root+"/maps/WAM/WAMDeskDataset.bin", Eigen::VectorXd{}, 0.0};
+        _maps["3dpr"] = SDFMapInfo{3, source_root+"/maps/3dpR/pRSDF3D.bin", Eigen::VectorXd{}, 0.0};
+    }
+
+    /// the cached instances of the sdf type, with the lock held
+    template <typename SDF>
+    auto& sdf_cache(){
+        if constexpr (std::is_same<SDF, gpmp2::PlanarSDF>::value){
+            return _planar_sdfs;
+        }else{
+            return _sdfs;
+        }
+    }
+
+    /// with the lock held
+    void set_version(const std::string& name, size_t* version) const{
+        if (version){
+            *version = _map_versions.at(name);
+        }
+    }
+
+    /// the block and compact sdfs of a map, with the lock held
+    void release_map_copies(const std::string& name){
+        release_keys(_block_sdfs, name);
+        release_keys(_compact_sdfs, name);
+    }
+
+    template <typename CACHE>
+    static void release_keys(CACHE& cache, const std::string& name){
+        for (auto it = cache.begin(); it != cache.end();){
+            if (it->first.compare(0, name.size() + 1, name + "@") == 0){
+                it = cache.erase(it);
+            }else{
+                ++it;
+            }
+        }
+    }
+
+    mutable std::mutex _mutex;
+    std::map<std::string, SDFMapInfo> _maps;
+    std::map<std::string, std::shared_ptr<const gpmp2::PlanarSDF>> _planar_sdfs;
+    std::map<std::string, std::shared_ptr<const gpmp2::SignedDistanceField>> _sdfs;
+    std::map<const void*, std::pair<std::shared_ptr<const void>, std::shared_ptr<const BatchSDF>>> _batch_sdfs;
+    std::map<std::string, std::shared_ptr<const BlockSDF>> _block_sdfs;
+    std::map<std::string, std::shared_ptr<const CompactSDF>> _compact_sdfs;
+    std::map<std::string, std::shared_ptr<const void>> _robots;
+    /// the versions of the cached instances of the maps
+    std::map<std::string, size_t> _map_versions;
+    size_t _version_counter = 0;
+    /// the maps whose cached instances were replaced by update_map
+    std::set<std::string> _updated_maps;
+};
+
+} // namespace vimp
@@ -34,16 +34,15 @@ using Base = RobotSDFBase<ArmModel, SDF, ObsArmSDF>;
                 Base(1, 7),
                 _eps(eps)
             {
-                Base::_sdf.loadSDF(sdf_file);
-                Base::_psdf = std::make_shared<SDF>(Base::_sdf);
+                Base::use_registry_sdf(sdf_file);
                 generateArm();
-                Base::_psdf_factor = std::make_shared<ObsArmSDF>(ObsArmSDF(sym('x', 0), Base::_robot, Base::_sdf, 0.0, _eps));
+                Base::_psdf_factor = std::make_shared<ObsArmSDF>(ObsArmSDF(sym('x', 0), Base::_robot, *Base::_psdf, 0.0, _eps));
             }
 
             WamArmSDFExample(double eps, double radius): Base(1, 7), _eps(eps), _radius(radius){
                 default_sdf();
                 generateArm();
-                Base::_psdf_factor = std::make_shared<ObsArmSDF>(ObsArmSDF(sym('x', 0), Base::_robot, Base::_sdf, 0.0, _eps));
+                Base::_psdf_factor = std::make_shared<ObsArmSDF>(ObsArmSDF(sym('x', 0), Base::_robot, *Base::_psdf, 0.0, _eps));
             }
 
             WamArmSDFExample(double eps, double radius, const string & map_name, const string & sdf_file): 
@@ -53,9 +52,7 @@ using Base = RobotSDFBase<ArmModel, SDF, ObsArmSDF>;
             {
                 if (!sdf_file.empty()){
                     std::cout << "sdf_file.data()" << std::endl << sdf_file.data() << std::endl;
-                    Base::_sdf.loadSDF(sdf_file);
-                    
-                    Base::_psdf = std::make_shared<SDF>(Base::_sdf);
+                    Base::use_registry_sdf(sdf_file);
                 }
                 else{
                     std::runtime_error("Empty sdf map file!");
@@ -63,12 +60,11 @@ using Base = RobotSDFBase<ArmModel, SDF, ObsArmSDF>;
 
                 generateArm();
                 default_sdf();
-                Base::_psdf_factor = std::make_shared<ObsArmSDF>(ObsArmSDF(sym('x', 0), Base::_robot, Base::_sdf, 0.0, _eps));
+                Base::_psdf_factor = std::make_shared<ObsArmSDF>(ObsArmSDF(sym('x', 0), Base::_robot, *Base::_psdf, 0.0, _eps));
             }
 
-            inline void update_sdf(const SDF& sdf){
-                Base::_psdf = std::make_shared<SDF>(sdf);
-                Base::_psdf_factor = std::make_shared<ObsArmSDF>(ObsArmSDF(gtsam::symbol('x', 0), Base::_robot, sdf, 0.0, _eps));
+            void update_sdf_factor() override{
+                Base::_psdf_factor = std::make_shared<ObsArmSDF>(ObsArmSDF(gtsam::symbol('x', 0), Base::_robot, *Base::_psdf, 0.0, _eps));
             }
 
             void generateArm(){
@@ -128,11 +124,7 @@ using Base = RobotSDFBase<ArmModel, SDF, ObsArmSDF>;
             }
 
             void default_sdf(){
-                Base::_sdf = SDF();
-                std::string source_root{XSTRING(SOURCE_ROOT)};
-                std::string sdf_file{source_root+"/maps/WAM/WAMDeskDataset.bin"};
-                Base::_sdf.loadSDF(sdf_file);
-                Base::_psdf = std::make_shared<SDF>(Base::_sdf);
+                Base::use_registry_sdf("wam_desk");
             }
 
             
@@ -0,0 +1,99 @@
+/**
+ * @file bench_matrix3d_slice.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Benchmark of the time-indexed matrices for nt = 50...2000: one pass over the time steps
+ * with a by-value copy of the (nx*nx, nt) matrix per step, as the previous decomp3d did, against the Matrix3D slice views,
+ * and the linear covariance steering construct + solve which runs on the slice views.
+ * @version 0.1
+ * @date 2023-09-07
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "pgcsmp/LinearCovarianceSteering.h"
+#include "helpers/EigenWrapper.h"
+#include <chrono>
+#include <iomanip>
+
+using namespace vimp;
+
+/// The slice extraction before the views, taking the whole matrix by value.
+MatrixXd decomp3d_by_value(Matrix3D mat3d, int rows, int cols, int i){
+    return mat3d.col(i).reshaped(rows, cols);
+}
+
+template <typename Kernel>
+double ms_per_run(const Kernel& kernel, int n_repeat){
+    auto start = std::chrono::steady_clock::now();
+    for (int i_repeat=0; i_repeat<n_repeat; i_repeat++){
+        kernel();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / n_repeat;
+}
+
+int main(int argc, char* argv[]){
+    int n_repeat = 5;
+    if (argc == 2){
+        n_repeat = std::stoi(argv[1]);
+    }
+
+    EigenWrapper ei;
+    const int nx = 4, nu = 2;
+    const double T = 5.0, eps = 0.01;
+
+    // double integrator in the plane
+    MatrixXd A{MatrixXd::Zero(nx, nx)}, B{MatrixXd::Zero(nx, nu)};
+    A.topRightCorner(2, 2).setIdentity();
+    B.bottomRows(2).setIdentity();
+    VectorXd m0(nx), m1(nx);
+    m0 << 1, 8, 2, 0;
+    m1 << 1, 2, -1, 0;
+    MatrixXd Sig0{0.01 * MatrixXd::Identity(nx, nx)}, Sig1{0.1 * MatrixXd::Identity(nx, nx)};
+
+    std::cout << "nx = " << nx << ", nu = " << nu << ", " << n_repeat << " repeats" << std::endl
+              << "    nt   step loop, by value [ms]   step loop, slice views [ms]   linear CS construct + solve [ms]" << std::endl;
+
+    for (int nt : {50, 100, 200, 500, 1000, 2000}){
+        Matrix3D At = ei.replicate3d(A, nt), Bt = ei.replicate3d(B, nt), at = ei.replicate3d(VectorXd::Zero(nx), nt);
+        Matrix3D Qt = ei.replicate3d(MatrixXd::Identity(nx, nx), nt), rt = ei.replicate3d(VectorXd::Zero(nx), nt);
+        Matrix3D Sigt = ei.replicate3d(Sig0, nt);
+
+        // the same per-step work, Sig_i <- A_i * Sig_i + Sig_i * A_i^T
+        double checksum_by_value = 0.0, checksum_views = 0.0;
+        double t_by_value = ms_per_run([&](){
+            MatrixXd Ai(nx, nx), Sigi(nx, nx);
+            for (int i=0; i<nt; i++){
+                Ai = decomp3d_by_value(At, nx, nx, i);
+                Sigi = decomp3d_by_value(Sigt, nx, nx, i);
+                checksum_by_value += (Ai * Sigi + Sigi * Ai.transpose()).trace();
+            }
+        }, n_repeat);
+
+        double t_views = ms_per_run([&](){
+            MatrixXd Ai(nx, nx), Sigi(nx, nx);
+            for (int i=0; i<nt; i++){
+                Ai = At.slice(i);
+                Sigi = Sigt.slice(i);
+                checksum_views += (Ai * Sigi + Sigi * Ai.transpose()).trace();
+            }
+        }, n_repeat);
+
+        double t_linear_cs = ms_per_run([&](){
+            LinearCovarianceSteering linear_cs(At, Bt, at, nx, nu, T, nt, eps, Qt, rt, m0, Sig0, m1, Sig1);
+            linear_cs.solve();
+        }, n_repeat);
+
+        std::cout << std::setw(6) << nt
+                  << std::setw(27) << t_by_value
+                  << std::setw(30) << t_views
+                  << std::setw(35) << t_linear_cs << std::endl;
+
+        if (checksum_by_value != checksum_views){
+            std::cout << "checksum difference: " << checksum_by_value - checksum_views << std::endl;
+        }
+    }
+
+    return 0;
+}
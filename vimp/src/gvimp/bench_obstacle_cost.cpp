@@ -0,0 +1,86 @@
+/**
+ * @file bench_obstacle_cost.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Microbenchmark of the obstacle cost kernels: the per-call cost of the previous kernel 
+ * (dense identity precision and quadratic form) against the kernels in CostFunctions.h, 
+ * through gpmp2 evaluateError and through ObstacleHingeFactor with the per-thread workspace.
+ * @version 0.1
+ * @date 2023-09-07
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+#define STRING(x) #x
+#define XSTRING(x) STRING(x)
+
+#include "instances/CostFunctions.h"
+#include "robots/PlanarPointRobotSDFMultiObsExample.h"
+#include <chrono>
+#include <random>
+
+using namespace vimp;
+
+/// The kernel before the rework, kept here as the reference.
+template <typename ROBOT>
+double cost_obstacle_planar_reference(const VectorXd& pose, 
+                    const gpmp2::ObstaclePlanarSDFFactor<ROBOT>& obs_factor){
+    VectorXd vec_err = obs_factor.evaluateError(pose);
+
+    MatrixXd precision_obs{MatrixXd::Identity(vec_err.rows(), vec_err.rows())};
+    precision_obs = precision_obs / obs_factor.get_noiseModel()->sigmas()[0];
+
+    return vec_err.transpose().eval() * precision_obs * vec_err;
+}
+
+template <typename Kernel>
+double ns_per_call(const Kernel& kernel, const std::vector<VectorXd>& poses, int n_repeat, double& checksum){
+    auto start = std::chrono::steady_clock::now();
+    for (int i_repeat=0; i_repeat<n_repeat; i_repeat++){
+        for (const VectorXd& pose : poses){
+            checksum += kernel(pose);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / n_repeat / poses.size();
+}
+
+int main(int argc, char* argv[]){
+    int n_poses = 10000, n_repeat = 100;
+    if (argc == 3){
+        n_poses = std::stoi(argv[1]);
+        n_repeat = std::stoi(argv[2]);
+    }
+
+    PlanarPointRobotSDFMultiObsExample planar_pr_sdf("map2");
+    gpmp2::PointRobotModel robot_model = planar_pr_sdf.pRmodel();
+    gpmp2::PlanarSDF sdf = planar_pr_sdf.sdf();
+    using ObsFactor = gpmp2::ObstaclePlanarSDFFactor<gpmp2::PointRobotModel>;
+    ObsFactor obs_factor{gtsam::symbol('x', 0), robot_model, sdf, 0.5, 4.0};
+    ObstacleHingeFactor<ObsFactor> hinge_factor{gtsam::symbol('x', 0), robot_model, sdf, 0.5, 4.0};
+
+    // poses spread over the map, both in collision and in free space
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> uniform(-10.0, 20.0);
+    std::vector<VectorXd> poses(n_poses, VectorXd(2));
+    for (VectorXd& pose : poses){
+        pose << uniform(gen), uniform(gen) / 2.0;
+    }
+
+    double checksum_reference = 0.0, checksum_gpmp2 = 0.0, checksum = 0.0;
+    double t_reference = ns_per_call([&](const VectorXd& pose){ return cost_obstacle_planar_reference(pose, obs_factor); }, 
+                                     poses, n_repeat, checksum_reference);
+    double t_gpmp2 = ns_per_call([&](const VectorXd& pose){ return cost_obstacle_planar(pose, obs_factor); }, 
+                                 poses, n_repeat, checksum_gpmp2);
+    double t_kernel = ns_per_call([&](const VectorXd& pose){ return cost_obstacle_planar<gpmp2::PointRobotModel>(pose, hinge_factor); }, 
+                                  poses, n_repeat, checksum);
+
+    std::cout << "obstacle cost per call, reference:            " << t_reference << " [ns]" << std::endl
+              << "obstacle cost per call, gpmp2 evaluateError:  " << t_gpmp2 << " [ns]" << std::endl
+              << "obstacle cost per call, hinge factor kernel:  " << t_kernel << " [ns]" << std::endl
+              << "speedup: " << t_reference / t_kernel << std::endl
+              << "checksum differences: " << std::abs(checksum_reference - checksum_gpmp2) << ", "
+              << std::abs(checksum_reference - checksum) << std::endl;
+
+    return 0;
+}
@@ -62,8 +62,8 @@ int main(){
     /// Vector of base factored optimizers
     vector<std::shared_ptr<GVIFactorizedBase>> vec_factors;
 
-    auto robot_model = _robot_sdf.RobotModel();
-    auto sdf = _robot_sdf.sdf();
+    const auto& robot_model = _robot_sdf.RobotModel();
+    const auto& sdf = _robot_sdf.sdf();
     // double sig_obs = params.sig_obs(), eps_sdf = params.eps_sdf();
     // double temperature = params.temperature(), high_temperature = params.high_temperature();
 
@@ -74,6 +74,9 @@ int main(){
     /// prior 
     double delt_t = params.total_time() / N;
 
+    /// one GP prior definition (Phi, Q^{-1}, closed-form terms) shared among all the linear prior factors
+    auto gp_model = std::make_shared<const MinimumAccGPModel>(Qc, delt_t);
+
     for (int i = 0; i < n_states; i++) {
 
         // initial state
@@ -83,7 +86,7 @@ int main(){
         theta_i.segment(dim_conf, dim_conf) = avg_vel;
         joint_init_theta.segment(i*dim_state, dim_state) = std::move(theta_i);   
 
-        MinimumAccGP lin_gp{Qc, i, delt_t, start_theta};
+        MinimumAccGP lin_gp{gp_model, i, start_theta};
 
         // fixed start and goal priors
         // Factor Order: [fixed_gp_0, lin_gp_1, obs_1, ..., lin_gp_(N-1), obs_(N-1), lin_gp_(N), fixed_gp_(N)] 
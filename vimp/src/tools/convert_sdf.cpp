@@ -0,0 +1,51 @@
+/**
+ * @file convert_sdf.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Convert the csv fields and the gpmp2 .bin maps to the binary sdf format (helpers/SDFFile.h).
+ * Usage: 
+ *   convert_sdf <field.csv> <output.sdfb> <origin_x> <origin_y> <cell_size> [--float]
+ *   convert_sdf <map.bin> <output.sdfb> [--float]
+ * @version 0.1
+ * @date 2023-09-08
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+#include "robots/SDFLoader.h"
+
+using namespace vimp;
+
+int main(int argc, char* argv[]){
+    std::vector<std::string> args(argv + 1, argv + argc);
+    bool single_precision = false;
+    if (!args.empty() && args.back() == "--float"){
+        single_precision = true;
+        args.pop_back();
+    }
+
+    if (args.size() == 5){
+        Eigen::VectorXd origin(2);
+        origin << std::stod(args[2]), std::stod(args[3]);
+        double cell_size = std::stod(args[4]);
+
+        MatrixIO m_io;
+        Eigen::MatrixXd field = m_io.load_csv(args[0]);
+        write_sdf_file(args[1], origin, cell_size, std::vector<Eigen::MatrixXd>{field}, single_precision);
+        std::cout << "Converted planar field " << args[0] << " (" << field.rows() << " x " << field.cols() 
+                  << ") to " << args[1] << std::endl;
+        return 0;
+    }
+    else if (args.size() == 2){
+        gpmp2::SignedDistanceField sdf;
+        sdf.loadSDF(args[0]);
+        write_sdf_file(args[1], sdf, single_precision);
+        std::cout << "Converted 3D sdf " << args[0] << " to " << args[1] << std::endl;
+        return 0;
+    }
+
+    std::cout << "Usage: " << std::endl
+              << "  convert_sdf <field.csv> <output.sdfb> <origin_x> <origin_y> <cell_size> [--float]" << std::endl
+              << "  convert_sdf <map.bin> <output.sdfb> [--float]" << std::endl;
+    return 1;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file test_free_space.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Test the free-space early-out of the nonlinear factors with a point robot and a circle obstacle.
+ * @version 0.1
+ * @date 2023-09-06
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+#include "gvimp/GVIFactorizedNonlinerGH.h"
+#include <gtest/gtest.h>
+
+using namespace Eigen;
+using namespace vimp;
+
+struct CircleObstacle{
+    Vector2d center{0.0, 0.0};
+    double radius = 1.0, eps = 0.5, sigma = 0.1;
+
+    double signed_distance(const VectorXd& x) const{ return (x.head(2) - center).norm() - radius; }
+};
+
+double cost_circle(const VectorXd& x, const CircleObstacle& obs){
+    double hinge = std::max(0.0, obs.eps - obs.signed_distance(x));
+    return hinge * hinge / obs.sigma;
+}
+
+using CircleFactor = GVIFactorizedNonlinerGH<CircleObstacle>;
+
+TEST(TestFreeSpace, early_out){
+    auto p_obs = std::make_shared<const CircleObstacle>();
+    int n_skipped = 0;
+    auto free_space_test = [p_obs, &n_skipped](const VectorXd& x, double radius){
+        bool free = p_obs->signed_distance(x) - radius > p_obs->eps;
+        n_skipped += free;
+        return free;
+    };
+
+    CircleFactor factor{2, 2, cost_circle, p_obs, 1, 0, 10.0, 100.0};
+    factor.set_GH_points(6);
+    factor.set_free_space_test(free_space_test);
+    factor.update_covariance(MatrixXd::Identity(2, 2) * 0.01);
+
+    // far from the obstacle: skipped, with the same (zero) moments as the integration
+    VectorXd mean_far{(VectorXd(2) << 3.0, 0.5).finished()};
+    factor.update_mu(mean_far);
+    factor.calculate_partial_V();
+    ASSERT_EQ(n_skipped, 1);
+    ASSERT_EQ(factor.Vdmu().norm(), 0.0);
+    ASSERT_EQ(factor.Vddmu().norm(), 0.0);
+
+    factor.calculate_partial_V_GH();
+    ASSERT_EQ(factor.Vdmu().norm(), 0.0);
+    ASSERT_EQ(factor.Vddmu().norm(), 0.0);
+
+    SpMat joint_cov = MatrixXd{MatrixXd::Identity(2, 2) * 0.01}.sparseView();
+    ASSERT_EQ(factor.fact_cost_value(mean_far, joint_cov), 0.0);
+    ASSERT_EQ(n_skipped, 2);
+
+    // close to the obstacle: integrated
+    VectorXd mean_close{(VectorXd(2) << 1.6, 0.0).finished()};
+    factor.update_mu(mean_close);
+    factor.calculate_partial_V();
+    ASSERT_EQ(n_skipped, 2);
+    ASSERT_GT(factor.Vddmu().norm(), 0.0);
+    ASSERT_GT(factor.fact_cost_value(mean_close, joint_cov), 0.0);
+}
+
+TEST(TestFreeSpace, kept_moments){
+    auto p_obs = std::make_shared<CircleObstacle>();
+    int n_costs = 0;
+    auto counted_cost = [&n_costs](const VectorXd& x, const CircleObstacle& obs){
+        n_costs++;
+        return cost_circle(x, obs);
+    };
+    CircleFactor factor{2, 2, counted_cost, p_obs, 1, 0, 10.0, 100.0};
+    factor.update_covariance(MatrixXd::Identity(2, 2) * 0.01);
+    factor.update_mu((VectorXd(2) << 1.6, 0.0).finished());
+
+    // the same marginal: the moments are kept
+    factor.calculate_partial_V();
+    int n_integration = n_costs;
+    VectorXd Vdmu = factor.Vdmu();
+    factor.calculate_partial_V();
+    ASSERT_EQ(n_costs, n_integration);
+
+    // a change of the cost away from the quadrature ball keeps them
+    auto far_change = [](const VectorXd& mean, double radius){ return (mean - Vector2d{5.0, 5.0}).norm() <= radius; };
+    ASSERT_FALSE(factor.invalidate_moments(far_change));
+    factor.calculate_partial_V();
+    ASSERT_EQ(n_costs, n_integration);
+
+    // the obstacle grows: the factor is re-integrated with the new cost
+    p_obs->radius = 1.2;
+    auto near_change = [](const VectorXd& mean, double radius){ return (mean - Vector2d{1.2, 0.0}).norm() <= radius + 0.5; };
+    ASSERT_TRUE(factor.invalidate_moments(near_change));
+    factor.calculate_partial_V();
+    ASSERT_EQ(n_costs, 2*n_integration);
+    ASSERT_GT((factor.Vdmu() - Vdmu).norm(), 0.0);
+
+    // a new marginal is integrated
+    factor.update_mu((VectorXd(2) << 1.7, 0.0).finished());
+    factor.calculate_partial_V();
+    ASSERT_EQ(n_costs, 3*n_integration);
+}
+
+TEST(TestFreeSpace, versioned_moments){
+    auto p_obs = std::make_shared<CircleObstacle>();
+    int n_costs = 0;
+    auto counted_cost = [&n_costs](const VectorXd& x, const CircleObstacle& obs){
+        n_costs++;
+        return cost_circle(x, obs);
+    };
+    size_t version = 1;
+    CircleFactor factor{2, 2, counted_cost, p_obs, 1, 0, 10.0, 100.0};
+    factor.set_cost_version([&version](){ return version; });
+    factor.update_covariance(MatrixXd::Identity(2, 2) * 0.01);
+    factor.update_mu((VectorXd(2) << 1.6, 0.0).finished());
+
+    factor.calculate_partial_V();
+    int n_integration = n_costs;
+    factor.calculate_partial_V();
+    ASSERT_EQ(n_costs, n_integration);
+
+    // a full replacement of the cost, e.g., RobotSDFBase::update_sdf, drops the moments without invalidate_moments
+    p_obs->radius = 1.2;
+    version = 2;
+    factor.calculate_partial_V();
+    ASSERT_EQ(n_costs, 2*n_integration);
+    factor.calculate_partial_V();
+    ASSERT_EQ(n_costs, 2*n_integration);
+
+    // a local change found away from the quadrature ball keeps them for the new version
+    version = 3;
+    auto far_change = [](const VectorXd& mean, double radius){ return (mean - Vector2d{5.0, 5.0}).norm() <= radius; };
+    ASSERT_FALSE(factor.invalidate_moments(far_change));
+    factor.calculate_partial_V();
+    ASSERT_EQ(n_costs, 2*n_integration);
+
+    // and a local change reaching it drops them
+    version = 4;
+    auto near_change = [](const VectorXd& mean, double radius){ return (mean - Vector2d{1.2, 0.0}).norm() <= radius + 0.5; };
+    ASSERT_TRUE(factor.invalidate_moments(near_change));
+    factor.calculate_partial_V();
+    ASSERT_EQ(n_costs, 3*n_integration);
+}
@@ -0,0 +1,85 @@
+/**
+ * @file test_gradient_GH.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Test the first order (Bonnet-Price) factor updates against the zeroth order GH estimators.
+ * @version 0.1
+ * @date 2023-09-04
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+#include "gvimp/GVIFactorizedNonlinerGradGH.h"
+#include <gtest/gtest.h>
+
+using namespace Eigen;
+using namespace vimp;
+
+/// A residual cost e(x)^T e(x) / sigma
+struct ResidualCost{
+    bool linear;
+    double sigma = 0.5;
+
+    VectorXd residual(const VectorXd& x, MatrixXd& J) const{
+        VectorXd e(2);
+        J.resize(2, 2);
+        if (linear){
+            e << 2.0*x(0) + x(1) - 1.0, x(0) - 3.0*x(1);
+            J << 2.0, 1.0, 1.0, -3.0;
+        }else{
+            e << x(0)*x(0) + x(1) - 1.0, x(0)*x(1);
+            J << 2.0*x(0), 1.0, x(1), x(0);
+        }
+        return e;
+    }
+};
+
+double cost_residual(const VectorXd& x, const ResidualCost& cost_class){
+    MatrixXd J;
+    return cost_class.residual(x, J).squaredNorm() / cost_class.sigma;
+}
+
+double cost_residual_gradient(const VectorXd& x, const ResidualCost& cost_class, VectorXd& grad, MatrixXd& hess){
+    MatrixXd J;
+    VectorXd e = cost_class.residual(x, J);
+    grad = 2.0 * J.transpose() * e / cost_class.sigma;
+    hess = 2.0 * J.transpose() * J / cost_class.sigma;
+    return e.squaredNorm() / cost_class.sigma;
+}
+
+using GradFactor = GVIFactorizedNonlinerGradGH<ResidualCost>;
+
+GradFactor make_factor(bool linear, int gradient_deg){
+    GradFactor factor{2, 2, cost_residual, cost_residual_gradient, std::make_shared<const ResidualCost>(ResidualCost{linear}), 
+                      1, 0, 10.0, 100.0, gradient_deg};
+    factor.update_mu((VectorXd(2) << 0.3, -0.2).finished());
+    factor.update_covariance((MatrixXd(2, 2) << 0.2, 0.05, 0.05, 0.1).finished());
+    factor.set_GH_points(6);
+    return factor;
+}
+
+TEST(TestGradientGH, linear_residual){
+    // exact Hessian, the degree 2 first order estimators agree with the zeroth order ones
+    GradFactor factor = make_factor(true, 2);
+
+    factor.calculate_partial_V_GH();
+    VectorXd Vdmu_gh = factor.Vdmu();
+    MatrixXd Vddmu_gh = factor.Vddmu();
+
+    factor.calculate_partial_V();
+    ASSERT_LE((factor.Vdmu() - Vdmu_gh).norm(), 1e-8);
+    ASSERT_LE((factor.Vddmu() - Vddmu_gh).norm(), 1e-8);
+}
+
+TEST(TestGradientGH, nonlinear_residual){
+    // polynomial residuals: the gradient is exact with degree 2, the Hessian differs by the Gauss-Newton approximation
+    GradFactor factor = make_factor(false, 2);
+
+    factor.calculate_partial_V_GH();
+    VectorXd Vdmu_gh = factor.Vdmu();
+
+    factor.calculate_partial_V();
+    ASSERT_LE((factor.Vdmu() - Vdmu_gh).norm(), 1e-8);
+    ASSERT_LE((factor.Vddmu() - factor.Vddmu().transpose()).norm(), 1e-12);
+    ASSERT_GE(SelfAdjointEigenSolver<MatrixXd>(factor.Vddmu()).eigenvalues().minCoeff(), -1e-12);
+}
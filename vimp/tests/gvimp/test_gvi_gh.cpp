@@ -0,0 +1,133 @@
+/**
+ * @file test_gvi_gh.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Test the joint GVI-GH optimizer on small quadratic problems, where the Gauss-Hermite integrations are exact.
+ * @version 0.1
+ * @date 2023-09-12
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "gvimp/GVIFactorizedNonlinerGH.h"
+#include "gvimp/GVI-GH.h"
+#include <gtest/gtest.h>
+
+using namespace Eigen;
+using namespace vimp;
+
+/// weight * ||A x - b||^2
+struct QuadraticCost{
+    MatrixXd A;
+    VectorXd b;
+    double weight = 1.0;
+};
+
+double cost_quadratic(const VectorXd& x, const QuadraticCost& cost){
+    return cost.weight * (cost.A * x - cost.b).squaredNorm();
+}
+
+using QuadraticFactor = GVIFactorizedNonlinerGH<QuadraticCost>;
+
+int dim_state = 2, num_states = 4, dim = dim_state * num_states;
+double temperature = 1.0, high_temperature = 10.0;
+
+/**
+ * @brief Unary factors pulling each state to a target, and if w_loop > 0, one factor coupling the first and the last states.
+ */
+std::vector<std::shared_ptr<GVIFactorizedBase>> quadratic_chain(int n_states, double w_loop){
+    std::vector<std::shared_ptr<GVIFactorizedBase>> factors;
+    for (int i=0; i<n_states; i++){
+        auto p_unary = std::make_shared<const QuadraticCost>(QuadraticCost{MatrixXd::Identity(dim_state, dim_state),
+                                                                           VectorXd::Constant(dim_state, double(i)), 1.0});
+        factors.emplace_back(new QuadraticFactor{dim_state, dim_state, cost_quadratic, p_unary, n_states, i, temperature, high_temperature});
+    }
+    if (w_loop > 0){
+        MatrixXd A_loop(dim_state, 2*dim_state);
+        A_loop << MatrixXd::Identity(dim_state, dim_state), -MatrixXd::Identity(dim_state, dim_state);
+        auto p_loop = std::make_shared<const QuadraticCost>(QuadraticCost{A_loop, VectorXd::Zero(dim_state), w_loop});
+        factors.emplace_back(new QuadraticFactor{std::vector<int>{0, n_states-1}, dim_state, cost_quadratic, p_loop, n_states, temperature, high_temperature});
+    }
+    return factors;
+}
+
+TEST(TestGVIGH, non_adjacent_factor){
+    double w_loop = 3.0;
+    auto factors = quadratic_chain(num_states, w_loop);
+    GVIGH<GVIFactorizedBase> optimizer{factors, dim_state, num_states, 5, temperature, high_temperature};
+
+    VectorXd mu = VectorXd::LinSpaced(dim, 0.0, 1.0);
+    optimizer.set_mu(mu);
+    optimizer.initilize_precision_matrix(2.0);
+
+    // the marginal of the loop factor is the first and the last states
+    VectorXd mu_loop(2*dim_state);
+    mu_loop << mu.head(dim_state), mu.tail(dim_state);
+    ASSERT_LE((factors.back()->mean() - mu_loop).norm(), 1e-12);
+    ASSERT_EQ(factors.back()->block().states(), (std::vector<int>{0, num_states-1}));
+
+    optimizer.compute_gradients();
+
+    // the joint gradients against a dense assembly of P_k^T * V_k * P_k
+    VectorXd Vdmu_dense = VectorXd::Zero(dim);
+    MatrixXd Vddmu_dense = MatrixXd::Zero(dim, dim);
+    for (auto & p_factor : factors){
+        MatrixXd Pk = p_factor->Pk();
+        Vdmu_dense += Pk.transpose() * p_factor->Vdmu();
+        Vddmu_dense += Pk.transpose() * p_factor->Vddmu() * Pk;
+    }
+    ASSERT_LE((optimizer.Vdmu() - Vdmu_dense).norm(), 1e-9);
+    ASSERT_LE((MatrixXd{optimizer.Vddmu()} - Vddmu_dense).norm(), 1e-9);
+
+    // the coupling block is exact for the quadratic cost: -2 * w / T * I
+    MatrixXd coupling = MatrixXd{optimizer.Vddmu()}.block(0, (num_states-1)*dim_state, dim_state, dim_state);
+    ASSERT_LE((coupling + 2.0 * w_loop / temperature * MatrixXd::Identity(dim_state, dim_state)).norm(), 1e-9);
+
+    // the joint cost against dense factor costs and log determinant
+    SpMat precision = optimizer.precision();
+    MatrixXd cov_dense = MatrixXd{precision}.inverse();
+    double cost_dense = 0.0;
+    for (auto & p_factor : factors){
+        cost_dense += p_factor->fact_cost_value(mu, cov_dense.sparseView());
+    }
+    cost_dense += std::log(MatrixXd{precision}.determinant()) / 2.0;
+    ASSERT_LE(std::abs(optimizer.cost_value(mu, precision) - cost_dense), 1e-9);
+}
+
+TEST(TestGVIGH, memory_report){
+    auto sp_bytes = [](const SpMat & m){
+        return m.nonZeros() * (sizeof(double) + sizeof(int)) + (m.outerSize() + 1) * sizeof(int);
+    };
+
+    std::vector<size_t> factor_bytes, joint_bytes;
+    for (int n_states : {10, 100}){
+        auto factors = quadratic_chain(n_states, 0.0);
+        GVIGH<GVIFactorizedBase> optimizer{factors, dim_state, n_states, 5, temperature, high_temperature};
+        optimizer.set_mu(VectorXd::Zero(dim_state*n_states));
+        optimizer.initilize_precision_matrix(2.0);
+
+        size_t bytes = 0;
+        for (auto & p_factor : factors){
+            bytes += p_factor->memory_bytes();
+        }
+        ASSERT_EQ(optimizer.factors_memory_bytes(), bytes);
+        factor_bytes.push_back(bytes / n_states);
+
+        // the block diagonal pattern has no fill: the 8 joint matrices in the fixed pattern and the 2 permuted 
+        // covariances have the nonzeros of the pattern, L at most as many; the index tables and values at most 4 per nonzero.
+        SpMat precision = optimizer.precision();
+        int nnz = n_states * dim_state * dim_state;
+        ASSERT_EQ(precision.nonZeros(), nnz);
+        ASSERT_GE(optimizer.joint_memory_bytes(), 10 * sp_bytes(precision));
+        ASSERT_LE(optimizer.joint_memory_bytes(), 11 * sp_bytes(precision) + (3*dim_state*n_states + 4*nnz) * sizeof(double));
+        joint_bytes.push_back(optimizer.joint_memory_bytes());
+
+        std::stringstream report;
+        optimizer.memory_report(report);
+        ASSERT_NE(report.str().find("per factor (bytes): " + std::to_string(bytes / n_states)), std::string::npos);
+    }
+
+    // the factors do not grow with the trajectory length, and the joint matrices grow linearly
+    ASSERT_EQ(factor_bytes[0], factor_bytes[1]);
+    ASSERT_LE(joint_bytes[1], 11 * joint_bytes[0]);
+}
@@ -1,6 +1,8 @@
 #include "instances/FactorizedGVIPlanar.h"
+#include "instances/SDFFreeSpaceBound.h"
 #include "robots/PlanarPointRobotSDFMultiObsExample.h"
 #include <gtest/gtest.h>
+#include <random>
 #include <gpmp2/obstacle/ObstaclePlanarSDFFactorPointRobot.h>
 
 using namespace gpmp2;
@@ -107,6 +109,32 @@ TEST(ColCost, collision_cost){
 
 }
 
+// *** Test the hinge losses evaluated into the workspace against gpmp2 evaluateError
+TEST(ColCost, hinge_factor_workspace){
+    ObstacleHingeFactor<gpmp2::ObstaclePlanarSDFFactorPointRobot> hinge_k{gtsam::symbol('x', 0), pRModel, sdf, cost_sigma, epsilon};
+
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> uniform(0.0, 20.0);
+    for (int i=0; i<100; i++){
+        VectorXd pose(2);
+        pose << uniform(gen), uniform(gen);
+
+        gtsam::Matrix J_gpmp2;
+        VectorXd vec_err = collision_k.evaluateError(pose, J_gpmp2);
+
+        VectorXd grad, grad_gpmp2;
+        MatrixXd hess, hess_gpmp2;
+        double cost_gpmp2 = cost_obstacle_planar_gradient<gpmp2::PointRobotModel>(pose, collision_k, grad_gpmp2, hess_gpmp2);
+        double cost = cost_obstacle_planar_gradient<gpmp2::PointRobotModel>(pose, hinge_k, grad, hess);
+
+        ASSERT_LE(abs(cost_gpmp2 - vec_err.squaredNorm() / cost_sigma), 1e-10);
+        ASSERT_LE(abs(cost - cost_gpmp2), 1e-10);
+        ASSERT_LE(abs(cost_obstacle_planar<gpmp2::PointRobotModel>(pose, hinge_k) - cost_gpmp2), 1e-10);
+        ASSERT_LE((grad - grad_gpmp2).norm(), 1e-10);
+        ASSERT_LE((hess - hess_gpmp2).norm(), 1e-10);
+    }
+}
+
 // *** Test the prior cost with a fixed Gaussian target
 TEST(PriorCost, fixed_cost){
     /// Vector of base factored optimizers
@@ -229,3 +257,109 @@ TEST(PriorCost, dynamics_prior_cost){
 
     ASSERT_LE(abs(cost_prior - cost_prior_expected), 1e-4);
 }
+
+
+// *** Test the linear priors sharing one GP definition: closed-form gradients against GH integration
+TEST(PriorCost, shared_model_closed_form){
+    auto gp_model = std::make_shared<const MinimumAccGPModel>(Qc, delt_t);
+    MinimumAccGP lin_gp{gp_model, 0, theta_0};
+    MinimumAccGP lin_gp_own{Qc, 0, delt_t, theta_0};
+
+    ASSERT_LE((lin_gp.get_Lambda() - lin_gp_own.get_Lambda()).norm(), 1e-10);
+    ASSERT_LE((lin_gp.get_precision() - lin_gp_own.get_precision()).norm(), 1e-10);
+    ASSERT_LE(abs(lin_gp.cost(theta_0, theta_1) - lin_gp_own.cost(theta_0, theta_1)), 1e-10);
+
+    LinearGpPrior factor{joint_state_dim, state_dim, cost_linear_gp, lin_gp, n_states, 0, 10.0, 100.0};
+    LinearGpPrior factor_copy{factor};
+    ASSERT_EQ(factor.terms().get(), factor_copy.terms().get());
+
+    factor.update_mu(joint_mean);
+    factor.update_covariance(precision.inverse());
+    factor.set_GH_points(6);
+
+    factor.calculate_partial_V_GH();
+    VectorXd Vdmu_gh = factor.Vdmu();
+    MatrixXd Vddmu_gh = factor.Vddmu();
+
+    factor.calculate_partial_V();
+    ASSERT_LE((factor.Vdmu() - Vdmu_gh).norm(), 1e-6);
+    ASSERT_LE((factor.Vddmu() - Vddmu_gh).norm(), 1e-6);
+}
+
+
+// *** Test the free-space skips of the collision factors in a joint optimizer, 
+// on a point robot and a circle obstacle with an analytic sdf
+TEST(ColCost, free_space_skip_count){
+    using PlanarSDFFactorPR = gpmp2::ObstaclePlanarSDFFactor<gpmp2::PointRobotModel>;
+    using GVIFactorizedPlanarSDFPR = GVIFactorizedPlanarSDF<gpmp2::PointRobotModel>;
+
+    // 20m x 20m map, one circle obstacle of radius 2 at (10, 10)
+    double cell = 0.1, obs_radius = 2.0;
+    Vector2d obs_center{10.0, 10.0};
+    MatrixXd field(200, 200);
+    for (int i=0; i<field.rows(); i++){
+        for (int j=0; j<field.cols(); j++){
+            field(i, j) = (Vector2d{j*cell, i*cell} - obs_center).norm() - obs_radius;
+        }
+    }
+    gpmp2::PlanarSDF circle_sdf(gtsam::Point2(0, 0), cell, field);
+
+    gpmp2::PointRobot pR(2, 1);
+    gpmp2::BodySphereVector body_spheres;
+    body_spheres.push_back(gpmp2::BodySphere(0, 0.5, gtsam::Point3(0.0, 0.0, 0.0)));
+    gpmp2::PointRobotModel pR_model(pR, body_spheres);
+
+    double eps_sdf = 0.5, sig_obs = 0.01, temperature = 10.0, high_temperature = 100.0;
+    int dim_conf = 2, dim_state_pr = 4, n_states = 6;
+    auto p_obs_cost = std::make_shared<const PlanarSDFFactorPR>(gtsam::symbol('x', 0), pR_model, circle_sdf, sig_obs, eps_sdf);
+
+    auto p_free_space = std::make_shared<SDFFreeSpaceBound<gpmp2::PointRobotModel, gpmp2::PlanarSDF>>(pR_model, circle_sdf, eps_sdf);
+    auto free_space_test = [p_free_space](const VectorXd& conf, double radius){ return (*p_free_space)(conf, radius); };
+
+    // states 0, 2, 4 are 6m away from the obstacle, states 1, 3, 5 are within the hinge range of its boundary
+    VectorXd joint_mean(n_states * dim_state_pr);
+    joint_mean.setZero();
+    std::vector<std::shared_ptr<GVIFactorizedPlanarSDFPR>> col_factors;
+    vector<std::shared_ptr<GVIFactorizedBase>> vec_factors;
+    for (int i=0; i<n_states; i++){
+        double angle = i * M_PI / n_states;
+        double distance = (i % 2 == 0) ? 8.0 : obs_radius + 0.7;
+        joint_mean.segment(i*dim_state_pr, dim_conf) = obs_center + distance * Vector2d{std::cos(angle), std::sin(angle)};
+
+        std::shared_ptr<GVIFactorizedPlanarSDFPR> p_col{new GVIFactorizedPlanarSDFPR{dim_conf, dim_state_pr, cost_obstacle_planar<gpmp2::PointRobotModel>, 
+                                                                                      p_obs_cost, n_states, i, temperature, high_temperature}};
+        p_col->set_free_space_test(free_space_test);
+        col_factors.push_back(p_col);
+        vec_factors.emplace_back(p_col);
+    }
+
+    GVIGH<GVIFactorizedBase> optimizer{vec_factors, dim_state_pr, n_states, 5, temperature, high_temperature};
+    optimizer.set_mu(joint_mean);
+    optimizer.initilize_precision_matrix(10000.0);
+    optimizer.set_GH_degree(3);
+
+    // one gradient step and one cost evaluation: each factor queries the test once in both
+    optimizer.compute_gradients();
+    ASSERT_EQ(p_free_space->n_queries(), n_states);
+    ASSERT_EQ(p_free_space->n_skipped(), n_states / 2);
+
+    double cost = optimizer.cost_value_no_entropy();
+    ASSERT_EQ(p_free_space->n_queries(), 2 * n_states);
+    ASSERT_EQ(p_free_space->n_skipped(), n_states);
+
+    // the skipped factors have exact zero moments and costs, the others are integrated
+    SpMat joint_cov = optimizer.covariance();
+    double cost_near = 0.0;
+    for (int i=0; i<n_states; i++){
+        if (i % 2 == 0){
+            ASSERT_EQ(col_factors[i]->Vdmu().norm(), 0.0);
+            ASSERT_EQ(col_factors[i]->Vddmu().norm(), 0.0);
+        }else{
+            ASSERT_GT(col_factors[i]->Vddmu().norm(), 0.0);
+            cost_near += col_factors[i]->fact_cost_value(joint_mean, joint_cov);
+        }
+    }
+    ASSERT_GT(cost, 0.0);
+    ASSERT_LE(abs(cost - cost_near), 1e-10);
+    ASSERT_EQ(p_free_space->n_skipped(), n_states);
+}
@@ -129,5 +129,24 @@ TEST(GaussHermite, three_dim){
 
 }
 
+TEST(GaussHermite, quadrature_points){
+    int dim = 2;
+    VectorXd m = VectorXd::Ones(dim);
+    MatrixXd prec(dim, dim);
+    prec << 1.0,-0.74,-0.74,1.0;
+    MatrixXd cov{prec.inverse()};
 
+    GaussHermite<Function> gausshermite(10, dim, m, cov, gx_2d);
+
+    MatrixXd points;
+    VectorXd weights;
+    gausshermite.quadrature(points, weights);
+    ASSERT_EQ(points.cols(), 100);
 
+    MatrixXd integral2{MatrixXd::Zero(2, 1)};
+    for (int k=0; k<points.cols(); k++){
+        integral2 += weights(k) * gx_2d(points.col(k));
+    }
+
+    ASSERT_LE((integral2 - gausshermite.Integrate()).norm(), 1e-10);
+}
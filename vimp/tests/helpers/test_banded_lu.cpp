@@ -0,0 +1,66 @@
+/**
+ * @file test_banded_lu.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Test the banded LU factorization against the dense solver.
+ * @version 0.1
+ * @date 2023-09-17
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "helpers/BandedLU.h"
+#include <gtest/gtest.h>
+
+using namespace vimp;
+using namespace Eigen;
+
+/// a random banded matrix, with a zero diagonal so that the rows have to be swapped
+void fill_random_band(BandedLU& lu, MatrixXd& dense, int kl, int ku){
+    int n = dense.rows();
+    dense.setZero();
+    lu.setZero();
+    for (int j=0; j<n; j++){
+        for (int i=std::max(0, j-ku); i<=std::min(n-1, j+kl); i++){
+            double value = (i == j) ? 0.0 : MatrixXd::Random(1, 1)(0, 0);
+            dense(i, j) = value;
+            lu.coeffRef(i, j) = value;
+        }
+    }
+}
+
+TEST(BandedLU, dense_solution){
+    for (auto [n, kl, ku] : std::vector<std::tuple<int, int, int>>{{40, 3, 5}, {57, 11, 11}, {9, 1, 0}, {30, 29, 29}}){
+        BandedLU lu(n, kl, ku);
+        MatrixXd dense(n, n);
+        fill_random_band(lu, dense, kl, ku);
+        if (ku == 0){
+            // lower bidiagonal with a zero diagonal is singular
+            ASSERT_FALSE(lu.factorize());
+            ASSERT_THROW(lu.solve(VectorXd::Ones(n)), std::runtime_error);
+            continue;
+        }
+        ASSERT_TRUE(lu.factorize());
+
+        VectorXd b = VectorXd::Random(n);
+        VectorXd x = lu.solve(b);
+        VectorXd x_dense = dense.fullPivLu().solve(b);
+        ASSERT_LE((x - x_dense).norm(), 1e-9 * x_dense.norm());
+        ASSERT_LE((dense * x - b).norm(), 1e-10 * b.norm());
+    }
+}
+
+TEST(BandedLU, refill){
+    // the same storage for new coefficients
+    int n = 25, kl = 4, ku = 2;
+    BandedLU lu(n, kl, ku);
+    MatrixXd dense(n, n);
+    for (int k=0; k<3; k++){
+        fill_random_band(lu, dense, kl, ku);
+        ASSERT_TRUE(lu.factorize());
+        VectorXd b = VectorXd::Random(n);
+        ASSERT_LE((dense * lu.solve(b) - b).norm(), 1e-10 * b.norm());
+    }
+    ASSERT_THROW(lu.coeffRef(10, 3), std::out_of_range);
+    ASSERT_THROW(lu.coeffRef(3, 6), std::out_of_range);
+}
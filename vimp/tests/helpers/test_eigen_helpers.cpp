@@ -14,6 +14,7 @@
 #include "helpers/timer.h"
 #include "helpers/EigenWrapper.h"
 #include "helpers/MatrixIO.h"
+#include "helpers/sparse_graph.h"
 
 #include<Eigen/IterativeLinearSolvers>
 
@@ -381,6 +382,130 @@ TEST(TestSparse, sparse_inverse){
     
 }
 
+/**
+ * @brief Test the value-array operations on a fixed sparsity pattern.
+ */
+TEST(TestSparse, fixed_pattern_operations){
+    Eigen::MatrixXd precision = m_io.load_csv("data/precision_large.csv");
+    int size = precision.rows();
+    SpMat precision_sp = precision.sparseView();
+    precision_sp.makeCompressed();
+
+    SpMat X, Y;
+    eigen_wrapper.sp_shape_as(precision_sp, X);
+    eigen_wrapper.sp_shape_as(precision_sp, Y);
+    ASSERT_TRUE(eigen_wrapper.sp_same_pattern(X, precision_sp));
+    ASSERT_EQ(X.norm(), 0);
+
+    // axpby on the value arrays
+    eigen_wrapper.sp_axpby(2.0, precision_sp, -1.0, precision_sp, X);
+    ASSERT_TRUE(eigen_wrapper.matrix_equal(Eigen::MatrixXd{X}, precision));
+
+    // block accumulation into existing entries
+    Eigen::MatrixXd blk = precision.block(4, 4, 8, 8);
+    eigen_wrapper.sp_add_block(Y, 4, 4, blk);
+    Eigen::MatrixXd Y_true{Eigen::MatrixXd::Zero(size, size)};
+    Y_true.block(4, 4, 8, 8) = blk;
+    ASSERT_LE((Eigen::MatrixXd{Y} - Y_true).norm(), 1e-10);
+
+    // projection of a matrix with a different structure
+    SpMat Z = 0.5 * precision_sp;
+    Z.prune(1e-12);
+    eigen_wrapper.sp_project(Z, Y);
+    ASSERT_TRUE(eigen_wrapper.sp_same_pattern(Y, precision_sp));
+    ASSERT_LE((Eigen::MatrixXd{Y} - 0.5 * precision).norm(), 1e-10);
+
+    // sparse inverse written into the fixed pattern
+    SparseLDLT ldlt_sp(precision_sp);
+    SpMat Lsp = ldlt_sp.matrixL();
+    Eigen::VectorXi I, J;
+    Eigen::VectorXd V;
+    eigen_wrapper.find_nnz(Lsp, I, J, V);
+    Eigen::VectorXd Dinv = ldlt_sp.vectorD().real().cwiseInverse();
+
+    SpMat inv_fixed;
+    eigen_wrapper.sp_shape_as(Lsp + SpMat(Lsp.transpose()), inv_fixed);
+    eigen_wrapper.inv_sparse_fixed_pattern(inv_fixed, I, J, V, Dinv);
+
+    SpMat inv_ref(size, size);
+    eigen_wrapper.inv_sparse(precision_sp, inv_ref, I, J, V, Dinv);
+    ASSERT_TRUE(eigen_wrapper.matrix_equal(Eigen::MatrixXd{inv_fixed}, Eigen::MatrixXd{inv_ref}));
+}
+
+/**
+ * @brief Test the sparse inverse under the AMD ordering through the permuted slot maps.
+ */
+TEST(TestSparse, permuted_sparse_inverse){
+    Eigen::MatrixXd precision = m_io.load_csv("data/precision_large.csv");
+    SpMat precision_sp = precision.sparseView();
+    precision_sp.makeCompressed();
+
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> P_inv;
+    Eigen::AMDOrdering<int> amd;
+    amd(precision_sp, P_inv);
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> P = P_inv.inverse();
+
+    // move the values into the permuted pattern
+    SpMat prec_perm;
+    prec_perm = precision_sp.twistedBy(P);
+    SpMat prec_perm_true = prec_perm;
+    eigen_wrapper.sp_values(prec_perm).setZero();
+    Eigen::VectorXi perm_slots = eigen_wrapper.sp_slot_map(prec_perm, precision_sp, P.indices());
+    eigen_wrapper.sp_scatter(precision_sp, perm_slots, prec_perm);
+    ASSERT_TRUE(eigen_wrapper.matrix_equal(Eigen::MatrixXd{prec_perm}, Eigen::MatrixXd{prec_perm_true}));
+
+    // inverse in the permuted coordinates, gathered back into the original pattern
+    SparseLDLT ldlt_sp(prec_perm);
+    SpMat L = ldlt_sp.matrixL();
+    SpMat L_sym = L + SpMat(L.transpose());
+    SpMat lower = L_sym.triangularView<Eigen::Lower>();
+    Eigen::VectorXi I, J;
+    Eigen::VectorXd V;
+    eigen_wrapper.find_nnz(lower, I, J, V);
+    eigen_wrapper.find_nnz_known_ij(L, I, J, V);
+
+    SpMat cov_perm;
+    eigen_wrapper.sp_shape_as(L_sym, cov_perm);
+    eigen_wrapper.inv_sparse_fixed_pattern(cov_perm, I, J, V, ldlt_sp.vectorD().real().cwiseInverse());
+
+    SpMat cov;
+    eigen_wrapper.sp_shape_as(precision_sp, cov);
+    Eigen::VectorXi cov_slots = eigen_wrapper.sp_slot_map(cov_perm, precision_sp, P.indices());
+    eigen_wrapper.sp_gather(cov_perm, cov_slots, cov);
+
+    Eigen::MatrixXd cov_full = precision.inverse();
+    for (int k=0; k<cov.outerSize(); k++){
+        for (SpMat::InnerIterator it(cov, k); it; ++it){
+            ASSERT_LE(std::abs(it.value() - cov_full(it.row(), it.col())), 1e-8);
+        }
+    }
+}
+
+/**
+ * @brief Test the blocks over non-adjacent states.
+ */
+TEST(TestSparse, trajectory_block_scope){
+    int state_dim = 2, num_states = 5;
+    TrajectoryBlock block{state_dim, num_states, std::vector<int>{0, 1, 4}};
+    ASSERT_FALSE(block.is_contiguous());
+    ASSERT_EQ(block.segments().size(), 2);
+
+    Eigen::VectorXd joint = Eigen::VectorXd::LinSpaced(10, 0, 9);
+    Eigen::VectorXd marginal(6);
+    marginal << 0, 1, 2, 3, 8, 9;
+    ASSERT_LE((block.extract_vector(joint) - marginal).norm(), 1e-10);
+
+    Eigen::MatrixXd joint_m = eigen_wrapper.random_matrix(10, 10);
+    SpMat joint_sp = joint_m.sparseView();
+    Eigen::MatrixXd marginal_m{block.extract(joint_sp)};
+    ASSERT_LE((marginal_m.block(0, 4, 4, 2) - joint_m.block(0, 8, 4, 2)).norm(), 1e-10);
+
+    SpMat filled(10, 10);
+    block.fill(marginal_m, filled);
+    ASSERT_LE((Eigen::MatrixXd{filled}.block(8, 0, 2, 4) - joint_m.block(8, 0, 2, 4)).norm(), 1e-10);
+    ASSERT_LE(Eigen::MatrixXd{filled}.block(4, 0, 4, 10).norm(), 1e-10);
+}
+
 TEST(TestSparse, sparse_view){
     int size = 10;
     int nnz = 20;
@@ -489,6 +614,41 @@ TEST(TestMatrix3D, repmat){
     }
 }
 
+TEST(TestMatrix3D, slice_views){
+    Matrix3D mat3d(3, 2, 4);
+    mat3d.setRandom();
+    ASSERT_EQ(mat3d.slice_rows(), 3);
+    ASSERT_EQ(mat3d.slice_cols(), 2);
+
+    // the views read and write the storage of the time step
+    for (int i=0; i<4; i++){
+        ASSERT_LE((mat3d.slice(i) - eigen_wrapper.decomp3d(mat3d, 3, 2, i)).norm(), 1e-10);
+    }
+    Eigen::MatrixXd mat_i = Eigen::MatrixXd::Random(3, 2);
+    mat3d.slice(2) = mat_i;
+    ASSERT_EQ(mat3d(4, 2), mat_i(1, 1));
+    mat3d.slice(1, 6, 1).setZero();
+    ASSERT_EQ(mat3d.col(1).norm(), 0.0);
+
+    // the copies keep the shape, the (m*n, nt) matrices do not know it
+    Matrix3D copied{mat3d};
+    ASSERT_EQ(copied.slice(2), mat_i);
+    Matrix3D unshaped{Eigen::MatrixXd::Zero(6, 4)};
+    ASSERT_THROW(unshaped.slice(0), std::runtime_error);
+    ASSERT_EQ(eigen_wrapper.replicate3d(mat_i, 3).slice(2), mat_i);
+
+    // assigning a plain matrix drops the shape, even of the same size
+    copied = Eigen::MatrixXd::Zero(6, 4);
+    ASSERT_EQ(copied.slice_rows(), 0);
+    ASSERT_THROW(copied.slice(0), std::runtime_error);
+    copied = mat3d;
+    ASSERT_EQ(copied.slice(2), mat_i);
+
+    Matrix3D transposed = eigen_wrapper.transpose3d(mat3d, 3, 2);
+    ASSERT_EQ(transposed.slice_rows(), 2);
+    ASSERT_EQ(transposed.slice(2), mat_i.transpose());
+}
+
 TEST(TestMatrix3D, linspace){
     int nt = 5;
     Eigen::VectorXd x0(4), xT(4);
@@ -0,0 +1,97 @@
+/**
+ * @file test_incremental_sdf.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Test the local updates of the incremental sdf against the full sdf generation.
+ * @version 0.1
+ * @date 2023-09-15
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "helpers/IncrementalSDF.h"
+#include <gtest/gtest.h>
+
+using namespace vimp;
+using namespace Eigen;
+
+/// the changed cells are all in the reported region
+void check_update(const std::vector<MatrixXd>& before, const IncrementalSDF& incremental,
+                  const std::vector<MatrixXd>& occupancy, const SDFRegion& region){
+    std::vector<MatrixXd> expected = SDFGenerator(0.75, 1).signed_distance_field(occupancy, incremental.cell_size());
+    for (int k=0; k<incremental.layers(); k++){
+        ASSERT_EQ((incremental.field()[k] - expected[k]).cwiseAbs().maxCoeff(), 0.0);
+        for (int c=0; c<incremental.cols(); c++){
+            for (int r=0; r<incremental.rows(); r++){
+                if (before[k](r, c) != expected[k](r, c)){
+                    ASSERT_TRUE(r >= region.row_begin && r < region.row_end && c >= region.col_begin && c < region.col_end &&
+                                k >= region.layer_begin && k < region.layer_end);
+                }
+            }
+        }
+    }
+}
+
+TEST(IncrementalSDF, moving_box_3d){
+    std::vector<MatrixXd> occupancy(14, MatrixXd::Zero(20, 24));
+    for (int k=3; k<6; k++){
+        occupancy[k].block(4, 5, 3, 4).setOnes();
+        occupancy[k].block(12, 15, 5, 2).setOnes();
+    }
+    Vector3d origin{-0.5, 0.2, 0.0};
+    IncrementalSDF incremental{occupancy, origin, 0.05, 0.75, 3};
+    std::vector<MatrixXd> expected = SDFGenerator().signed_distance_field(occupancy, 0.05);
+    for (int k=0; k<14; k++){
+        ASSERT_EQ((incremental.field()[k] - expected[k]).cwiseAbs().maxCoeff(), 0.0);
+    }
+
+    // move the first box along x by one cell at a time, from its initial place
+    for (int step=1; step<6; step++){
+        std::vector<MatrixXd> block(3, MatrixXd::Zero(3, 10));
+        for (MatrixXd& layer : block){
+            layer.block(0, step + 1, 3, 4).setOnes();
+        }
+        std::vector<MatrixXd> before = incremental.field();
+        SDFRegion region = incremental.update_occupancy(4, 4, 3, block);
+        for (int k=3; k<6; k++){
+            occupancy[k].block(4, 4, 3, 10) = block[k-3];
+        }
+        ASSERT_FALSE(region.empty());
+        check_update(before, incremental, occupancy, region);
+    }
+
+    // the same occupancy changes nothing
+    ASSERT_TRUE(incremental.update_occupancy(0, 0, 0, std::vector<MatrixXd>(2, MatrixXd::Zero(2, 2))).empty());
+}
+
+TEST(IncrementalSDF, planar_add_remove){
+    MatrixXd occupancy = MatrixXd::Zero(30, 40);
+    IncrementalSDF incremental{std::vector<MatrixXd>{occupancy}, Vector2d{0.0, 0.0}, 0.1};
+    ASSERT_EQ(incremental.field()[0](3, 3), SDFGenerator::NO_FEATURE_DISTANCE);
+
+    // the first obstacle changes the whole field
+    SDFRegion region = incremental.update_occupancy(10, 12, MatrixXd::Ones(2, 3));
+    occupancy.block(10, 12, 2, 3).setOnes();
+    ASSERT_EQ(region.row_end - region.row_begin, 30);
+    check_update(std::vector<MatrixXd>{MatrixXd::Constant(30, 40, SDFGenerator::NO_FEATURE_DISTANCE)},
+                 incremental, std::vector<MatrixXd>{occupancy}, region);
+
+    // a second obstacle far away only changes the cells closer to it than to the first one
+    std::vector<MatrixXd> before = incremental.field();
+    region = incremental.update_occupancy(25, 35, MatrixXd::Ones(3, 3));
+    occupancy.block(25, 35, 3, 3).setOnes();
+    ASSERT_GT(region.col_begin, 14);
+    check_update(before, incremental, std::vector<MatrixXd>{occupancy}, region);
+
+    // removing it restores the field
+    before = incremental.field();
+    region = incremental.update_occupancy(25, 35, MatrixXd::Zero(3, 3));
+    occupancy.block(25, 35, 3, 3).setZero();
+    check_update(before, incremental, std::vector<MatrixXd>{occupancy}, region);
+
+    // the workspace box of the region, grown by one cell
+    AlignedBox3d box = incremental.region_box(region);
+    ASSERT_NEAR(box.min()(0), (region.col_begin - 1) * 0.1, 1e-12);
+    ASSERT_NEAR(box.max()(1), region.row_end * 0.1, 1e-12);
+    ASSERT_TRUE(box.contains(Vector3d{3.6, 2.6, 5.0}));
+}
@@ -10,6 +10,7 @@
  */
 
 #include "helpers/MatrixIO.h"
+#include "helpers/SDFFile.h"
 #include <gtest/gtest.h>
 
 using namespace vimp;
@@ -47,3 +48,34 @@ TEST(SDFReader, read_write){
     ASSERT_LE((m - m_read).norm(), 1e-10);
 }
 
+
+TEST(SDFReader, binary_sdf_file){
+    MatrixXd layer_0 = MatrixXd::Random(30, 40);
+    MatrixXd layer_1 = MatrixXd::Random(30, 40);
+    VectorXd origin(3);
+    origin << -1.0, 0.5, 2.0;
+
+    std::string file{"/tmp/vimp_test_sdf.sdfb"};
+    write_sdf_file(file, origin, 0.05, std::vector<MatrixXd>{layer_0, layer_1});
+    ASSERT_TRUE(is_sdf_file(file));
+
+    MappedSDFFile mapped{file};
+    ASSERT_EQ(mapped.dimension(), 3);
+    ASSERT_EQ(mapped.rows(), 30);
+    ASSERT_EQ(mapped.cols(), 40);
+    ASSERT_EQ(mapped.layers(), 2);
+    ASSERT_EQ(mapped.cell_size(), 0.05);
+    ASSERT_EQ((mapped.origin() - origin).norm(), 0);
+    ASSERT_EQ((mapped.layer_view(0) - layer_0).norm(), 0);
+    ASSERT_EQ((mapped.layer(1) - layer_1).norm(), 0);
+
+    // float32 grid
+    write_sdf_file(file, origin.head(2), 0.05, std::vector<MatrixXd>{layer_0}, true);
+    mapped.open(file);
+    ASSERT_TRUE(mapped.single_precision());
+    ASSERT_EQ(mapped.dimension(), 2);
+    ASSERT_LE((mapped.layer(0) - layer_0).cwiseAbs().maxCoeff(), 1e-6);
+
+    // a csv file is not a binary sdf
+    ASSERT_FALSE(is_sdf_file("data/map_ground_truth.csv"));
+}
@@ -0,0 +1,143 @@
+/**
+ * @file test_sdf_batch.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Test the batch sdf queries against the point-wise interpolation of gpmp2.
+ * @version 0.1
+ * @date 2023-09-11
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "helpers/SDFBatch.h"
+#include <gtest/gtest.h>
+
+using namespace vimp;
+using namespace Eigen;
+
+/// gpmp2::PlanarSDF::getSignedDistance(point, gradient)
+double planar_sdf_reference(const MatrixXd& field, const Vector2d& origin, double cell_size, const Vector2d& point, Vector2d& grad){
+    double c = (point(0) - origin(0)) / cell_size, r = (point(1) - origin(1)) / cell_size;
+    double lr = std::floor(r), lc = std::floor(c), hr = lr + 1.0, hc = lc + 1.0;
+    int lri = lr, lci = lc, hri = hr, hci = hc;
+    grad(0) = ((hr-r)*(field(lri, hci)-field(lri, lci)) + (r-lr)*(field(hri, hci)-field(hri, lci))) / cell_size;
+    grad(1) = ((hc-c)*(field(hri, lci)-field(lri, lci)) + (c-lc)*(field(hri, hci)-field(lri, hci))) / cell_size;
+    return (hr-r)*(hc-c)*field(lri, lci) + (r-lr)*(hc-c)*field(hri, lci) +
+           (hr-r)*(c-lc)*field(lri, hci) + (r-lr)*(c-lc)*field(hri, hci);
+}
+
+/// gpmp2::SignedDistanceField::getSignedDistance(point, gradient)
+double sdf_reference(const std::vector<MatrixXd>& field, const Vector3d& origin, double cell_size, const Vector3d& point, Vector3d& grad){
+    double c = (point(0) - origin(0)) / cell_size, r = (point(1) - origin(1)) / cell_size, z = (point(2) - origin(2)) / cell_size;
+    int lr = std::floor(r), lc = std::floor(c), lz = std::floor(z);
+    double d = 0.0;
+    grad.setZero();
+    for (int dr=0; dr<2; dr++){
+        for (int dc=0; dc<2; dc++){
+            for (int dz=0; dz<2; dz++){
+                double wr = dr ? r-lr : lr+1-r, wc = dc ? c-lc : lc+1-c, wz = dz ? z-lz : lz+1-z;
+                double v = field[lz+dz](lr+dr, lc+dc);
+                d += wr*wc*wz*v;
+                grad(0) += (dc ? 1.0 : -1.0)*wr*wz*v / cell_size;
+                grad(1) += (dr ? 1.0 : -1.0)*wc*wz*v / cell_size;
+                grad(2) += (dz ? 1.0 : -1.0)*wr*wc*v / cell_size;
+            }
+        }
+    }
+    return d;
+}
+
+TEST(SDFBatch, planar){
+    MatrixXd field = MatrixXd::Random(50, 70);
+    Vector2d origin{-1.0, -0.5};
+    double cell_size = 0.1;
+    BatchSDF sdf{origin, cell_size, std::vector<MatrixXd>{field}};
+
+    // an odd number of points to cover the scalar tail of the vectorized kernel,
+    // the last 3 points on the upper boundaries and out of the grid
+    int n = 103;
+    MatrixXd points = (MatrixXd::Random(2, n).array() + 1.0) / 2.0;
+    points.row(0) = points.row(0) * 6.9 + origin(0) * RowVectorXd::Ones(n);
+    points.row(1) = points.row(1) * 4.9 + origin(1) * RowVectorXd::Ones(n);
+    points.col(n-3) << origin(0) + 6.9, origin(1) + 4.9;
+    points.col(n-2) << origin(0) - 0.01, 0.0;
+    points.col(n-1) << 0.0, origin(1) + 5.0;
+
+    VectorXd distances;
+    MatrixXd gradients;
+    sdf.signed_distance(points, distances, gradients);
+
+    VectorXd distances_only;
+    sdf.signed_distance(points, distances_only);
+    ASSERT_EQ((distances - distances_only).cwiseAbs().maxCoeff(), 0.0);
+
+    for (int j=0; j<n-3; j++){
+        Vector2d grad;
+        double d = planar_sdf_reference(field, origin, cell_size, points.col(j), grad);
+        ASSERT_NEAR(distances(j), d, 1e-12);
+        ASSERT_LE((gradients.col(j) - grad).norm(), 1e-10);
+    }
+
+    ASSERT_NEAR(distances(n-3), field(49, 69), 1e-12);
+    ASSERT_TRUE(std::isinf(distances(n-2)) && std::isinf(distances(n-1)));
+    ASSERT_EQ(gradients.col(n-2).norm(), 0.0);
+    ASSERT_EQ(gradients.col(n-1).norm(), 0.0);
+}
+
+TEST(SDFBatch, trilinear){
+    std::vector<MatrixXd> field;
+    for (int k=0; k<12; k++){
+        field.emplace_back(MatrixXd::Random(20, 30));
+    }
+    Vector3d origin{0.5, -1.0, 0.2};
+    double cell_size = 0.05;
+    BatchSDF sdf{origin, cell_size, field};
+
+    int n = 57;
+    MatrixXd points = (MatrixXd::Random(3, n).array() + 1.0) / 2.0;
+    points.row(0) = points.row(0) * 1.45 + origin(0) * RowVectorXd::Ones(n);
+    points.row(1) = points.row(1) * 0.95 + origin(1) * RowVectorXd::Ones(n);
+    points.row(2) = points.row(2) * 0.55 + origin(2) * RowVectorXd::Ones(n);
+    points.col(n-1) << origin(0), origin(1), origin(2) - 0.1;
+
+    VectorXd distances;
+    MatrixXd gradients;
+    sdf.signed_distance(points, distances, gradients);
+
+    for (int j=0; j<n-1; j++){
+        Vector3d grad;
+        double d = sdf_reference(field, origin, cell_size, points.col(j), grad);
+        ASSERT_NEAR(distances(j), d, 1e-12);
+        ASSERT_LE((gradients.col(j) - grad).norm(), 1e-10);
+    }
+    ASSERT_TRUE(std::isinf(distances(n-1)));
+}
+
+TEST(SDFBatch, hinge_loss){
+    // distance to the line x = 0
+    MatrixXd field(10, 10);
+    for (int i=0; i<10; i++){
+        field.col(i).setConstant(i * 0.1);
+    }
+    BatchSDF sdf{Vector2d{0.0, 0.0}, 0.1, std::vector<MatrixXd>{field}};
+
+    MatrixXd points(2, 5);
+    points << 0.05, 0.2, 0.5, 0.8, 2.0,
+              0.5,  0.5, 0.5, 0.5, 0.5;
+    VectorXd eps = VectorXd::Constant(5, 0.3);
+
+    VectorXd hinge;
+    MatrixXd gradients;
+    sdf.hinge_loss(points, eps, hinge, gradients);
+
+    VectorXd hinge_expected(5);
+    hinge_expected << 0.25, 0.1, 0.0, 0.0, 0.0;
+    ASSERT_LE((hinge - hinge_expected).norm(), 1e-12);
+    ASSERT_LE((gradients.col(0) - Vector2d{-1.0, 0.0}).norm(), 1e-12);
+    ASSERT_LE((gradients.col(1) - Vector2d{-1.0, 0.0}).norm(), 1e-12);
+    ASSERT_EQ(gradients.rightCols(3).norm(), 0.0);
+
+    VectorXd hinge_only;
+    sdf.hinge_loss(points, eps, hinge_only);
+    ASSERT_LE((hinge - hinge_only).norm(), 1e-15);
+}
@@ -0,0 +1,134 @@
+/**
+ * @file test_sdf_block_grid.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Test the two-level block sdf against the flat batch sdf.
+ * @version 0.1
+ * @date 2023-09-13
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "helpers/SDFBatch.h"
+#include "helpers/SDFBlockGrid.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+
+using namespace vimp;
+using namespace Eigen;
+
+/// the distance field of 2 balls in a box workspace, (rows: y, cols: x, layers: z)
+std::vector<MatrixXd> balls_field(const Vector3d& origin, double cell_size, int rows, int cols, int layers){
+    Vector3d c1{0.6, 0.5, 0.4}, c2{1.3, 0.9, 0.8};
+    double r1 = 0.2, r2 = 0.15;
+    std::vector<MatrixXd> field(layers, MatrixXd(rows, cols));
+    for (int k=0; k<layers; k++){
+        for (int i=0; i<rows; i++){
+            for (int j=0; j<cols; j++){
+                Vector3d p = origin + cell_size * Vector3d(j, i, k);
+                field[k](i, j) = std::min((p - c1).norm() - r1, (p - c2).norm() - r2);
+            }
+        }
+    }
+    return field;
+}
+
+TEST(BlockSDF, trilinear){
+    Vector3d origin{0.0, 0.0, 0.0};
+    double cell_size = 0.02;
+    std::vector<MatrixXd> field = balls_field(origin, cell_size, 61, 83, 57);
+    BatchSDF flat{origin, cell_size, field};
+    double band = 0.15;
+    BlockSDF blocks{origin, cell_size, field, band};
+
+    // most of the workspace is far from the balls
+    ASSERT_GT(blocks.n_fine_blocks(), 0);
+    ASSERT_LT(blocks.n_fine_blocks(), blocks.n_blocks() / 2);
+    ASSERT_LT(blocks.memory_bytes(), 61*83*57*sizeof(double) / 2);
+
+    int n = 2000;
+    MatrixXd points = (MatrixXd::Random(3, n).array() + 1.0) / 2.0;
+    points.row(0) *= 82 * cell_size;
+    points.row(1) *= 60 * cell_size;
+    points.row(2) *= 56 * cell_size;
+    // the upper boundaries, and out of the grid
+    points.col(n-2) << 82 * cell_size, 60 * cell_size, 56 * cell_size;
+    points.col(n-1) << -0.01, 0.5, 0.5;
+
+    VectorXd d_flat, d_blocks;
+    MatrixXd g_flat, g_blocks;
+    flat.signed_distance(points, d_flat, g_flat);
+    blocks.signed_distance(points, d_blocks, g_blocks);
+
+    int n_fine = 0;
+    for (int j=0; j<n-1; j++){
+        if (g_blocks.col(j).norm() > 0.0){
+            // fine block: the interpolation of the flat grid
+            n_fine++;
+            ASSERT_EQ(d_blocks(j), d_flat(j));
+            ASSERT_EQ((g_blocks.col(j) - g_flat.col(j)).norm(), 0.0);
+        }else{
+            // coarse block: a lower bound beyond the band
+            ASSERT_LE(d_blocks(j), d_flat(j));
+            ASSERT_GT(d_blocks(j), band);
+        }
+    }
+    ASSERT_GT(n_fine, 0);
+    ASSERT_TRUE(std::isinf(d_blocks(n-1)));
+
+    // exact hinge losses within the band
+    VectorXd eps = VectorXd::Constant(n, band);
+    VectorXd h_flat, h_blocks;
+    MatrixXd hg_flat, hg_blocks;
+    flat.hinge_loss(points, eps, h_flat, hg_flat);
+    blocks.hinge_loss(points, eps, h_blocks, hg_blocks);
+    ASSERT_EQ((h_flat - h_blocks).norm(), 0.0);
+    ASSERT_EQ((hg_flat - hg_blocks).norm(), 0.0);
+    ASSERT_GT(h_flat.norm(), 0.0);
+
+    ASSERT_THROW(blocks.hinge_loss(points, VectorXd::Constant(n, 2.0*band), h_blocks), std::runtime_error);
+}
+
+TEST(BlockSDF, planar){
+    Vector2d origin{-1.0, -0.5};
+    double cell_size = 0.1;
+    MatrixXd field = MatrixXd::Random(37, 45).array() + 1.0;
+    field.block(10, 20, 3, 3).setConstant(-0.2);
+    BatchSDF flat{origin, cell_size, std::vector<MatrixXd>{field}};
+    BlockSDF blocks{origin, cell_size, std::vector<MatrixXd>{field}, 0.5, 4};
+
+    int n = 500;
+    MatrixXd points = (MatrixXd::Random(2, n).array() + 1.0) / 2.0;
+    points.row(0) = points.row(0) * 4.4 + origin(0) * RowVectorXd::Ones(n);
+    points.row(1) = points.row(1) * 3.6 + origin(1) * RowVectorXd::Ones(n);
+
+    VectorXd d_flat, d_blocks;
+    flat.signed_distance(points, d_flat);
+    blocks.signed_distance(points, d_blocks);
+    for (int j=0; j<n; j++){
+        ASSERT_LE(d_blocks(j), d_flat(j));
+        ASSERT_TRUE(d_blocks(j) == d_flat(j) || d_blocks(j) > 0.5);
+    }
+}
+
+TEST(BlockSDF, mapped_file){
+    Vector3d origin{0.0, 0.0, 0.0};
+    double cell_size = 0.05;
+    std::vector<MatrixXd> field = balls_field(origin, cell_size, 30, 40, 25);
+    std::string path = "test_sdf_block_grid.sdfb";
+    write_sdf_file(path, origin, cell_size, field);
+
+    BlockSDF from_layers{origin, cell_size, field, 0.1};
+    MappedSDFFile mapped{path};
+    BlockSDF from_file{mapped, 0.1};
+    ASSERT_EQ(from_file.n_fine_blocks(), from_layers.n_fine_blocks());
+
+    MatrixXd points = (MatrixXd::Random(3, 300).array() + 1.0) * 0.6;
+    VectorXd d_layers, d_file;
+    from_layers.signed_distance(points, d_layers);
+    from_file.signed_distance(points, d_file);
+    ASSERT_EQ((d_layers - d_file).norm(), 0.0);
+
+    mapped.close();
+    std::remove(path.c_str());
+}
@@ -0,0 +1,121 @@
+/**
+ * @file test_sdf_compact.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Test the float32 compact sdf against the double batch sdf on the shipped maps.
+ * @version 0.1
+ * @date 2023-09-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "helpers/MatrixIO.h"
+#include "helpers/SDFBatch.h"
+#include "helpers/SDFCompact.h"
+#include "helpers/SDFGenerator.h"
+#include <gtest/gtest.h>
+
+#define STRING(x) #x
+#define XSTRING(x) STRING(x)
+std::string source_root{XSTRING(SOURCE_ROOT)};
+
+using namespace vimp;
+using namespace Eigen;
+
+/// random points covering the grid, the last ones on the upper boundaries and out of the grid
+MatrixXd grid_points(const BatchSDF& sdf, int n){
+    Vector3d grid_extent{(sdf.cols() - 1) * sdf.cell_size(), (sdf.rows() - 1) * sdf.cell_size(), (sdf.layers() - 1) * sdf.cell_size()};
+    VectorXd extent = grid_extent.head(sdf.dimension());
+    MatrixXd points = (MatrixXd::Random(sdf.dimension(), n).array() + 1.0) / 2.0;
+    for (int j=0; j<n; j++){
+        points.col(j) = sdf.origin() + points.col(j).cwiseProduct(extent);
+    }
+    points.col(n-2) = sdf.origin() + extent;
+    points.col(n-1) = sdf.origin() - 0.5 * extent;
+    return points;
+}
+
+/**
+ * The distances within the float rounding of the samples. With the stored gradients the forward differences
+ * are rounded, otherwise the differences of the rounded samples, divided by the cell size.
+ */
+void check_tolerance(const BatchSDF& flat, const CompactSDF& compact, double max_distance){
+    int n = 4003;
+    MatrixXd points = grid_points(flat, n);
+    VectorXd d_flat, d_compact;
+    MatrixXd g_flat, g_compact;
+    flat.signed_distance(points, d_flat, g_flat);
+    compact.signed_distance(points, d_compact, g_compact);
+
+    const double eps = std::numeric_limits<float>::epsilon();
+    for (int j=0; j<n-1; j++){
+        if (std::isinf(d_flat(j))){
+            // the upper boundary rounded out of the grid
+            ASSERT_TRUE(std::isinf(d_compact(j)));
+            continue;
+        }
+        ASSERT_LE(std::abs(d_compact(j) - d_flat(j)), eps * max_distance);
+        double g_tol = compact.has_gradients() ? eps * (1.0 + g_flat.col(j).lpNorm<Infinity>())
+                                               : 4.0 * eps * max_distance / flat.cell_size();
+        ASSERT_LE((g_compact.col(j) - g_flat.col(j)).lpNorm<Infinity>(), g_tol);
+    }
+    ASSERT_TRUE(std::isinf(d_compact(n-1)));
+    ASSERT_EQ(g_compact.col(n-1).norm(), 0.0);
+
+    // hinge losses, without gradients
+    VectorXd eps_hinge = VectorXd::Constant(n, 0.2), h_flat, h_compact;
+    flat.hinge_loss(points, eps_hinge, h_flat);
+    compact.hinge_loss(points, eps_hinge, h_compact);
+    for (int j=0; j<n; j++){
+        ASSERT_LE(std::abs(h_compact(j) - h_flat(j)), eps * max_distance);
+    }
+}
+
+TEST(CompactSDF, shipped_planar_maps){
+    // the field files and their origins and cell sizes in the SDFRegistry
+    std::vector<std::tuple<std::string, Vector2d, double>> maps{
+        {"/maps/2dpR/map0/field_multiobs_map0.csv", Vector2d{-1.0, -1.0}, 0.01},
+        {"/maps/2dpR/map1/field_multiobs_map1.csv", Vector2d{-20.0, -10.0}, 0.1},
+        {"/maps/2dpR/map2/field_multiobs_map2.csv", Vector2d{-20.0, -10.0}, 0.1},
+        {"/maps/2dpR/map3/field_multiobs_map3.csv", Vector2d{-20.0, -10.0}, 0.1},
+        {"/maps/2dArm/field_one_obs.csv", Vector2d{-1.0, -1.0}, 0.01},
+        {"/maps/2dArm/field_two_obs.csv", Vector2d{-1.0, -1.0}, 0.01},
+        {"/maps/3dArm/field_one_obs.csv", Vector2d{-1.0, -1.0}, 0.01},
+        {"/maps/3dArm/field_two_obs.csv", Vector2d{-1.0, -1.0}, 0.01}};
+
+    MatrixIO m_io;
+    for (const auto& map : maps){
+        std::vector<MatrixXd> field{m_io.load_csv(source_root + std::get<0>(map))};
+        BatchSDF flat{std::get<1>(map), std::get<2>(map), field};
+        CompactSDF compact{std::get<1>(map), std::get<2>(map), field, true};
+        CompactSDF compact_distances{std::get<1>(map), std::get<2>(map), field};
+        ASSERT_EQ(compact.memory_bytes(), field[0].size() * 4 * sizeof(float));
+        ASSERT_EQ(compact_distances.memory_bytes(), field[0].size() * sizeof(double) / 2);
+
+        double max_distance = field[0].cwiseAbs().maxCoeff();
+        check_tolerance(flat, compact, max_distance);
+        check_tolerance(flat, compact_distances, max_distance);
+    }
+}
+
+TEST(CompactSDF, field_3d){
+    // the 3D maps are not shipped as grids, generate one from an occupancy map
+    std::vector<MatrixXd> occupancy(37, MatrixXd::Zero(41, 53));
+    for (int k=5; k<20; k++){
+        occupancy[k].block(10, 12, 8, 15).setOnes();
+        occupancy[k+10].block(25, 30, 6, 9).setOnes();
+    }
+    double cell_size = 0.05;
+    std::vector<MatrixXd> field = SDFGenerator().signed_distance_field(occupancy, cell_size);
+    Vector3d origin{-1.0, -0.6, 0.2};
+
+    BatchSDF flat{origin, cell_size, field};
+    CompactSDF compact{origin, cell_size, field, true};
+    CompactSDF compact_distances{origin, cell_size, field};
+    double max_distance = 0.0;
+    for (const MatrixXd& layer : field){
+        max_distance = std::max(max_distance, layer.cwiseAbs().maxCoeff());
+    }
+    check_tolerance(flat, compact, max_distance);
+    check_tolerance(flat, compact_distances, max_distance);
+}
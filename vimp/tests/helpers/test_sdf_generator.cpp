@@ -0,0 +1,83 @@
+/**
+ * @file test_sdf_generator.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Test the signed distance fields of occupancy grids against brute force distances.
+ * @version 0.1
+ * @date 2023-09-14
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "helpers/SDFGenerator.h"
+#include <gtest/gtest.h>
+
+using namespace vimp;
+using namespace Eigen;
+
+/// signedDistanceField3D.m with brute force distances, in the gpmp2 layout
+std::vector<MatrixXd> brute_force_field(const std::vector<MatrixXd>& occupancy, double cell_size){
+    int rows = occupancy[0].rows(), cols = occupancy[0].cols(), layers = occupancy.size();
+    std::vector<MatrixXd> field(layers, MatrixXd(rows, cols));
+    for (int k=0; k<layers; k++){
+        for (int i=0; i<rows; i++){
+            for (int j=0; j<cols; j++){
+                bool obstacle = occupancy[k](i, j) > 0.75;
+                double to_obstacle = obstacle ? 0.0 : 1e20, to_free = obstacle ? 1e20 : 0.0;
+                for (int kk=0; kk<layers; kk++){
+                    for (int ii=0; ii<rows; ii++){
+                        for (int jj=0; jj<cols; jj++){
+                            double dist = std::sqrt((i-ii)*(i-ii) + (j-jj)*(j-jj) + (k-kk)*(k-kk));
+                            if (occupancy[kk](ii, jj) > 0.75){
+                                to_obstacle = std::min(to_obstacle, dist);
+                            }else{
+                                to_free = std::min(to_free, dist);
+                            }
+                        }
+                    }
+                }
+                field[k](i, j) = (to_obstacle - to_free) * cell_size;
+            }
+        }
+    }
+    return field;
+}
+
+TEST(SDFGenerator, planar){
+    MatrixXd occupancy = MatrixXd::Zero(23, 31);
+    occupancy.block(3, 4, 5, 6).setOnes();
+    occupancy.block(15, 20, 4, 9).setOnes();
+    occupancy(20, 2) = 0.9;
+    occupancy(0, 30) = 0.5;
+
+    SDFGenerator generator;
+    MatrixXd field = generator.signed_distance_field(occupancy, 0.1);
+    MatrixXd expected = brute_force_field(std::vector<MatrixXd>{occupancy}, 0.1)[0];
+    ASSERT_LE((field - expected).cwiseAbs().maxCoeff(), 1e-12);
+
+    // inside the obstacles, negative distance to the free space
+    ASSERT_NEAR(field(5, 6), -0.3, 1e-12);
+    ASSERT_NEAR(field(10, 6), 0.3, 1e-12);
+}
+
+TEST(SDFGenerator, field_3d_threads){
+    std::vector<MatrixXd> occupancy;
+    for (int k=0; k<9; k++){
+        occupancy.emplace_back((MatrixXd::Random(11, 13).array() > 0.8).cast<double>());
+    }
+    std::vector<MatrixXd> expected = brute_force_field(occupancy, 0.05);
+
+    std::vector<MatrixXd> field_1 = SDFGenerator(0.75, 1).signed_distance_field(occupancy, 0.05);
+    std::vector<MatrixXd> field_4 = SDFGenerator(0.75, 4).signed_distance_field(occupancy, 0.05);
+    ASSERT_EQ(field_1.size(), 9);
+    for (int k=0; k<9; k++){
+        ASSERT_LE((field_1[k] - expected[k]).cwiseAbs().maxCoeff(), 1e-12);
+        ASSERT_EQ((field_1[k] - field_4[k]).cwiseAbs().maxCoeff(), 0.0);
+    }
+}
+
+TEST(SDFGenerator, no_obstacle){
+    SDFGenerator generator;
+    MatrixXd field = generator.signed_distance_field(MatrixXd::Zero(5, 7), 0.1);
+    ASSERT_EQ((field.array() - SDFGenerator::NO_FEATURE_DISTANCE).abs().maxCoeff(), 0.0);
+}
@@ -94,6 +94,68 @@ TEST(LinearCS, initializations){
 }
 
 
+TEST(LinearCS, threaded_transition){
+    // the pieces of the horizon integrated in parallel agree with the sequential integration
+    EigenWrapper eigen_wrapper;
+    int nx = 4, nu = 2, nt = 1200;
+    MatrixXd A{MatrixXd::Zero(nx, nx)}, B{MatrixXd::Zero(nx, nu)};
+    A.block(0, 2, 2, 2) = MatrixXd::Identity(2, 2);
+    B.block(2, 0, 2, 2) = MatrixXd::Identity(2, 2);
+    Matrix3D At = eigen_wrapper.replicate3d(A, nt), Bt = eigen_wrapper.replicate3d(B, nt);
+    Matrix3D at(nx, 1, nt), Qt = eigen_wrapper.replicate3d(MatrixXd::Identity(nx, nx), nt), rt(nx, 1, nt);
+    at.setZero();
+    rt.setConstant(0.1);
+    VectorXd m0{VectorXd::Zero(nx)}, m1{VectorXd::Ones(nx)};
+    MatrixXd Sig0{0.01*MatrixXd::Identity(nx, nx)}, Sig1{0.005*MatrixXd::Identity(nx, nx)};
+
+    LinearCovarianceSteering sequential(At, Bt, at, nx, nu, 2.0, nt, 0.01, Qt, rt, m0, Sig0, m1, Sig1);
+    sequential.solve();
+    for (int n_threads : {2, 4, 9}){
+        LinearCovarianceSteering threaded(At, Bt, at, nx, nu, 2.0, nt, 0.01, Qt, rt, m0, Sig0, m1, Sig1);
+        threaded.set_n_threads(n_threads);
+        threaded.update_params(At, Bt, at, Qt, rt);
+        threaded.solve();
+        ASSERT_LE((threaded.Phi() - sequential.Phi()).norm(), 1e-12 * sequential.Phi().norm());
+        ASSERT_LE((threaded.Kt() - sequential.Kt()).norm(), 1e-8 * sequential.Kt().norm());
+        ASSERT_LE((threaded.dt() - sequential.dt()).norm(), 1e-8 * sequential.dt().norm());
+    }
+}
+
+
+TEST(LinearCS, banded_mean){
+    // the banded mean steering agrees with the shooting on a short horizon, and still reaches m1 on a long one
+    EigenWrapper eigen_wrapper;
+    int nx = 4, nu = 2, nt = 400;
+    MatrixXd A{MatrixXd::Zero(nx, nx)}, B{MatrixXd::Zero(nx, nu)};
+    A.block(0, 2, 2, 2) = MatrixXd::Identity(2, 2);
+    B.block(2, 0, 2, 2) = MatrixXd::Identity(2, 2);
+    Matrix3D At = eigen_wrapper.replicate3d(A, nt), Bt = eigen_wrapper.replicate3d(B, nt);
+    Matrix3D at(nx, 1, nt), Qt = eigen_wrapper.replicate3d(MatrixXd::Identity(nx, nx), nt), rt(nx, 1, nt);
+    at.setZero();
+    rt.setConstant(0.1);
+    VectorXd m0{VectorXd::Zero(nx)}, m1{VectorXd::Ones(nx)};
+    MatrixXd Sig0{0.01*MatrixXd::Identity(nx, nx)}, Sig1{0.005*MatrixXd::Identity(nx, nx)};
+
+    for (double T : {2.0, 40.0}){
+        LinearCovarianceSteering shooting(At, Bt, at, nx, nu, T, nt, 0.01, Qt, rt, m0, Sig0, m1, Sig1);
+        LinearCovarianceSteering banded(At, Bt, at, nx, nu, T, nt, 0.01, Qt, rt, m0, Sig0, m1, Sig1);
+        banded.use_banded_mean();
+        shooting.solve();
+        banded.solve();
+        // twice with the same band storage
+        banded.solve();
+
+        MatrixXd Xt = banded.Xt();
+        ASSERT_LE((Xt.col(0).head(nx) - m0).norm(), 1e-12);
+        ASSERT_LE((Xt.col(nt-1).head(nx) - m1).norm(), 1e-12);
+        if (T < 10.0){
+            ASSERT_LE((Xt - shooting.Xt()).norm(), 1e-10 * Xt.norm());
+            ASSERT_LE((banded.dt() - shooting.dt()).norm(), 1e-10 * shooting.dt().norm());
+        }
+    }
+}
+
+
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -11,7 +11,9 @@
 
 #include <gtest/gtest.h>
 #include "dynamics/DoubleIntegratorDraged.h"
+#include "dynamics/PlanarQuadDynamics.h"
 #include "pgcsmp/ProximalGradientCSNonlinearDyn.h"
+#include "dynamics/LinearDynamics.h"
 
 #define STRING(x) #x
 #define XSTRING(x) STRING(x)
@@ -55,6 +57,49 @@ TEST(TestDynamics, linearization){
 
 }
 
+TEST(TestDynamics, threaded_linearization){
+    int nx=6, nu=2, nt=37;
+    PlanarQuadDynamics dyn(nx, nu, nt);
+    Matrix3D zt(nx, 1, nt), Akt(nx, nx, nt), Sigkt(nx, nx, nt);
+    zt.setRandom(); Akt.setRandom(); Sigkt.setRandom();
+
+    std::tuple<LinearDynamics, Matrix3D> res = dyn.linearize(zt, Akt, Sigkt);
+    for (int n_threads : {3, 8, 0}){
+        dyn.set_n_threads(n_threads);
+        std::tuple<LinearDynamics, Matrix3D> res_threaded = dyn.linearize(zt, Akt, Sigkt);
+        ASSERT_EQ(std::get<0>(res_threaded).At(), std::get<0>(res).At());
+        ASSERT_EQ(std::get<0>(res_threaded).Bt(), std::get<0>(res).Bt());
+        ASSERT_EQ(std::get<0>(res_threaded).at(), std::get<0>(res).at());
+        ASSERT_EQ(std::get<1>(res_threaded), std::get<1>(res));
+    }
+
+    // the serial loop
+    std::tuple<MatrixXd, MatrixXd, VectorXd, VectorXd> res_i = dyn.linearize_at(zt.slice(5, nx, 1), Akt.slice(5, nx, nx), Sigkt.slice(5, nx, nx));
+    ASSERT_EQ(std::get<0>(res).At().col(5), std::get<0>(res_i).reshaped());
+    ASSERT_EQ(std::get<1>(res).col(5), std::get<3>(res_i));
+}
+
+TEST(TestDynamics, lti_storage){
+    EigenWrapper ei;
+    int nx=4, nu=2, nt=30;
+    ConstantVelDynamics dyn(nx, nu, nt);
+    ASSERT_TRUE(dyn.time_invariant());
+
+    // the replicated matrices and the indexed views agree
+    Matrix3D At = dyn.At(), Bt = dyn.Bt();
+    ASSERT_EQ(At.cols(), nt);
+    ASSERT_TRUE(ei.is_time_invariant(Bt));
+    for (int i=0; i<nt; i+=7){
+        ASSERT_EQ(At.slice(i), dyn.At_i(i));
+        ASSERT_EQ(Bt.slice(i), dyn.Bt_i(i));
+        ASSERT_EQ(dyn.at_i(i).norm(), 0.0);
+    }
+    ASSERT_EQ(dyn.Bt_i(3), dyn.B0());
+
+    Bt.col(5).setOnes();
+    ASSERT_FALSE(ei.is_time_invariant(Bt));
+}
+
 TEST(TestPGCS, solution){
     MatrixIO m_io;
     EigenWrapper ei;
@@ -106,3 +151,94 @@ TEST(TestPGCS, solution){
     ASSERT_LE((Kt - Kt_gt).norm(), 1e-10);
     ASSERT_LE((dt - dt_gt).norm(), 1e-10);
 }
+
+/**
+ * @brief A quadratic state cost 0.1*I, enough to run the steps of the nonlinear dynamics.
+ */
+class PGCSQuadraticCost: public ProxGradCovSteerNLDyn{
+public:
+    using ProxGradCovSteerNLDyn::ProxGradCovSteerNLDyn;
+
+    std::tuple<Matrix3D, Matrix3D> update_Qrk_NL(const Matrix3D& zt, const Matrix3D& Sigt, 
+                                                const Matrix3D& At, const Matrix3D& at, 
+                                                const Matrix3D& Bt, const Matrix3D& hAt,
+                                                const Matrix3D& hat, const Matrix3D& nTrt,
+                                                const double step_size) override
+    {
+        Matrix3D Qt(_nx, _nx, _nt), rt(_nx, 1, _nt);
+        Qt = _ei.replicate3d(0.1*MatrixXd::Identity(_nx, _nx), _nt) * step_size / (1+step_size);
+        rt = nTrt * step_size / (1+step_size) / 2;
+        return std::make_tuple(Qt, rt);
+    }
+};
+
+TEST(TestPGCS, speculative_backtrack){
+    EigenWrapper ei;
+    int nx=4, nu=2, nt=25;
+    PGCSParams params(nx, nu, 0.0, 0.0, 0.01, 5.0, nt, 0.01, 0.1, 1e-2, 1e-5, 0.0, 10, 0.5, 5);
+    VectorXd m0(nx), mT(nx);
+    m0 << 1, 8, 2, 0;
+    mT << 1, 2, -1, 0;
+    params.set_m0(m0);
+    params.set_mT(mT);
+    params.set_backtrack_threads(3);
+
+    std::shared_ptr<DoubleIntegrator> pdyn{new DoubleIntegrator(nx, nu, nt)};
+    std::tuple<MatrixXd, MatrixXd, VectorXd, VectorXd> linearized_0 = pdyn->linearize_at(m0, MatrixXd::Zero(nx, nx), params.Sig0());
+    MatrixXd A0 = std::get<0>(linearized_0), B = std::get<1>(linearized_0);
+    VectorXd a0 = std::get<2>(linearized_0);
+
+    PGCSQuadraticCost pgcs(A0, a0, B, params, pdyn);
+    Matrix3D At = pgcs.Akt(), at = pgcs.akt(), Bt = ei.replicate3d(B, nt);
+
+    BacktrackTrial trial = [&](double step_size, LinearCovarianceSteering& linear_cs){
+        StepResult res = pgcs.step(0, step_size, At, Bt, at, m0, params.Sig0(), linear_cs);
+        return std::make_tuple(res, std::get<4>(res).norm(), std::get<0>(res).norm());
+    };
+    std::vector<TrialResult> trials = pgcs.speculative_backtrack(trial);
+    ASSERT_EQ(trials.size(), params.max_n_backtrack());
+
+    // the concurrent trials with their own solvers are the sequential steps
+    double step_size = params.step_size();
+    for (int i_bt=0; i_bt<params.max_n_backtrack(); i_bt++){
+        StepResult res = pgcs.step(0, step_size, At, Bt, at, m0, params.Sig0());
+        const StepResult& res_trial = std::get<0>(trials[i_bt]);
+        ASSERT_EQ(std::get<0>(res_trial), std::get<0>(res));
+        ASSERT_EQ(std::get<1>(res_trial), std::get<1>(res));
+        ASSERT_EQ(std::get<4>(res_trial), std::get<4>(res));
+        ASSERT_EQ(std::get<5>(res_trial), std::get<5>(res));
+        ASSERT_EQ(std::get<1>(trials[i_bt]), std::get<4>(res).norm());
+        step_size = params.backtrack_ratio() * step_size;
+    }
+    ASSERT_NE(std::get<0>(std::get<0>(trials[0])), std::get<0>(std::get<0>(trials[1])));
+}
+
+TEST(TestPGCS, banded_mean_params){
+    int nx=4, nu=2, nt=25;
+    VectorXd m0(nx), mT(nx);
+    m0 << 1, 8, 2, 0;
+    mT << 1, 2, -1, 0;
+
+    std::vector<StepResult> results;
+    for (bool banded : {false, true}){
+        PGCSParams params(nx, nu, 0.0, 0.0, 0.01, 5.0, nt, 0.01, 0.1, 1e-2, 1e-5, 0.0, 10, 0.5, 5);
+        params.set_m0(m0);
+        params.set_mT(mT);
+        params.set_banded_mean(banded);
+
+        std::shared_ptr<DoubleIntegrator> pdyn{new DoubleIntegrator(nx, nu, nt)};
+        std::tuple<MatrixXd, MatrixXd, VectorXd, VectorXd> linearized_0 = pdyn->linearize_at(m0, MatrixXd::Zero(nx, nx), params.Sig0());
+        MatrixXd A0 = std::get<0>(linearized_0), B = std::get<1>(linearized_0);
+        VectorXd a0 = std::get<2>(linearized_0);
+
+        PGCSQuadraticCost pgcs(A0, a0, B, params, pdyn);
+        results.emplace_back(pgcs.step(0, params.step_size(), pgcs.Akt(), EigenWrapper().replicate3d(B, nt), pgcs.akt(), m0, params.Sig0()));
+    }
+
+    // the banded mean solve from the params reaches the same gains, feedforward and means as the shooting
+    const StepResult& shooting = results[0], & banded = results[1];
+    ASSERT_EQ(std::get<0>(banded), std::get<0>(shooting));
+    ASSERT_LE((std::get<1>(banded) - std::get<1>(shooting)).norm(), 1e-8 * std::get<1>(shooting).norm());
+    ASSERT_LE((std::get<3>(banded) - std::get<3>(shooting)).norm(), 1e-8 * std::get<3>(shooting).norm());
+    ASSERT_LE((std::get<4>(banded) - std::get<4>(shooting)).norm(), 1e-8 * std::get<4>(shooting).norm());
+}
@@ -0,0 +1,94 @@
+/**
+ * @file test_trajectory_collision.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Test the cached collision evaluations of the PGCS trajectories.
+ * @version 0.1
+ * @date 2023-09-20
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "pgcsmp/TrajectoryCollision.h"
+
+using namespace Eigen;
+using namespace vimp;
+
+/**
+ * @brief A wall at x=0 and two spheres of radius 0 and 0.5 at the configuration, counting the batch queries.
+ */
+struct WallRobot{
+    void hinge_jacobian_batch(const MatrixXd& poses, double eps, MatrixXd& errors, std::vector<MatrixXd>* jacobians=nullptr) const{
+        n_queries++;
+        const int n = poses.cols();
+        errors.resize(2, n);
+        if (jacobians){
+            jacobians->resize(n);
+        }
+        for (int i=0; i<n; i++){
+            MatrixXd J{MatrixXd::Zero(2, poses.rows())};
+            for (int s=0; s<2; s++){
+                errors(s, i) = std::max(0.0, eps + 0.5*s - poses(0, i));
+                if (errors(s, i) > 0){
+                    J(s, 0) = -1.0;
+                }
+            }
+            if (jacobians){
+                (*jacobians)[i] = J;
+            }
+        }
+    }
+
+    mutable int n_queries = 0;
+};
+
+TEST(TrajectoryCollision, cache){
+    int nx=4, nt=6;
+    double eps_sdf=0.2, sig_obs=3.0;
+    WallRobot robot;
+    TrajectoryCollisionCache cache(eps_sdf, sig_obs, 2);
+
+    MatrixXd zt(nx, nt);
+    zt.setRandom();
+    zt.row(0) << -0.5, 0.0, 0.1, 0.3, 0.6, 1.0;
+
+    std::shared_ptr<const TrajectoryCollision> p_col = cache.evaluate(robot, zt, 2);
+    ASSERT_EQ(robot.n_queries, 1);
+
+    // the losses and the gradients of the state cost sig_obs*|h|^2
+    double hingeloss = 0;
+    for (int i=0; i<nt; i++){
+        VectorXd grad_i{VectorXd::Zero(nx)};
+        for (int s=0; s<2; s++){
+            double h = std::max(0.0, eps_sdf + 0.5*s - zt(0, i));
+            ASSERT_EQ(p_col->hinge(s, i), h);
+            hingeloss += sig_obs * h * h;
+            grad_i(0) -= h > 0 ? sig_obs * h : 0.0;
+        }
+        ASSERT_LE((p_col->grad_V.col(i) - grad_i).norm(), 1e-14);
+    }
+    ASSERT_LE(std::abs(p_col->hingeloss - hingeloss), 1e-12);
+
+    // the same configurations come from the cache, the velocities do not matter
+    zt.bottomRows(2).setRandom();
+    ASSERT_EQ(cache.evaluate(robot, zt, 2), p_col);
+    ASSERT_EQ(robot.n_queries, 1);
+
+    // two other trajectories push the first one out
+    MatrixXd zt1{zt}, zt2{zt};
+    zt1(1, 3) += 1.0;
+    zt2(0, 2) += 1.0;
+    ASSERT_NE(cache.evaluate(robot, zt1, 2), p_col);
+    ASSERT_EQ(cache.evaluate(robot, zt, 2), p_col);
+    ASSERT_EQ(robot.n_queries, 2);
+    cache.evaluate(robot, zt2, 2);
+    cache.evaluate(robot, zt1, 2);
+    ASSERT_EQ(robot.n_queries, 3);
+    cache.evaluate(robot, zt, 2);
+    ASSERT_EQ(robot.n_queries, 4);
+
+    cache.clear();
+    cache.evaluate(robot, zt, 2);
+    ASSERT_EQ(robot.n_queries, 5);
+}
@@ -0,0 +1,112 @@
+/**
+ * @file test_batch_fk.cpp
+ * @author Hongzhe Yu (hyu419@gatech.edu)
+ * @brief Test the batch forward kinematics of the sphere centers against the pose chains of the DH arms.
+ * @version 0.1
+ * @date 2023-09-12
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include "robots/BatchArmKinematics.h"
+#include <Eigen/Geometry>
+#include <gtest/gtest.h>
+
+using namespace vimp;
+using namespace Eigen;
+
+/// the WAM arm of WamArmSDFExample, with a shifted and rotated base
+struct WamArm{
+    VectorXd a{(VectorXd(7) << 0.0, 0.0, 0.045, -0.045, 0.0, 0.0, 0.0).finished()};
+    VectorXd alpha{(VectorXd(7) << -M_PI/2.0, M_PI/2.0, -M_PI/2.0, M_PI/2.0, -M_PI/2.0, M_PI/2.0, 0.0).finished()};
+    VectorXd d{(VectorXd(7) << 0.0, 0.0, 0.55, 0.0, 0.3, 0.0, 0.06).finished()};
+    VectorXd theta_bias{VectorXd::LinSpaced(7, 0.0, 0.3)};
+    Isometry3d base{Translation3d(0.1, -0.2, 0.3) * AngleAxisd(0.4, Vector3d::UnitZ())};
+    std::vector<int> links{0, 1, 1, 1, 1, 2, 3, 3, 3, 5, 6, 6, 6, 6, 6, 6};
+    Matrix3Xd centers;
+
+    WamArm(): centers(3, 16){
+        centers << 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.1,   0.1,   -0.1, 0.15,   0.15,  -0.15,
+                   0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, -0.025, 0.025, 0.0,  -0.025, 0.025, 0.0,
+                   0.0, 0.2, 0.3, 0.4, 0.5, 0.0, 0.1, 0.2, 0.3, 0.1, 0.08,  0.08,  0.08, 0.13,   0.13,  0.13;
+    }
+
+    BatchArmKinematics kinematics() const{
+        return BatchArmKinematics(a, alpha, d, theta_bias, base.rotation(), base.translation(), links, centers);
+    }
+
+    /// the pose chain of gpmp2::Arm::forwardKinematics
+    Vector3d center(const VectorXd& conf, int s) const{
+        Isometry3d pose = base;
+        for (int j=0; j<=links[s]; j++){
+            pose = pose * AngleAxisd(conf(j) + theta_bias(j), Vector3d::UnitZ()) * Translation3d(a(j), 0.0, d(j))
+                        * AngleAxisd(alpha(j), Vector3d::UnitX());
+        }
+        return pose * Vector3d(centers.col(s));
+    }
+};
+
+TEST(BatchArmKinematics, wam_sphere_centers){
+    WamArm arm;
+    BatchArmKinematics kinematics = arm.kinematics();
+    int ns = kinematics.n_spheres();
+
+    int n = 25;
+    MatrixXd confs = MatrixXd::Random(7, n) * M_PI;
+
+    MatrixXd centers, jacobians;
+    kinematics.sphere_centers(confs, centers, &jacobians);
+    ASSERT_EQ(centers.cols(), ns*n);
+    ASSERT_EQ(jacobians.rows(), 3*7);
+
+    MatrixXd centers_only;
+    kinematics.sphere_centers(confs, centers_only);
+    ASSERT_EQ((centers - centers_only).norm(), 0.0);
+
+    double h = 1e-6;
+    for (int i=0; i<n; i++){
+        for (int s=0; s<ns; s++){
+            ASSERT_LE((centers.col(i*ns + s) - arm.center(confs.col(i), s)).norm(), 1e-12);
+
+            // central differences of the pose chain
+            MatrixXd J_fd(3, 7);
+            for (int j=0; j<7; j++){
+                VectorXd conf_p = confs.col(i), conf_m = confs.col(i);
+                conf_p(j) += h;
+                conf_m(j) -= h;
+                J_fd.col(j) = (arm.center(conf_p, s) - arm.center(conf_m, s)) / (2.0*h);
+            }
+            MatrixXd J = jacobians.col(i*ns + s).reshaped(3, 7);
+            ASSERT_LE((J - J_fd).norm(), 1e-8);
+        }
+    }
+}
+
+TEST(BatchArmKinematics, planar_arm){
+    // the 2-link planar arm of PlanarArm2SDFExample
+    Vector2d a{0.5, 0.5}, alpha{0.0, 0.0}, d{0.0, 0.0};
+    Matrix3Xd centers(3, 2);
+    centers << -0.5, -0.5,
+                0.0, 0.0,
+                0.0, 0.0;
+    BatchArmKinematics kinematics(a, alpha, d, Vector2d::Zero(), Matrix3d::Identity(), Vector3d::Zero(), {0, 1}, centers);
+
+    MatrixXd confs(2, 2);
+    confs << 0.0, M_PI/2.0,
+             0.0, M_PI/2.0;
+    MatrixXd sphere_centers, jacobians;
+    kinematics.sphere_centers(confs, sphere_centers, &jacobians);
+
+    MatrixXd expected(3, 4);
+    expected << 0.0, 0.5, 0.0, 0.0,
+                0.0, 0.0, 0.0, 0.5,
+                0.0, 0.0, 0.0, 0.0;
+    ASSERT_LE((sphere_centers - expected).norm(), 1e-12);
+
+    // the first sphere sits on the first joint axis, the second one on the second joint axis
+    MatrixXd J_0 = jacobians.col(0).reshaped(3, 2);
+    MatrixXd J_1 = jacobians.col(1).reshaped(3, 2);
+    ASSERT_LE(J_0.norm(), 1e-12);
+    ASSERT_LE((J_1 - (MatrixXd(3, 2) << 0.0, 0.0, 0.5, 0.0, 0.0, 0.0).finished()).norm(), 1e-12);
+}
@@ -108,4 +108,59 @@ TEST(TestPRSDF, pose_cost_jacobian){
 
     ei.print_matrix(hinge, "hinge 2");
     ei.print_matrix(Jacobian, "Jacobian 2");
-}
\ No newline at end of file
+}
+
+TEST(TestPRSDF, registry_shared_sdf){
+    // robots on the same map share one sdf instance
+    PlanarPRSDFExample pr_sdf_1{0.1, 0.5, "2dpr_map2"};
+    PlanarPRSDFExample pr_sdf_2{0.2, 1.0, "2dpr_map2"};
+    ASSERT_EQ(pr_sdf_1.psdf().get(), pr_sdf_2.psdf().get());
+    ASSERT_EQ(&pr_sdf_1.sdf(), &pr_sdf_2.sdf());
+
+    // a map registered at runtime under a new name
+    SDFMapInfo map_info = SDFRegistry::instance().map_info("2dpr_map2");
+    SDFRegistry::instance().register_map("2dpr_map2_copy", map_info);
+    PlanarPRSDFExample pr_sdf_3{0.1, 0.5, "2dpr_map2_copy"};
+    ASSERT_NE(pr_sdf_3.psdf().get(), pr_sdf_1.psdf().get());
+    ASSERT_EQ((pr_sdf_3.sdf().raw_data() - pr_sdf_1.sdf().raw_data()).norm(), 0);
+
+    ASSERT_THROW(SDFRegistry::instance().map_info("no_such_map"), std::runtime_error);
+}
+
+TEST(TestPRSDF, region_update_copy_on_write){
+    SDFRegistry::instance().register_map("2dpr_map2_update", SDFRegistry::instance().map_info("2dpr_map2"));
+    PlanarPRSDFExample pr_sdf_1{0.1, 0.5, "2dpr_map2_update"};
+    PlanarPRSDFExample pr_sdf_2{0.1, 0.5, "2dpr_map2_update"};
+    std::shared_ptr<const SDF> p_before = pr_sdf_1.psdf();
+    MatrixXd field_before = p_before->raw_data();
+    ASSERT_EQ(pr_sdf_1.sdf_version(), pr_sdf_2.sdf_version());
+    size_t version_before = pr_sdf_1.sdf_version();
+
+    // an obstacle in an empty grid of the same size
+    MatrixXd occupancy = MatrixXd::Zero(field_before.rows(), field_before.cols());
+    IncrementalSDF incremental{std::vector<MatrixXd>{occupancy}, Vector2d{p_before->origin().x(), p_before->origin().y()}, p_before->cell_size()};
+    SDFRegion region = incremental.update_occupancy(10, 12, MatrixXd::Ones(3, 3));
+    pr_sdf_1.update_sdf_region(incremental, region);
+
+    // the updated copy replaces the registry instance, the previous one is unchanged for the other robot
+    ASSERT_NE(pr_sdf_1.psdf().get(), p_before.get());
+    ASSERT_EQ(SDFRegistry::instance().planar_sdf("2dpr_map2_update").get(), pr_sdf_1.psdf().get());
+    ASSERT_EQ((pr_sdf_1.sdf().raw_data() - incremental.field()[0]).norm(), 0);
+    ASSERT_EQ((p_before->raw_data() - field_before).norm(), 0);
+    ASSERT_EQ(pr_sdf_2.psdf().get(), p_before.get());
+    ASSERT_NE(pr_sdf_1.sdf_version(), version_before);
+    ASSERT_EQ(pr_sdf_2.sdf_version(), version_before);
+
+    // the other robot follows the map
+    ASSERT_TRUE(pr_sdf_2.sync_sdf());
+    ASSERT_EQ(pr_sdf_2.psdf().get(), pr_sdf_1.psdf().get());
+    ASSERT_EQ(pr_sdf_2.sdf_version(), pr_sdf_1.sdf_version());
+    ASSERT_FALSE(pr_sdf_2.sync_sdf());
+
+    // a full replacement changes the version and leaves the registry map
+    pr_sdf_2.update_sdf(*p_before);
+    ASSERT_NE(pr_sdf_2.sdf_version(), pr_sdf_1.sdf_version());
+    ASSERT_FALSE(pr_sdf_2.sync_sdf());
+    ASSERT_EQ((pr_sdf_2.sdf().raw_data() - field_before).norm(), 0);
+    ASSERT_EQ(SDFRegistry::instance().planar_sdf("2dpr_map2_update").get(), pr_sdf_1.psdf().get());
+}